@@ -17,17 +17,33 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <tuple>
 #include <type_traits>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #if defined __clang__ or defined __GNUC__
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpedantic"
@@ -39,6 +55,7 @@
 #endif
 
 #include <sisl/logging/logging.h>
+#include "bitset_simd.hpp"
 #include "bitword.hpp"
 #include "buffer.hpp"
 
@@ -51,26 +68,27 @@
 //
 
 namespace sisl {
-struct BitBlock {
-    uint64_t start_bit;
-    uint32_t nbits;
-    BitBlock(const uint64_t start, const uint32_t bits) : start_bit{start}, nbits{bits} {}
-    BitBlock(const BitBlock&) = default;
-    BitBlock(BitBlock&&) noexcept = default;
-    BitBlock& operator=(const BitBlock&) = default;
-    BitBlock& operator=(BitBlock&&) noexcept = default;
-    ~BitBlock() = default;
-};
-
-template < typename Word, const bool ThreadSafeResizing = false >
+/**
+ * @brief BitsetImpl
+ *
+ * @tparam Word Bitword type which holds the bits
+ * @tparam ThreadSafeResizing Should resize be thread safe against concurrent updates
+ * @tparam Summarized Maintain a summary index of the words (which words are full and the largest run of reset bits
+ * per block of words), so that searches for reset bits can jump directly to candidate words instead of a linear scan
+ * of every word. Every set/reset updates the summary of the words it modified (the counts are recomputed lazily by
+ * the next search) and hence it is meant for large mostly filled bitsets. Updates to the summary are not atomic, so
+ * it is allowed only with non atomic words.
+ */
+template < typename Word, const bool ThreadSafeResizing = false, const bool Summarized = false >
 class BitsetImpl {
 public:
     typedef std::decay_t< Word > bitword_type;
     static_assert(bitword_type::bits() == 8 || bitword_type::bits() == 16 || bitword_type::bits() == 32 ||
-                      bitword_type::bits() == 64,
+                      bitword_type::bits() == 64 || bitword_type::bits() == 128,
                   "bitword_type::bits() must be power of two in size");
     typedef typename bitword_type::word_t word_t;
     typedef typename bitword_type::value_type value_type;
+    static_assert(!Summarized || std::is_trivial_v< value_type >, "Summarized bitset is not supported on atomic words");
 
 private:
 #pragma pack(1)
@@ -123,8 +141,34 @@ private:
             return ((nbits / word_size()) + (((nbits & m_word_mask) > 0) ? 1 : 0));
         }
     };
+
+    // Compressed serialized format is the header followed by one chunk for every compressed_chunk_bits of the bitset.
+    // Each chunk is a type byte followed by its payload, based on whichever is smaller for that chunk.
+    //   empty/full: No payload
+    //   runs: uint32_t count of runs followed by that many pairs of uint16_t (start_bit, nbits - 1) of set bits
+    //   dense: Raw bits of the chunk as uint64_t words
+    // Bits are stored unshifted and independent of the word size, so it can be loaded into any type of bitset.
+    struct compressed_header {
+        static constexpr uint32_t s_magic{0x43425354};
+        static constexpr uint32_t s_version{1};
+
+        uint32_t m_magic{s_magic};
+        uint32_t m_version{s_version};
+        uint64_t m_id;
+        uint64_t m_nbits;
+        uint32_t m_alignment_size;
+    };
 #pragma pack()
 
+    enum class compressed_chunk_type : uint8_t { empty = 0, full = 1, runs = 2, dense = 3 };
+    static constexpr uint64_t compressed_chunk_bits{65536};
+    static constexpr uint64_t compressed_chunk_groups{compressed_chunk_bits / 64};
+
+    struct compressed_chunk_info {
+        compressed_chunk_type type;
+        uint32_t nruns;
+    };
+
     class ReadLockGuard {
     public:
         ReadLockGuard(const BitsetImpl* const bitset) : m_b{bitset} { lock(); }
@@ -185,6 +229,213 @@ private:
     mutable folly::SharedMutex m_lock;
     static constexpr uint64_t m_word_mask{bitword_type::bits() - 1};
 
+    // Summary of the words, indexed by the physical word number (including the skipped words). Each block of
+    // summary_block_words has a bitmap of which words are fully set, the max contiguous reset bits within the block
+    // and number of reset bits at the tail of the block. The counts could be over estimated (say bits beyond the end of
+    // bitset), which makes searches scan more, but never under estimated.
+    //
+    // Writes update only the full bit of the words they modify and mark the block stale. The counts of a stale block
+    // are recomputed by the next search which needs them, which could be a concurrent reader and hence the counts and
+    // stale marks are atomic.
+    struct bitset_summary {
+        static constexpr uint64_t summary_block_words{64};
+
+        explicit bitset_summary(const uint64_t nblocks) :
+                m_full_words(nblocks, 0),
+                m_max_reset_bits(nblocks),
+                m_tail_reset_bits(nblocks),
+                m_stale_blocks((nblocks + 63) / 64) {}
+
+        void mark_stale(const uint64_t block) {
+            auto& stale{m_stale_blocks[block / 64]};
+            const uint64_t mask{bit_mask[block % 64]};
+            if ((stale.load(std::memory_order_relaxed) & mask) == 0) {
+                stale.fetch_or(mask, std::memory_order_relaxed);
+            }
+        }
+
+        std::vector< uint64_t > m_full_words;
+        std::vector< std::atomic< uint32_t > > m_max_reset_bits;
+        std::vector< std::atomic< uint32_t > > m_tail_reset_bits;
+        std::vector< std::atomic< uint64_t > > m_stale_blocks;
+    };
+    std::shared_ptr< bitset_summary > m_summary;
+
+    // Count of set bits before every superblock_bits (in logical bits) of the bitset for rank() and select(). It is
+    // built on the first query and writes only record the lowest superblock they modified, from which the next query
+    // recomputes the counts. The counts of the bits retained by a resize are carried over to the resized bitset.
+    struct rank_index {
+        static constexpr uint64_t superblock_bits{512};
+
+        void invalidate(const uint64_t bit) {
+            const uint64_t superblock{bit / superblock_bits};
+            // Mostly it is already stale from a lower superblock, avoid writing to the shared cache line then
+            uint64_t stale_from{m_stale_from.load(std::memory_order_relaxed)};
+            if (stale_from <= superblock) { return; }
+            while ((superblock < stale_from) &&
+                   !m_stale_from.compare_exchange_weak(stale_from, superblock, std::memory_order_release,
+                                                       std::memory_order_relaxed)) {}
+        }
+
+        folly::SharedMutex m_lock;
+        std::vector< uint64_t > m_ranks; // m_ranks[i] is the count of set bits in [0, i * superblock_bits)
+        std::atomic< uint64_t > m_stale_from{0}; // First superblock with stale count, npos if all are valid
+    };
+    std::shared_ptr< rank_index > m_rank;
+
+    // Runs of reset bits (in logical bits) indexed by their start and by their size, for the best fit searches. Enabled
+    // by enable_free_run_index(), it is built on the first search and from then on the writes mark the blocks of
+    // block_bits they modified in a bitmap, without any lock. The next search rescans those blocks to update the runs
+    // overlapping them.
+    struct free_run_index {
+        static constexpr uint64_t block_bits{4096};
+
+        explicit free_run_index(const uint64_t nbits) :
+                m_stale_blocks((nbits + (block_bits * 64) - 1) / (block_bits * 64)) {}
+
+        void invalidate(const uint64_t start, const uint64_t nbits) {
+            // Always do the atomic or (even if already stale), so that it pairs with the clearing in the search and the
+            // modified bits are guaranteed to be visible to it
+            const uint64_t last_block{(start + nbits - 1) / block_bits};
+            for (uint64_t block{start / block_bits}; block <= last_block; ++block) {
+                m_stale_blocks[block / 64].fetch_or(bit_mask[block % 64], std::memory_order_release);
+            }
+        }
+
+        void invalidate_all() { m_all_stale.store(true, std::memory_order_release); }
+
+        void add_run(const uint64_t start, const uint64_t nbits) {
+            m_by_start.emplace(start, nbits);
+            m_by_size.emplace(nbits, start);
+        }
+
+        void remove_run(const std::map< uint64_t, uint64_t >::iterator itr) {
+            m_by_size.erase(std::make_pair(itr->second, itr->first));
+            m_by_start.erase(itr);
+        }
+
+        std::mutex m_lock;                      // Taken only by the searches, to update the runs
+        std::atomic< bool > m_all_stale{true};  // Runs have to be built again for the entire bitset
+        std::vector< std::atomic< uint64_t > > m_stale_blocks; // Bitmap of the blocks modified since the last search
+        std::map< uint64_t, uint64_t > m_by_start;             // run start bit -> run size
+        std::set< std::pair< uint64_t, uint64_t > > m_by_size; // {run size, run start bit}
+    };
+    std::shared_ptr< free_run_index > m_free_runs;
+
+    // Tracker of the pages (range of page_bits in the bitset) modified since the last serialize_delta(). Operations
+    // which move the bits around (shrink_head, resize, copy) mark the entire bitset dirty.
+    struct dirty_tracker {
+        dirty_tracker(const uint64_t page_bits, const uint64_t nbits) :
+                m_page_bits{page_bits}, m_pages((total_pages(nbits) + 63) / 64) {}
+
+        uint64_t total_pages(const uint64_t nbits) const { return (nbits + m_page_bits - 1) / m_page_bits; }
+
+        const uint64_t m_page_bits;
+        std::vector< std::atomic< uint64_t > > m_pages;
+        std::atomic< bool > m_all_dirty{false};
+    };
+    std::shared_ptr< dirty_tracker > m_dirty;
+
+    // File which backs the words of a bitset created with mapped_file. The fd is kept open and shared with the
+    // shallow copies. Resize and copy never rewrite the file in place: the new image is written to a replacement file
+    // (m_pending_path) which is then renamed over the path. The old file is marked detached, shallow copies keep
+    // their old mapping of it (like the shallow copies of an in memory bitset keep the old buffer) and move to memory
+    // on their next resize or copy.
+    struct mapped_file_info {
+        mapped_file_info(const std::string& path, const int fd, const std::string& pending_path = std::string{}) :
+                m_path{path}, m_fd{fd}, m_pending_path{pending_path} {}
+        mapped_file_info(const mapped_file_info&) = delete;
+        mapped_file_info& operator=(const mapped_file_info&) = delete;
+        mapped_file_info(mapped_file_info&&) noexcept = delete;
+        mapped_file_info& operator=(mapped_file_info&&) noexcept = delete;
+        ~mapped_file_info() {
+            ::close(m_fd);
+            // Replacement file which was never renamed over the path
+            if (!m_pending_path.empty()) { ::unlink(m_pending_path.c_str()); }
+        }
+
+        uint64_t file_size() const {
+            struct stat st;
+            if (::fstat(m_fd, &st) != 0) {
+                throw std::system_error(errno, std::generic_category(), "Unable to stat bitset file " + m_path);
+            }
+            return static_cast< uint64_t >(st.st_size);
+        }
+
+        void extend(const uint64_t size) const {
+            if (file_size() >= size) { return; }
+            if (::ftruncate(m_fd, static_cast< off_t >(size)) != 0) {
+                throw std::system_error(errno, std::generic_category(), "Unable to extend bitset file " + m_path);
+            }
+        }
+
+        void sync() const {
+            if (::fsync(m_fd) != 0) {
+                throw std::system_error(errno, std::generic_category(), "Unable to sync bitset file " + m_path);
+            }
+        }
+
+        const std::string m_path;
+        const int m_fd;
+        std::string m_pending_path;
+        std::atomic< bool > m_detached{false};
+    };
+    std::shared_ptr< mapped_file_info > m_mapped;
+
+    // Words can live in a file mapping only if the Bitword is laid out as the plain word and needs no destruction
+    static constexpr bool s_mappable_words{std::is_standard_layout_v< bitword_type > &&
+                                           std::is_trivially_destructible_v< bitword_type > &&
+                                           (sizeof(value_type) == sizeof(bitword_type))};
+
+    // byte_array of the file mapping. Mapping of a very large bitset can be beyond the 32 bit size of the byte_array,
+    // so the actual size is kept separately and the byte_array size is capped.
+    struct mapped_byte_array_impl : public byte_array_impl {
+        static constexpr uint64_t max_blob_size{std::numeric_limits< uint32_t >::max()};
+
+        mapped_byte_array_impl(uint8_t* const bytes, const uint64_t size) :
+                byte_array_impl{bytes, static_cast< uint32_t >(std::min(size, max_blob_size)), false},
+                m_mapped_size{size} {}
+
+        const uint64_t m_mapped_size;
+    };
+
+    static sisl::byte_array make_mapped_byte_array(const mapped_file_info& file, const uint64_t size) {
+        void* const addr{::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file.m_fd, 0)};
+        if (addr == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "Unable to mmap bitset file " + file.m_path);
+        }
+        return std::shared_ptr< mapped_byte_array_impl >{
+            new mapped_byte_array_impl{static_cast< uint8_t* >(addr), size}, [](mapped_byte_array_impl* const ptr) {
+                if (ptr) {
+                    // Words are persisted in the file, so only unmap and do not let byte_array free the buffer
+                    ::munmap(ptr->bytes, ptr->m_mapped_size);
+                    ptr->bytes = nullptr;
+                    delete ptr;
+                }
+            }};
+    }
+
+#pragma pack(1)
+    struct delta_header {
+        static constexpr uint32_t s_magic{0x44425354};
+        static constexpr uint32_t s_version{1};
+
+        uint32_t m_magic{s_magic};
+        uint32_t m_version{s_version};
+        uint64_t m_nbits;
+        uint64_t m_page_bits;
+        uint64_t m_npages; // Count of pages in this delta, each page is uint64_t page number followed by its bits
+        uint8_t m_full;
+    };
+#pragma pack()
+
+    // Words can be scanned as a raw array of uint64_t by the vectorized kernels only if the Bitword is a plain
+    // wrapper of the 64 bit integer
+    static constexpr bool s_raw_word_scan{std::is_standard_layout_v< bitword_type > &&
+                                          std::is_trivial_v< value_type > &&
+                                          (sizeof(value_type) == sizeof(bitword_type)) &&
+                                          (sizeof(word_t) == sizeof(uint64_t))};
+
 #ifndef NDEBUG
     static constexpr size_t compaction_threshold() { return word_size() * 10; }
 #else
@@ -196,6 +447,7 @@ public:
     static constexpr uint8_t word_size() { return bitword_type::bits(); }
 
     static constexpr uint64_t npos{std::numeric_limits< uint64_t >::max()};
+    static constexpr uint64_t default_dirty_page_bits{4096 * 8};
 
     ~BitsetImpl() {
         {
@@ -207,8 +459,9 @@ public:
     explicit BitsetImpl(const uint64_t nbits = 0, const uint64_t m_id = 0, const uint32_t alignment_size = 0) {
         const uint64_t size{(alignment_size > 0) ? round_up(bitset_serialized::nbytes(nbits), alignment_size)
                                                  : bitset_serialized::nbytes(nbits)};
-        m_buf = make_byte_array_with_deleter(static_cast< uint32_t >(size), alignment_size);
+        m_buf = make_byte_array_with_deleter(checked_blob_size(size), alignment_size);
         m_s = new (m_buf->bytes) bitset_serialized{m_id, nbits, 0, alignment_size};
+        rebuild_summary();
     }
 
     // this makes a shared copy of the rhs so that modifications of the shared version
@@ -217,6 +470,11 @@ public:
         ReadLockGuard lock{&other};
         m_buf = other.m_buf;
         m_s = other.m_s;
+        m_summary = other.m_summary;
+        m_rank = other.m_rank;
+        m_free_runs = other.m_free_runs;
+        m_dirty = other.m_dirty;
+        m_mapped = other.m_mapped;
     }
 
     explicit BitsetImpl(const sisl::byte_array& b,
@@ -233,11 +491,62 @@ public:
         const uint32_t alignment_size{opt_alignment_size ? (*opt_alignment_size) : ptr->m_alignment_size};
         const uint64_t size{(alignment_size > 0) ? round_up(total_bytes, alignment_size) : total_bytes};
         assert(b->size >= total_bytes);
-        m_buf = make_byte_array_with_deleter(static_cast< uint32_t >(size), alignment_size);
+        m_buf = make_byte_array_with_deleter(checked_blob_size(size), alignment_size);
         m_s = new (m_buf->bytes) bitset_serialized{ptr->m_id, nbits, ptr->m_skip_bits, alignment_size, false};
-        const word_t* b_words{reinterpret_cast< const word_t* >(b->bytes + sizeof(bitset_serialized))};
+        const bitword_type* b_words{reinterpret_cast< const bitword_type* >(b->bytes + sizeof(bitset_serialized))};
         // copy the data
         std::uninitialized_copy(b_words, std::next(b_words, m_s->m_words_cap), m_s->get_words());
+        rebuild_summary();
+    }
+
+    /**
+     * @brief Tag to construct the bitset from a buffer created by serialize_compressed()
+     */
+    struct compressed_tag {};
+    static constexpr compressed_tag compressed{};
+
+    BitsetImpl(compressed_tag, const sisl::byte_array& b,
+               const std::optional< uint32_t > opt_alignment_size = std::optional< uint32_t >{}) :
+            BitsetImpl{compressed, b, read_compressed_header(b), opt_alignment_size} {}
+
+    /**
+     * @brief Tag to construct the bitset whose words are memory mapped from a file
+     */
+    struct mapped_file_tag {};
+    static constexpr mapped_file_tag mapped_file{};
+
+    /**
+     * @brief Construct a bitset backed by a shared memory mapping of the file at path. If the file already has a bitset
+     * (from an earlier instance or a serialize() output), it is used as is without deserialization and nbits/id are
+     * ignored. Otherwise the file is created with nbits reset bits. Updates reach the file through the OS page cache,
+     * use flush() to force them to disk and advise() to hint the access pattern.
+     */
+    BitsetImpl(mapped_file_tag, const std::string& path, const uint64_t nbits = 0, const uint64_t id = 0) {
+        static_assert(s_mappable_words, "File backed bitset is not supported on this bitword type");
+        const int fd{::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)};
+        if (fd < 0) { throw std::system_error(errno, std::generic_category(), "Unable to open bitset file " + path); }
+        m_mapped = std::make_shared< mapped_file_info >(path, fd);
+
+        const uint64_t file_size{m_mapped->file_size()};
+        if (file_size == 0) {
+            const uint64_t size{bitset_serialized::nbytes(nbits)};
+            m_mapped->extend(size);
+            m_buf = make_mapped_byte_array(*m_mapped, size);
+            m_s = new (m_buf->bytes) bitset_serialized{id, nbits, 0, 0};
+        } else {
+            if (file_size < sizeof(bitset_serialized)) {
+                throw std::out_of_range("File " + path + " is too small to be a bitset");
+            }
+            m_buf = make_mapped_byte_array(*m_mapped, file_size);
+            bitset_serialized* const ptr{reinterpret_cast< bitset_serialized* >(m_buf->bytes)};
+            if ((ptr->m_word_bits != bitword_type::bits()) ||
+                (ptr->m_words_cap != bitset_serialized::total_words(ptr->m_nbits)) ||
+                (bitset_serialized::nbytes(ptr->m_nbits) > file_size) || (ptr->m_skip_bits > ptr->m_nbits)) {
+                throw std::out_of_range("File " + path + " does not have a valid bitset");
+            }
+            m_s = ptr;
+        }
+        rebuild_summary();
     }
 
     explicit BitsetImpl(const word_t* const start_ptr, const word_t* const end_ptr, const uint64_t id = 0,
@@ -247,11 +556,12 @@ public:
         const uint64_t nbits{static_cast< uint64_t >(num_words) * word_size()};
         const uint64_t size{(alignment_size > 0) ? round_up(bitset_serialized::nbytes(nbits), alignment_size)
                                                  : bitset_serialized::nbytes(nbits)};
-        m_buf = make_byte_array_with_deleter(static_cast< uint32_t >(size), alignment_size);
+        m_buf = make_byte_array_with_deleter(checked_blob_size(size), alignment_size);
         m_s = new (m_buf->bytes) bitset_serialized{id, nbits, 0, alignment_size, false};
 
         // copy the data into the uninitialized bitset
         std::uninitialized_copy(start_ptr, end_ptr, m_s->get_words());
+        rebuild_summary();
     }
 
     template < typename IteratorType,
@@ -263,17 +573,23 @@ public:
         const uint64_t nbits{static_cast< uint64_t >(num_words) * word_size()};
         const uint64_t size{(alignment_size > 0) ? round_up(bitset_serialized::nbytes(nbits), alignment_size)
                                                  : bitset_serialized::nbytes(nbits)};
-        m_buf = make_byte_array_with_deleter(static_cast< uint32_t >(size), alignment_size);
+        m_buf = make_byte_array_with_deleter(checked_blob_size(size), alignment_size);
         m_s = new (m_buf->bytes) bitset_serialized{id, nbits, 0, alignment_size, false};
 
         // copy the data into the unitialized bitset
         std::uninitialized_copy(start_itr, end_itr, m_s->get_words());
+        rebuild_summary();
     }
 
     BitsetImpl(BitsetImpl&& other) noexcept {
         WriteLockGuard lock{&other};
         m_buf = std::move(other.m_buf);
         m_s = std::move(other.m_s);
+        m_summary = std::move(other.m_summary);
+        m_rank = std::move(other.m_rank);
+        m_free_runs = std::move(other.m_free_runs);
+        m_dirty = std::move(other.m_dirty);
+        m_mapped = std::move(other.m_mapped);
         other.m_s = nullptr;
     }
 
@@ -289,6 +605,11 @@ public:
                 if (m_buf != rhs.m_buf) {
                     m_buf = rhs.m_buf;
                     m_s = rhs.m_s;
+                    m_summary = rhs.m_summary;
+                    m_rank = rhs.m_rank;
+                    m_free_runs = rhs.m_free_runs;
+                    m_dirty = rhs.m_dirty;
+                    m_mapped = rhs.m_mapped;
                 }
             }
         }
@@ -304,9 +625,19 @@ public:
                 if (m_buf != rhs.m_buf) {
                     m_buf = std::move(rhs.m_buf);
                     m_s = std::move(rhs.m_s);
+                    m_summary = std::move(rhs.m_summary);
+                    m_rank = std::move(rhs.m_rank);
+                    m_free_runs = std::move(rhs.m_free_runs);
+                    m_dirty = std::move(rhs.m_dirty);
+                    m_mapped = std::move(rhs.m_mapped);
                 } else {
                     // already sharing same buffer so just clear
                     rhs.m_buf.reset();
+                    rhs.m_summary.reset();
+                    rhs.m_rank.reset();
+                    rhs.m_free_runs.reset();
+                    rhs.m_dirty.reset();
+                    rhs.m_mapped.reset();
                 }
                 rhs.m_s = nullptr;
             }
@@ -328,7 +659,7 @@ public:
             const uint8_t word_bits_remaining{static_cast< uint8_t >(word_size() - offset)};
             const uint8_t valid_low_bits{
                 static_cast< uint8_t >((bits_remaining > word_bits_remaining) ? word_bits_remaining : bits_remaining)};
-            const word_t low_mask{static_cast< word_t >(consecutive_bitmask[valid_low_bits - 1])};
+            const word_t low_mask{word_consecutive_bitmask< word_t >(valid_low_bits)};
             val = static_cast< word_t >(val >> offset) & low_mask;
             bits_remaining -= valid_low_bits;
 
@@ -336,13 +667,13 @@ public:
             if (bits_remaining > 0) {
                 const uint8_t valid_high_bits{
                     static_cast< uint8_t >((bits_remaining > offset) ? offset : bits_remaining)};
-                const word_t high_mask{static_cast< word_t >(consecutive_bitmask[valid_high_bits - 1])};
+                const word_t high_mask{word_consecutive_bitmask< word_t >(valid_high_bits)};
                 val |= static_cast< word_t >(((++word_ptr)->to_integer() & high_mask) << valid_low_bits);
             }
         } else {
             // single word optimization
             if (bits_remaining < word_size()) {
-                const word_t mask{static_cast< word_t >(consecutive_bitmask[bits_remaining - 1])};
+                const word_t mask{word_consecutive_bitmask< word_t >(bits_remaining)};
                 val &= mask;
             }
         }
@@ -372,7 +703,7 @@ public:
                         const uint8_t word_bits_remaining{static_cast< uint8_t >(word_size() - lhs_offset)};
                         const uint8_t valid_bits{static_cast< uint8_t >(
                             (bits_remaining > word_bits_remaining) ? word_bits_remaining : bits_remaining)};
-                        const word_t mask{static_cast< word_t >(consecutive_bitmask[valid_bits - 1])};
+                        const word_t mask{word_consecutive_bitmask< word_t >(valid_bits)};
                         const word_t lhs_val{static_cast< word_t >(lhs_word_ptr->to_integer() >> lhs_offset) & mask};
                         const word_t rhs_val{static_cast< word_t >(rhs_word_ptr->to_integer() >> rhs_offset) & mask};
                         if (lhs_val != rhs_val) { return false; }
@@ -392,7 +723,7 @@ public:
 
                     // possible partial last word
                     if (bits_remaining > 0) {
-                        const word_t mask{static_cast< word_t >(consecutive_bitmask[bits_remaining - 1])};
+                        const word_t mask{word_consecutive_bitmask< word_t >(bits_remaining)};
                         const word_t lhs_val{lhs_word_ptr->to_integer() & mask};
                         const word_t rhs_val{rhs_word_ptr->to_integer() & mask};
                         if (lhs_val != rhs_val) { return false; }
@@ -400,13 +731,13 @@ public:
                 } else {
                     // differing offsets
                     const uint8_t lhs_valid_low_bits{static_cast< uint8_t >(word_size() - lhs_offset)};
-                    const word_t lhs_low_mask{static_cast< word_t >(consecutive_bitmask[lhs_valid_low_bits - 1])};
+                    const word_t lhs_low_mask{word_consecutive_bitmask< word_t >(lhs_valid_low_bits)};
                     const uint8_t rhs_valid_low_bits{static_cast< uint8_t >(word_size() - rhs_offset)};
-                    const word_t rhs_low_mask{static_cast< word_t >(consecutive_bitmask[rhs_valid_low_bits - 1])};
+                    const word_t rhs_low_mask{word_consecutive_bitmask< word_t >(rhs_valid_low_bits)};
                     const word_t lhs_high_mask{
-                        static_cast< word_t >((lhs_offset == 0) ? 0 : consecutive_bitmask[lhs_offset - 1])};
+                        static_cast< word_t >((lhs_offset == 0) ? 0 : word_consecutive_bitmask< word_t >(lhs_offset))};
                     const word_t rhs_high_mask{
-                        static_cast< word_t >((rhs_offset == 0) ? 0 : consecutive_bitmask[rhs_offset - 1])};
+                        static_cast< word_t >((rhs_offset == 0) ? 0 : word_consecutive_bitmask< word_t >(rhs_offset))};
 
                     // compare whole words
                     while (bits_remaining >= word_size()) {
@@ -429,13 +760,13 @@ public:
                     if (bits_remaining > 0) {
                         // compare partial last word
                         word_t lhs_val{(lhs_word_ptr++)->to_integer()}, rhs_val{(rhs_word_ptr++)->to_integer()};
-                        const word_t mask{static_cast< word_t >(consecutive_bitmask[bits_remaining - 1])};
+                        const word_t mask{word_consecutive_bitmask< word_t >(bits_remaining)};
                         if (lhs_offset > 0) {
                             if (bits_remaining <= lhs_valid_low_bits) {
                                 lhs_val = static_cast< word_t >(lhs_val >> lhs_offset) & mask;
                             } else {
-                                const word_t mask{static_cast< word_t >(
-                                    consecutive_bitmask[bits_remaining - lhs_valid_low_bits - 1])};
+                                const word_t mask{
+                                    word_consecutive_bitmask< word_t >(bits_remaining - lhs_valid_low_bits)};
                                 lhs_val = (static_cast< word_t >(lhs_val >> lhs_offset) & lhs_low_mask) |
                                     static_cast< word_t >((lhs_word_ptr->to_integer() & mask) << lhs_valid_low_bits);
                             }
@@ -446,8 +777,8 @@ public:
                             if (bits_remaining <= rhs_valid_low_bits) {
                                 rhs_val = static_cast< word_t >(rhs_val >> rhs_offset) & mask;
                             } else {
-                                const word_t mask{static_cast< word_t >(
-                                    consecutive_bitmask[bits_remaining - rhs_valid_low_bits - 1])};
+                                const word_t mask{
+                                    word_consecutive_bitmask< word_t >(bits_remaining - rhs_valid_low_bits)};
                                 rhs_val = (static_cast< word_t >(rhs_val >> rhs_offset) & rhs_low_mask) |
                                     static_cast< word_t >((rhs_word_ptr->to_integer() & mask) << rhs_valid_low_bits);
                             }
@@ -465,6 +796,168 @@ public:
 
     bool operator!=(const BitsetImpl& rhs) const { return !(operator==(rhs)); }
 
+    /**
+     * @brief Apply the bitwise operation with the other bitset in place, i.e. this = this <op> other. Bits are matched
+     * by their position from the start of each bitset, so both bitsets can have different shifts (via shrink_head).
+     * Bits beyond the size of other bitset are treated as reset in other. Size of this bitset is not changed. When
+     * both bitsets have the same word alignment, whole words are operated in bulk using vector instructions.
+     *
+     * @param other Bitset to operate with
+     * @param op Bitwise operation to apply
+     * @return Reference to this bitset
+     */
+    BitsetImpl& apply(const BitsetImpl& other, const bitwise_op op) {
+        if (this == &other) {
+            // Same bitset, cannot take the lock again. and/or are no-op, xor/andnot clears everything
+            if ((op == bitwise_op::op_xor) || (op == bitwise_op::op_andnot)) {
+                if (total_bits() > 0) { reset_bits(0, total_bits()); }
+            }
+            return *this;
+        }
+
+        ReadLockGuard lock{this};
+        ReadLockGuard other_lock{&other};
+        const uint64_t nbits{total_bits()};
+        if (nbits == 0) { return *this; }
+
+        const bool aligned{get_word_offset(0) == other.get_word_offset(0)};
+        bitword_type* word_ptr{get_word(0)};
+        uint8_t offset{get_word_offset(0)};
+        uint64_t current_bit{0};
+        while (current_bit < nbits) {
+            if constexpr (s_raw_word_scan) {
+                if (aligned && (offset == 0)) {
+                    const uint64_t nwords{std::min(nbits - current_bit, other.bits_after(current_bit)) / word_size()};
+                    if (nwords > 0) {
+                        const auto* const other_words{
+                            reinterpret_cast< const uint64_t* >(other.get_word_const(current_bit))};
+                        apply_words_bulk(reinterpret_cast< uint64_t* >(word_ptr), other_words, nwords, op);
+                        word_ptr += nwords;
+                        current_bit += nwords * word_size();
+                        continue;
+                    }
+                }
+            }
+
+            const uint8_t count{
+                static_cast< uint8_t >(std::min< uint64_t >(word_size() - offset, nbits - current_bit))};
+            const word_t mask{static_cast< word_t >(word_consecutive_bitmask< word_t >(count) << offset)};
+            const word_t rhs_val{static_cast< word_t >(other.extract_bits(current_bit, count) << offset)};
+            switch (op) {
+            case bitwise_op::op_and:
+                word_ptr->and_with(static_cast< word_t >(rhs_val | ~mask));
+                break;
+            case bitwise_op::op_or:
+                word_ptr->or_with(rhs_val);
+                break;
+            case bitwise_op::op_xor:
+                word_ptr->xor_with(rhs_val);
+                break;
+            case bitwise_op::op_andnot:
+                word_ptr->and_with(static_cast< word_t >(~rhs_val));
+                break;
+            }
+
+            current_bit += count;
+            offset = 0;
+            ++word_ptr;
+        }
+
+        // Bits beyond the size of other bitset are modified only by and
+        const uint64_t modified_bits{(op == bitwise_op::op_and) ? nbits : std::min(nbits, other.total_bits())};
+        update_summary(0, modified_bits);
+        mark_dirty(0, modified_bits);
+        return *this;
+    }
+
+    BitsetImpl& and_with(const BitsetImpl& other) { return apply(other, bitwise_op::op_and); }
+    BitsetImpl& or_with(const BitsetImpl& other) { return apply(other, bitwise_op::op_or); }
+    BitsetImpl& xor_with(const BitsetImpl& other) { return apply(other, bitwise_op::op_xor); }
+    BitsetImpl& andnot_with(const BitsetImpl& other) { return apply(other, bitwise_op::op_andnot); }
+
+    BitsetImpl& operator&=(const BitsetImpl& other) { return apply(other, bitwise_op::op_and); }
+    BitsetImpl& operator|=(const BitsetImpl& other) { return apply(other, bitwise_op::op_or); }
+    BitsetImpl& operator^=(const BitsetImpl& other) { return apply(other, bitwise_op::op_xor); }
+
+    /**
+     * @brief Create a new bitset which is the result of this <op> other. Result has the same size as this bitset.
+     * See apply() for the details of how the bits are matched.
+     */
+    BitsetImpl bitwise(const BitsetImpl& other, const bitwise_op op) const {
+        BitsetImpl result{};
+        result.copy(*this);
+        result.apply(other, op);
+        return result;
+    }
+
+    /**
+     * @brief Count of bits which would be set in the result of this <op> other, without creating the result. See
+     * apply() for the details of how the bits are matched.
+     *
+     * @param other Bitset to operate with
+     * @param op Bitwise operation
+     * @return uint64_t Total number of bits set in the result
+     */
+    uint64_t get_set_count(const BitsetImpl& other, const bitwise_op op) const {
+        if (this == &other) {
+            return ((op == bitwise_op::op_and) || (op == bitwise_op::op_or)) ? get_set_count() : 0;
+        }
+
+        ReadLockGuard lock{this};
+        ReadLockGuard other_lock{&other};
+        const uint64_t nbits{total_bits()};
+        if (nbits == 0) { return 0; }
+
+        const bool aligned{get_word_offset(0) == other.get_word_offset(0)};
+        const bitword_type* word_ptr{get_word_const(0)};
+        uint8_t offset{get_word_offset(0)};
+        uint64_t current_bit{0};
+        uint64_t set_cnt{0};
+        while (current_bit < nbits) {
+            if constexpr (s_raw_word_scan) {
+                if (aligned && (offset == 0)) {
+                    const uint64_t nwords{std::min(nbits - current_bit, other.bits_after(current_bit)) / word_size()};
+                    if (nwords > 0) {
+                        const auto* const other_words{
+                            reinterpret_cast< const uint64_t* >(other.get_word_const(current_bit))};
+                        set_cnt += count_words_bulk(reinterpret_cast< const uint64_t* >(word_ptr), other_words, nwords,
+                                                    op);
+                        word_ptr += nwords;
+                        current_bit += nwords * word_size();
+                        continue;
+                    }
+                }
+            }
+
+            const uint8_t count{
+                static_cast< uint8_t >(std::min< uint64_t >(word_size() - offset, nbits - current_bit))};
+            const word_t mask{word_consecutive_bitmask< word_t >(count)};
+            const word_t lhs_val{static_cast< word_t >(static_cast< word_t >(word_ptr->to_integer() >> offset) & mask)};
+            const word_t rhs_val{other.extract_bits(current_bit, count)};
+            word_t result{};
+            switch (op) {
+            case bitwise_op::op_and:
+                result = lhs_val & rhs_val;
+                break;
+            case bitwise_op::op_or:
+                result = lhs_val | rhs_val;
+                break;
+            case bitwise_op::op_xor:
+                result = lhs_val ^ rhs_val;
+                break;
+            case bitwise_op::op_andnot:
+                result = lhs_val & static_cast< word_t >(~rhs_val);
+                break;
+            }
+            set_cnt += get_set_bit_count(result);
+
+            current_bit += count;
+            offset = 0;
+            ++word_ptr;
+        }
+        return set_cnt;
+    }
+
     uint64_t get_id() const {
         ReadLockGuard lock{this};
         assert(m_s);
@@ -477,16 +970,29 @@ public:
         m_s->m_id = id;
     }
 
-    // create deep copy of other bitset
+    // create deep copy of other bitset. If this bitset is backed by a file, the copy is written to a replacement file
+    // which atomically takes the place of the backing file, unless other bitset is backed by the same file. In that
+    // case (or if the file was already replaced through another shallow copy), it is detached from the file and the
+    // copy is held in memory.
     void copy(const BitsetImpl& other) {
         if (this == &other) return;
         {
             WriteLockGuard lock{this};
             {
                 ReadLockGuard other_lock{&other};
-                // ensure distinct buffers
-                if ((m_buf->size != other.m_buf->size) || (m_buf == other.m_buf)) {
-                    m_buf = make_byte_array_with_deleter(other.m_buf->size, other.m_s->m_alignment_size);
+                const uint64_t size{other.buf_size()};
+                if (owns_file() && (m_mapped != other.m_mapped)) {
+                    auto [file, buf]{create_replacement_file(size)};
+                    auto new_s{new (buf->bytes) bitset_serialized{other.m_s->m_id, other.m_s->m_nbits,
+                                                                  other.m_s->m_skip_bits, other.m_s->m_alignment_size,
+                                                                  false}};
+                    std::copy(other.m_s->get_words_const(), other.m_s->end_words_const(), new_s->get_words());
+                    commit_replacement_file(std::move(file), std::move(buf));
+                    m_s = new_s;
+                } else if ((buf_size() != size) || (m_buf == other.m_buf) || m_mapped) {
+                    // ensure distinct buffers
+                    m_buf = make_byte_array_with_deleter(checked_blob_size(size), other.m_s->m_alignment_size);
+                    m_mapped.reset();
                     m_s = new (m_buf->bytes)
                         bitset_serialized{other.m_s->m_id, other.m_s->m_nbits, other.m_s->m_skip_bits,
                                           other.m_s->m_alignment_size, false};
@@ -519,6 +1025,8 @@ public:
                         std::copy(other.m_s->get_words_const(), other.m_s->end_words_const(), m_s->get_words());
                     }
                 }
+                rebuild_summary();
+                mark_all_dirty();
             }
         }
     }
@@ -536,8 +1044,15 @@ public:
                 // ensure distinct buffers
                 bool uninitialized{false};
                 const auto old_words_cap{m_s->m_words_cap};
-                if ((m_buf->size != size) || (m_buf == other.m_buf)) {
-                    m_buf = make_byte_array_with_deleter(size, alignment_size);
+                std::shared_ptr< mapped_file_info > file;
+                if (owns_file() && (m_mapped != other.m_mapped)) {
+                    // Keep the words in the file, written to its replacement
+                    std::tie(file, m_buf) = create_replacement_file(size);
+                    uninitialized = true;
+                } else if ((buf_size() != size) || (m_buf == other.m_buf) || m_mapped) {
+                    // ensure distinct buffers
+                    m_buf = make_byte_array_with_deleter(checked_blob_size(size), alignment_size);
+                    m_mapped.reset();
                     uninitialized = true;
                 }
                 m_s = new (m_buf->bytes) bitset_serialized{other.m_s->m_id, nbits, 0, alignment_size, false};
@@ -570,8 +1085,8 @@ public:
                     uint64_t bits_remaining{nbits};
                     const uint8_t rhs_low_bits{
                         static_cast< uint8_t >(static_cast< uint8_t >(word_size() - rhs_offset))};
-                    const word_t rhs_low_mask{static_cast< word_t >(consecutive_bitmask[rhs_low_bits - 1])};
-                    const word_t rhs_high_mask{static_cast< word_t >(consecutive_bitmask[rhs_offset - 1])};
+                    const word_t rhs_low_mask{word_consecutive_bitmask< word_t >(rhs_low_bits)};
+                    const word_t rhs_high_mask{word_consecutive_bitmask< word_t >(rhs_offset)};
                     // copy whole words
                     while (bits_remaining >= word_size()) {
                         const word_t val{
@@ -595,12 +1110,12 @@ public:
                     // copy partial last word
                     if (bits_remaining > 0) {
                         word_t val{(rhs_word_ptr++)->to_integer()};
-                        const word_t mask{static_cast< word_t >(consecutive_bitmask[bits_remaining - 1])};
+                        const word_t mask{word_consecutive_bitmask< word_t >(bits_remaining)};
                         if (bits_remaining <= rhs_low_bits) {
                             val = static_cast< word_t >(val >> rhs_offset) & mask;
                         } else {
                             const word_t mask{
-                                static_cast< word_t >(consecutive_bitmask[bits_remaining - rhs_low_bits - 1])};
+                                word_consecutive_bitmask< word_t >(bits_remaining - rhs_low_bits)};
                             val = (static_cast< word_t >(val >> rhs_offset) & rhs_low_mask) |
                                 (static_cast< word_t >(rhs_word_ptr->to_integer() & mask) << rhs_low_bits);
                         }
@@ -623,6 +1138,9 @@ public:
                         }
                     }
                 }
+                if (file) { commit_replacement_file(std::move(file), m_buf); }
+                rebuild_summary();
+                mark_all_dirty();
             }
         }
     }
@@ -648,6 +1166,7 @@ public:
             (sizeof(value_type) == sizeof(bitword_type)) && (alignment_size == m_s->m_alignment_size) && !force_copy) {
             // underlying BitWord class is standard layout and same alignment
             // so return the underlying byte_array
+            checked_blob_size(buf_size());
             return m_buf;
         } else {
             // underlying BitWord is not standard layout or different alignment or copy
@@ -667,20 +1186,20 @@ public:
                         delete ptr;
                     }
                 }}};
-            word_t* word_ptr{reinterpret_cast< word_t* >(buf->bytes + sizeof(bitset_serialized))};
+            bitword_type* word_ptr{reinterpret_cast< bitword_type* >(buf->bytes + sizeof(bitset_serialized))};
             if (std::is_standard_layout_v< bitword_type > && std::is_trivial_v< value_type > &&
                 (sizeof(value_type) == sizeof(bitword_type))) {
                 const size_t num_words{static_cast< size_t >(m_s->end_words_const() - get_word_const(0))};
                 const uint64_t skip_bits{get_word_offset(0)};
                 new (buf->bytes) bitset_serialized{m_s->m_id, num_bits + skip_bits, skip_bits, alignment_size, false};
                 std::memcpy(static_cast< void* >(word_ptr), static_cast< const void* >(get_word_const(0)),
-                            num_words * sizeof(word_t));
+                            num_words * sizeof(bitword_type));
             } else {
                 // non trivial, word by word copy the unshifted data words
                 new (buf->bytes) bitset_serialized{m_s->m_id, num_bits, 0, alignment_size, false};
                 uint64_t current_bit{0};
                 for (uint64_t word_num{0}; word_num < total_words; ++word_num, ++word_ptr, current_bit += word_size()) {
-                    new (word_ptr) word_t{get_word_value(current_bit)};
+                    new (word_ptr) bitword_type{get_word_value(current_bit)};
                 }
             }
             return buf;
@@ -702,7 +1221,7 @@ public:
             (sizeof(value_type) == sizeof(bitword_type)) && (alignment_size == m_s->m_alignment_size) && !force_copy) {
             // underlying BitWord class is standard layout and same alignment
             // so return the underlying byte_array
-            return static_cast< uint64_t >(m_buf->size());
+            return buf_size();
         } else {
             // underlying BitWord is not standard layout or different alignment or copy
             const uint64_t num_bits{total_bits()};
@@ -714,122 +1233,586 @@ public:
     }
 
     /**
-     * @brief Get total bits available in this bitset
+     * @brief Serialize the bitset in compressed format, where every chunk of 64K bits is encoded as empty, full, runs
+     * of set bits or the raw bits, whichever is the smallest. For large bitsets which are mostly set or reset, this is
+     * much smaller than serialize(). Bitset can be loaded back using the constructor with compressed_tag.
      *
-     * @return uint64_t
+     * @param opt_alignment_size Alignment of the returned buffer, defaults to the alignment of the bitset
+     * @return sisl::byte_array Newly allocated buffer with the compressed bitset
      */
-    uint64_t size() const {
+    sisl::byte_array serialize_compressed(const std::optional< uint32_t > opt_alignment_size =
+                                              std::optional< uint32_t >{}) const {
         ReadLockGuard lock{this};
-        const auto ret{total_bits()};
-        return ret;
+        assert(m_s);
+        const uint32_t alignment_size{opt_alignment_size ? (*opt_alignment_size) : m_s->m_alignment_size};
+        const uint64_t nbits{total_bits()};
+        std::array< uint64_t, compressed_chunk_groups > groups;
+
+        // First pass to find out the size of each chunk
+        std::vector< compressed_chunk_info > chunks;
+        chunks.reserve(static_cast< size_t >((nbits + compressed_chunk_bits - 1) / compressed_chunk_bits));
+        uint64_t total_bytes{sizeof(compressed_header)};
+        for (uint64_t chunk_start{0}; chunk_start < nbits; chunk_start += compressed_chunk_bits) {
+            const uint64_t chunk_bits{std::min(compressed_chunk_bits, nbits - chunk_start)};
+            load_chunk_groups(chunk_start, chunk_bits, groups.data());
+            chunks.push_back(analyze_chunk(chunk_bits, groups));
+            total_bytes += compressed_chunk_size(chunks.back(), chunk_bits);
+        }
+
+        const uint64_t size{(alignment_size > 0) ? round_up(total_bytes, alignment_size) : total_bytes};
+        auto buf{make_byte_array(checked_blob_size(size), alignment_size, buftag::bitset)};
+        uint8_t* cur{buf->bytes};
+        compressed_header hdr{};
+        hdr.m_id = m_s->m_id;
+        hdr.m_nbits = nbits;
+        hdr.m_alignment_size = m_s->m_alignment_size;
+        cur = write_serialized_value(cur, hdr);
+
+        uint64_t chunk_start{0};
+        for (const auto& chunk : chunks) {
+            const uint64_t chunk_bits{std::min(compressed_chunk_bits, nbits - chunk_start)};
+            cur = write_serialized_value(cur, static_cast< uint8_t >(chunk.type));
+            if (chunk.type == compressed_chunk_type::runs) {
+                load_chunk_groups(chunk_start, chunk_bits, groups.data());
+                cur = write_serialized_value(cur, chunk.nruns);
+                uint64_t bit{0};
+                while (true) {
+                    const uint64_t run_start{next_chunk_bit(groups, bit, chunk_bits, true)};
+                    if (run_start == chunk_bits) { break; }
+                    bit = next_chunk_bit(groups, run_start, chunk_bits, false);
+                    cur = write_serialized_value(cur, static_cast< uint16_t >(run_start));
+                    cur = write_serialized_value(cur, static_cast< uint16_t >(bit - run_start - 1));
+                }
+            } else if (chunk.type == compressed_chunk_type::dense) {
+                load_chunk_groups(chunk_start, chunk_bits, groups.data());
+                const uint64_t ngroups{(chunk_bits + 63) / 64};
+                std::memcpy(cur, groups.data(), ngroups * sizeof(uint64_t));
+                cur += ngroups * sizeof(uint64_t);
+            }
+            chunk_start += chunk_bits;
+        }
+        // Zero out the alignment padding, since the buffer is typically written as is
+        std::memset(cur, 0, static_cast< size_t >(size - total_bytes));
+        return buf;
     }
 
     /**
-     * @brief Get the number of bits set in the range [start_bit, end_bit] inclusive
-     *
-     * @param start_bit Start bit to search from
-     * @param end_bit End bit to search to inclusive; if larger than total bits to end
+     * @brief Return the bytes it will have upon serializing in compressed format. Callers can compare this with
+     * serialized_size() to pick the cheaper format. It costs a full scan of the bitset.
      *
-     * @return returns the number of bits set
+     * @return uint64_t
      */
-    uint64_t get_set_count(const uint64_t start_bit = 0,
-                           const uint64_t end_bit = std::numeric_limits< uint64_t >::max()) const {
+    uint64_t compressed_serialized_size(const std::optional< uint32_t > opt_alignment_size =
+                                            std::optional< uint32_t >{}) const {
         ReadLockGuard lock{this};
-        assert(end_bit >= start_bit);
-        const uint64_t last_bit{std::min(total_bits() - 1, end_bit)};
-        const uint64_t num_bits{last_bit - start_bit + 1};
-
-        // get first word count which may be partial and we assume that at least 1 word worth of bits
-        uint64_t set_cnt{0};
-        const bitword_type* word_ptr{get_word_const(start_bit)};
-        if (!word_ptr) { return set_cnt; }
-        const uint8_t offset{get_word_offset(start_bit)};
-        if ((offset + num_bits) <= word_size()) {
-            // all bits in first word
-            const word_t mask{consecutive_bitmask[num_bits - 1]};
-            set_cnt += get_set_bit_count((word_ptr->to_integer() >> offset) & mask);
-        } else {
-            set_cnt += get_set_bit_count(word_ptr->to_integer() >> offset);
-
-            // count rest of words
-            const uint64_t word_skip_bits{static_cast< uint64_t >(word_size() - offset)};
-            uint64_t bits_remaining{word_skip_bits >= num_bits ? 0 : num_bits - word_skip_bits};
-            while (bits_remaining >= word_size()) {
-                set_cnt += (++word_ptr)->get_set_count();
-                bits_remaining -= word_size();
-            }
-
-            // count last possibly partial word
-            if (bits_remaining > 0) {
-                const word_t mask{consecutive_bitmask[bits_remaining - 1]};
-                set_cnt += get_set_bit_count(((++word_ptr)->to_integer()) & mask);
-            }
+        assert(m_s);
+        const uint32_t alignment_size{opt_alignment_size ? (*opt_alignment_size) : m_s->m_alignment_size};
+        const uint64_t nbits{total_bits()};
+        std::array< uint64_t, compressed_chunk_groups > groups;
+
+        uint64_t total_bytes{sizeof(compressed_header)};
+        for (uint64_t chunk_start{0}; chunk_start < nbits; chunk_start += compressed_chunk_bits) {
+            const uint64_t chunk_bits{std::min(compressed_chunk_bits, nbits - chunk_start)};
+            load_chunk_groups(chunk_start, chunk_bits, groups.data());
+            total_bytes += compressed_chunk_size(analyze_chunk(chunk_bits, groups), chunk_bits);
         }
-        return set_cnt;
+        return (alignment_size > 0) ? round_up(total_bytes, alignment_size) : total_bytes;
     }
 
     /**
-     * @brief Set the bit. If the bit is outside the available range throws std::out_of_range exception
+     * @brief Start tracking the pages of the bitset modified from now on, so that only those pages can be persisted
+     * using serialize_delta(). It is expected that the caller has persisted the entire bitset before enabling it.
+     * Tracking costs an additional atomic update of the dirty page bitmap on every set/reset.
      *
-     * @param b Bit to set
+     * @param page_bits Granularity of tracking in bits, needs to be multiple of 64. Default is 4KiB worth of words.
      */
-    void set_bit(const uint64_t start) { set_reset_bit(start, true); }
+    void enable_dirty_tracking(const uint64_t page_bits = default_dirty_page_bits) {
+        WriteLockGuard lock{this};
+        assert(m_s);
+        assert((page_bits > 0) && ((page_bits % 64) == 0));
+        m_dirty = std::make_shared< dirty_tracker >(page_bits, total_bits());
+    }
 
-    /**
-     * @brief Set multiple bits. If the bit is outside the available range throws std::out_of_range exception
-     *
-     * @param start Starting bit of the sequence to set
-     * @param nbits Total number of bits from starting bit
-     */
-    void set_bits(const uint64_t start, const uint64_t nbits) { set_reset_bits(start, nbits, true); }
+    void disable_dirty_tracking() {
+        WriteLockGuard lock{this};
+        m_dirty.reset();
+    }
 
-    /**
-     * @brief Reset the bit. If the bit is outside the available range throws std::out_of_range exception
-     *
-     * @param start Bit to reset
-     */
-    void reset_bit(const uint64_t start) { set_reset_bit(start, false); }
+    bool is_dirty_tracking_enabled() const {
+        ReadLockGuard lock{this};
+        return (m_dirty != nullptr);
+    }
 
     /**
-     * @brief Reset multiple bits. If the bit is outside the available range throws std::out_of_range exception
-     *
-     * @param start Starting bit of the sequence to reset
-     * @param nbits Total number of bits from starting bit
+     * @brief Index the runs of reset bits by their size, for the bitsets searched often with
+     * get_best_fit_contiguous_n_reset_bits(). The index is built on the next search, from then on every set/reset
+     * additionally marks the modified blocks in a bitmap by an atomic update. Not expected to be called concurrently
+     * with the writes of this bitset.
      */
-    void reset_bits(const uint64_t start, const uint64_t nbits) { set_reset_bits(start, nbits, false); }
+    void enable_free_run_index() {
+        WriteLockGuard lock{this};
+        assert(m_s);
+        if (!m_free_runs) { m_free_runs = std::make_shared< free_run_index >(total_bits()); }
+    }
+
+    void disable_free_run_index() {
+        WriteLockGuard lock{this};
+        m_free_runs.reset();
+    }
+
+    bool is_free_run_index_enabled() const {
+        ReadLockGuard lock{this};
+        return (m_free_runs != nullptr);
+    }
 
     /**
-     * @brief Is a particular bit is set/reset. If the bit is outside the available range throws std::out_of_range
-     * exception
+     * @brief Get the number of pages that will be part of the next serialize_delta()
      *
-     * @param start Starting bit of the sequence to check
-     * @param nbits Total number of bits from starting bit
+     * @return uint64_t
      */
-    bool is_bits_set(const uint64_t start, const uint64_t nbits) const { return is_bits_set_reset(start, nbits, true); }
-    bool is_bits_reset(const uint64_t start, const uint64_t nbits) const {
-        return is_bits_set_reset(start, nbits, false);
+    uint64_t get_dirty_page_count() const {
+        ReadLockGuard lock{this};
+        const uint64_t page_bits{m_dirty ? m_dirty->m_page_bits : default_dirty_page_bits};
+        const uint64_t npages{(total_bits() + page_bits - 1) / page_bits};
+        if (!m_dirty || m_dirty->m_all_dirty.load(std::memory_order_acquire)) { return npages; }
+
+        uint64_t count{0};
+        for (const auto& page_word : m_dirty->m_pages) {
+            count += get_set_bit_count(page_word.load(std::memory_order_acquire));
+        }
+        return count;
     }
 
     /**
-     * @brief Get the value of the bit
+     * @brief Serialize only the pages modified since the previous serialize_delta() (or enable_dirty_tracking()) and
+     * clear them. Modifications made concurrently with this call are either part of this delta or marked for the next
+     * one. If the bits were moved around since then (shrink_head, resize, copy) or tracking is not enabled, it
+     * serializes all the pages. The delta can be applied on a copy of the bitset as of the previous delta, using
+     * apply_delta().
      *
-     * @param b Bit to get the value of
-     * @return true or false based on if bit is set or reset respectively
+     * @param opt_alignment_size Alignment of the returned buffer, defaults to the alignment of the bitset
+     * @return sisl::byte_array Newly allocated buffer with the delta
      */
-    bool get_bitval(const uint64_t bit) const {
+    sisl::byte_array serialize_delta(const std::optional< uint32_t > opt_alignment_size =
+                                         std::optional< uint32_t >{}) {
         ReadLockGuard lock{this};
-        assert(m_s->valid_bit(bit));
+        assert(m_s);
+        const uint32_t alignment_size{opt_alignment_size ? (*opt_alignment_size) : m_s->m_alignment_size};
+        const uint64_t nbits{total_bits()};
+        const uint64_t page_bits{m_dirty ? m_dirty->m_page_bits : default_dirty_page_bits};
+        const uint64_t total_pages{(nbits + page_bits - 1) / page_bits};
+
+        // Clear the dirty pages before reading them, so that any modification after this is marked for the next delta
+        const bool full{!m_dirty || m_dirty->m_all_dirty.exchange(false, std::memory_order_acq_rel)};
+        std::vector< uint64_t > pages;
+        if (m_dirty) {
+            for (uint64_t w{0}; w < m_dirty->m_pages.size(); ++w) {
+                uint64_t dirty{m_dirty->m_pages[w].exchange(0, std::memory_order_acq_rel)};
+                while (!full && (dirty != 0)) {
+                    const uint64_t page{w * 64 + get_trailing_zeros(dirty)};
+                    if (page < total_pages) { pages.push_back(page); }
+                    dirty &= (dirty - 1);
+                }
+            }
+        }
+        if (full) {
+            pages.resize(total_pages);
+            std::iota(std::begin(pages), std::end(pages), 0);
+        }
 
-        const bitword_type* word_ptr{get_word_const(bit)};
-        if (!word_ptr) { return false; }
-        const uint8_t offset{get_word_offset(bit)};
-        const bool ret{word_ptr->get_bitval(offset)};
+        const auto page_nbits{[&nbits, &page_bits](const uint64_t page) {
+            return std::min(page_bits, nbits - page * page_bits);
+        }};
+        uint64_t total_bytes{sizeof(delta_header)};
+        for (const auto page : pages) {
+            total_bytes += sizeof(uint64_t) + ((page_nbits(page) + 63) / 64) * sizeof(uint64_t);
+        }
 
-        return ret;
+        const uint64_t size{(alignment_size > 0) ? round_up(total_bytes, alignment_size) : total_bytes};
+        auto buf{make_byte_array(checked_blob_size(size), alignment_size, buftag::bitset)};
+        uint8_t* cur{buf->bytes};
+        delta_header hdr{};
+        hdr.m_nbits = nbits;
+        hdr.m_page_bits = page_bits;
+        hdr.m_npages = pages.size();
+        hdr.m_full = full ? 1 : 0;
+        cur = write_serialized_value(cur, hdr);
+
+        std::vector< uint64_t > groups((page_bits + 63) / 64);
+        for (const auto page : pages) {
+            const uint64_t ngroups{(page_nbits(page) + 63) / 64};
+            load_chunk_groups(page * page_bits, page_nbits(page), groups.data());
+            cur = write_serialized_value(cur, page);
+            std::memcpy(cur, groups.data(), ngroups * sizeof(uint64_t));
+            cur += ngroups * sizeof(uint64_t);
+        }
+        std::memset(cur, 0, static_cast< size_t >(size - total_bytes));
+        return buf;
     }
 
     /**
-     * @brief Get the next set bit from given bit
+     * @brief Apply the delta created by serialize_delta() of another bitset. The bitset is resized to the size of the
+     * source bitset if they differ. Not expected to be called concurrently with resize of this bitset. Throws
+     * std::out_of_range if the delta is corrupted.
+     *
+     * @param b Buffer returned by serialize_delta()
+     */
+    void apply_delta(const sisl::byte_array& b) {
+        if (b->size < sizeof(delta_header)) { throw std::out_of_range("Bitset delta buffer is truncated"); }
+        const uint8_t* cur{b->bytes};
+        const uint8_t* const end{b->bytes + b->size};
+        const auto hdr{read_serialized_value< delta_header >(cur, end)};
+        if ((hdr.m_magic != delta_header::s_magic) || (hdr.m_version != delta_header::s_version) ||
+            (hdr.m_page_bits == 0) || ((hdr.m_page_bits % 64) != 0)) {
+            throw std::out_of_range("Buffer is not a bitset delta");
+        }
+        if (hdr.m_nbits > (uint64_t{mapped_byte_array_impl::max_blob_size} * 8)) {
+            throw std::out_of_range("Bitset delta is larger than the max byte array size");
+        }
+        checked_blob_size(bitset_serialized::nbytes(hdr.m_nbits));
+
+        // Validate all the pages before modifying anything, so that a corrupted delta is never partially applied
+        const uint64_t total_pages{(hdr.m_nbits / hdr.m_page_bits) + (((hdr.m_nbits % hdr.m_page_bits) > 0) ? 1 : 0)};
+        const auto page_ngroups{[&hdr](const uint64_t page) {
+            return (std::min(hdr.m_page_bits, hdr.m_nbits - page * hdr.m_page_bits) + 63) / 64;
+        }};
+        if (hdr.m_npages > (static_cast< uint64_t >(end - cur) / (2 * sizeof(uint64_t)))) {
+            throw std::out_of_range("Bitset delta buffer is truncated");
+        }
+        const uint8_t* page_cur{cur};
+        for (uint64_t i{0}; i < hdr.m_npages; ++i) {
+            const uint64_t page{read_serialized_value< uint64_t >(page_cur, end)};
+            if (page >= total_pages) { throw std::out_of_range("Bitset delta page beyond the bitset size"); }
+            if ((page_ngroups(page) * sizeof(uint64_t)) > static_cast< uint64_t >(end - page_cur)) {
+                throw std::out_of_range("Bitset delta buffer is truncated");
+            }
+            page_cur += page_ngroups(page) * sizeof(uint64_t);
+        }
+
+        if (hdr.m_nbits != size()) { resize(hdr.m_nbits); }
+
+        ReadLockGuard lock{this};
+        std::vector< uint64_t > groups((std::min(hdr.m_page_bits, hdr.m_nbits) + 63) / 64);
+        for (uint64_t i{0}; i < hdr.m_npages; ++i) {
+            const uint64_t page{read_serialized_value< uint64_t >(cur, end)};
+            const uint64_t page_start{page * hdr.m_page_bits};
+            const uint64_t page_nbits{std::min(hdr.m_page_bits, hdr.m_nbits - page_start)};
+            for (uint64_t g{0}; g < page_ngroups(page); ++g) {
+                groups[g] = read_serialized_value< uint64_t >(cur, end);
+            }
+            store_bits(page_start, groups.data(), page_nbits);
+            update_summary(page_start, page_nbits);
+            mark_dirty(page_start, page_nbits);
+        }
+    }
+
+    bool is_file_backed() const {
+        ReadLockGuard lock{this};
+        return owns_file();
+    }
+
+    /**
+     * @brief Write the modified pages of a file backed bitset to the file. If sync is false, the writes are only
+     * scheduled and it returns without waiting for them. No-op for the bitset held in memory.
+     */
+    void flush(const bool sync = true) const {
+        ReadLockGuard lock{this};
+        if (!m_mapped) { return; }
+        if (::msync(m_buf->bytes, buf_size(), sync ? MS_SYNC : MS_ASYNC) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Unable to flush bitset file " + m_mapped->m_path);
+        }
+    }
+
+    enum class access_advice : uint8_t { normal, sequential, random, will_need, dont_need };
+
+    /**
+     * @brief Hint the OS about how the pages of a file backed bitset holding the given range of bits are going to be
+     * accessed. dont_need lets the OS drop the cold pages from memory, they are read back from the file on next access.
+     * No-op for the bitset held in memory.
+     */
+    void advise(const access_advice advice, const uint64_t start = 0, const uint64_t nbits = npos) const {
+        ReadLockGuard lock{this};
+        if (!m_mapped || (nbits == 0) || (start >= total_bits())) { return; }
+        const uint64_t count{std::min(nbits, total_bits() - start)};
+        const uint64_t page_size{static_cast< uint64_t >(::sysconf(_SC_PAGESIZE))};
+        const uint8_t* const start_byte{reinterpret_cast< const uint8_t* >(get_word_const(start))};
+        const uint8_t* const end_byte{
+            reinterpret_cast< const uint8_t* >(std::next(get_word_const(start + count - 1), 1))};
+        const uint64_t page_start{round_down(static_cast< uint64_t >(start_byte - m_buf->bytes), page_size)};
+        const uint64_t page_end{std::min(round_up(static_cast< uint64_t >(end_byte - m_buf->bytes), page_size),
+                                         round_up(buf_size(), page_size))};
+
+        int madv{MADV_NORMAL};
+        switch (advice) {
+        case access_advice::normal:
+            madv = MADV_NORMAL;
+            break;
+        case access_advice::sequential:
+            madv = MADV_SEQUENTIAL;
+            break;
+        case access_advice::random:
+            madv = MADV_RANDOM;
+            break;
+        case access_advice::will_need:
+            madv = MADV_WILLNEED;
+            break;
+        case access_advice::dont_need:
+            madv = MADV_DONTNEED;
+            break;
+        }
+        if (::madvise(m_buf->bytes + page_start, page_end - page_start, madv) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Unable to advise bitset file " + m_mapped->m_path);
+        }
+    }
+
+    /**
+     * @brief Get total bits available in this bitset
+     *
+     * @return uint64_t
+     */
+    uint64_t size() const {
+        ReadLockGuard lock{this};
+        const auto ret{total_bits()};
+        return ret;
+    }
+
+    /**
+     * @brief Get the number of bits set in the range [start_bit, end_bit] inclusive
+     *
+     * @param start_bit Start bit to search from
+     * @param end_bit End bit to search to inclusive; if larger than total bits to end
+     *
+     * @return returns the number of bits set
+     */
+    uint64_t get_set_count(const uint64_t start_bit = 0,
+                           const uint64_t end_bit = std::numeric_limits< uint64_t >::max()) const {
+        ReadLockGuard lock{this};
+        return get_set_count_impl(start_bit, end_bit);
+    }
+
+    /**
+     * @brief Count of set bits before the given bit, i.e. in the range [0, bit). It uses the rank index which makes it
+     * constant time, except for the first call after a write which recomputes the index from the modified bit.
+     *
+     * @param bit Bit to count upto (exclusive), if larger than total bits, counts all the set bits
+     * @return returns the number of bits set
+     */
+    uint64_t rank(const uint64_t bit) const {
+        ReadLockGuard lock{this};
+        assert(m_s);
+        const uint64_t end_bit{std::min(bit, total_bits())};
+        const auto rank_lock{lock_rank_index()};
+        const uint64_t superblock{end_bit / rank_index::superblock_bits};
+        const uint64_t superblock_start{superblock * rank_index::superblock_bits};
+        uint64_t count{m_rank->m_ranks[superblock]};
+        if (end_bit > superblock_start) { count += get_set_count_impl(superblock_start, end_bit - 1); }
+        return count;
+    }
+
+    /**
+     * @brief Get the position of the nth set bit (0 based, i.e. select(0) is the first set bit). It does a binary
+     * search of the rank index and then scans the words of one superblock.
+     *
+     * @param n Count of set bits to skip
+     * @return Position of the bit, npos if the bitset has n or less set bits
+     */
+    uint64_t select(const uint64_t n) const {
+        ReadLockGuard lock{this};
+        assert(m_s);
+        const auto rank_lock{lock_rank_index()};
+        const auto& ranks{m_rank->m_ranks};
+        if (n >= ranks.back()) { return npos; }
+
+        // Last superblock which has at most n set bits before it
+        const uint64_t superblock{
+            static_cast< uint64_t >(std::distance(ranks.cbegin(), std::upper_bound(ranks.cbegin(), ranks.cend(), n))) -
+            1};
+        uint64_t remaining{n - ranks[superblock]};
+        const uint64_t nbits{total_bits()};
+        for (uint64_t bit{superblock * rank_index::superblock_bits}; bit < nbits; bit += word_size()) {
+            const uint8_t count{static_cast< uint8_t >(std::min< uint64_t >(word_size(), nbits - bit))};
+            word_t val{extract_bits(bit, count)};
+            const uint64_t set_count{get_set_bit_count(val)};
+            if (remaining < set_count) {
+                for (; remaining > 0; --remaining) {
+                    val = static_cast< word_t >(val & (val - 1));
+                }
+                return bit + get_trailing_zeros(val);
+            }
+            remaining -= set_count;
+        }
+        return npos;
+    }
+
+    /**
+     * @brief Set the bit. If the bit is outside the available range throws std::out_of_range exception
+     *
+     * @param b Bit to set
+     */
+    void set_bit(const uint64_t start) { set_reset_bit(start, true); }
+
+    /**
+     * @brief Set multiple bits. If the bit is outside the available range throws std::out_of_range exception
+     *
+     * @param start Starting bit of the sequence to set
+     * @param nbits Total number of bits from starting bit
+     */
+    void set_bits(const uint64_t start, const uint64_t nbits) { set_reset_bits(start, nbits, true); }
+
+    /**
+     * @brief Reset the bit. If the bit is outside the available range throws std::out_of_range exception
+     *
+     * @param start Bit to reset
+     */
+    void reset_bit(const uint64_t start) { set_reset_bit(start, false); }
+
+    /**
+     * @brief Reset multiple bits. If the bit is outside the available range throws std::out_of_range exception
+     *
+     * @param start Starting bit of the sequence to reset
+     * @param nbits Total number of bits from starting bit
+     */
+    void reset_bits(const uint64_t start, const uint64_t nbits) { set_reset_bits(start, nbits, false); }
+
+    /**
+     * @brief Set the bit only if it is currently reset. On AtomicBitset it is done with compare and swap, so out of
+     * many threads concurrently claiming the same bit, only one succeeds. If the bit is outside the available range
+     * throws std::out_of_range exception
+     *
+     * @param bit Bit to claim
+     * @return true if this call has set the bit, false if it was already set
+     */
+    bool try_claim_bit(const uint64_t bit) { return try_claim_bits(bit, 1); }
+
+    /**
+     * @brief Set multiple bits only if all of them are currently reset. Each word is claimed with compare and swap
+     * and if any of the words has a bit already set, the words claimed so far are rolled back. Concurrent readers
+     * could momentarily see the bits of a rolled back claim as set. If the bits are outside the available range
+     * throws std::out_of_range exception
+     *
+     * @param start Starting bit of the sequence to claim
+     * @param nbits Total number of bits from starting bit
+     * @return true if this call has set all the bits, false if any one of them was already set
+     */
+    bool try_claim_bits(const uint64_t start, const uint64_t nbits) {
+        ReadLockGuard lock{this};
+        assert(m_s);
+        if ((nbits == 0) || (start >= total_bits()) || (nbits > (total_bits() - start))) {
+            throw std::out_of_range("Claim bits not in range");
+        }
+
+        bitword_type* const first_word_ptr{get_word(start)};
+        bitword_type* word_ptr{first_word_ptr};
+        uint8_t offset{get_word_offset(start)};
+        uint64_t bits_remaining{nbits};
+        while (bits_remaining > 0) {
+            const uint8_t count{static_cast< uint8_t >(std::min< uint64_t >(bits_remaining, word_size() - offset))};
+            if (!word_ptr->try_set_bits(offset, count)) {
+                // Rollback all the words we claimed before this one, they are always claimed till the end of word
+                uint8_t rb_offset{get_word_offset(start)};
+                for (bitword_type* rb_ptr{first_word_ptr}; rb_ptr != word_ptr; ++rb_ptr) {
+                    rb_ptr->set_reset_bits(rb_offset, static_cast< uint8_t >(word_size() - rb_offset), false);
+                    rb_offset = 0;
+                }
+                // Bits were momentarily set, so anyone who looked at them in between needs to see it as modified
+                mark_dirty(start, nbits - bits_remaining);
+                return false;
+            }
+            bits_remaining -= count;
+            offset = 0;
+            ++word_ptr;
+        }
+        update_summary(start, nbits);
+        mark_dirty(start, nbits);
+        return true;
+    }
+
+    /**
+     * @brief Reset the bit only if it is currently set, which releases a bit claimed with try_claim_bit. Out of many
+     * threads concurrently releasing the same bit, only one succeeds. If the bit is outside the available range throws
+     * std::out_of_range exception
+     *
+     * @param bit Bit to release
+     * @return true if this call has reset the bit, false if it was already reset
+     */
+    bool try_release_bit(const uint64_t bit) {
+        ReadLockGuard lock{this};
+        assert(m_s);
+        if (bit >= total_bits()) { throw std::out_of_range("Release bit not in range"); }
+
+        if (!get_word(bit)->try_reset_bits(get_word_offset(bit), 1)) { return false; }
+        update_summary(bit, 1);
+        mark_dirty(bit, 1);
+        return true;
+    }
+
+    /**
+     * @brief Find the next reset bit from the start_hint and claim it. If someone else claims the bit between the
+     * search and claim, it searches again. The search wraps around to the beginning of the bitset, so start_hint can
+     * be used to spread concurrent callers across the bitset.
+     *
+     * @param start_hint Bit to start the search from
+     * @return uint64_t Bit claimed by this call or npos if there are no reset bits in the bitset
+     */
+    uint64_t try_claim_next_reset_bit(const uint64_t start_hint) {
+        const auto claimed{try_claim_next_reset_bits(start_hint, 1)};
+        return claimed.start_bit;
+    }
+
+    /**
+     * @brief Find the next n contiguous reset bits from the start_hint and claim them all, without taking any lock
+     * other than the resize lock (if ThreadSafeResizing). If someone else claims any of those bits between the search
+     * and claim, it searches again from the conflicting region. The search wraps around to the beginning of the bitset.
+     *
+     * @param start_hint Bit to start the search from
+     * @param n Number of contiguous bits to claim
+     * @return BitBlock Claimed bits, start_bit is npos if there are no n contiguous reset bits in the bitset
+     */
+    BitBlock try_claim_next_reset_bits(const uint64_t start_hint, const uint32_t n) {
+        const uint64_t nbits{size()};
+        if ((n == 0) || (n > nbits)) { return {npos, 0}; }
+
+        const uint64_t start{(start_hint < nbits) ? start_hint : 0};
+        BitBlock claimed{try_claim_next_reset_bits_in_range(start, std::nullopt, n)};
+        if ((claimed.start_bit == npos) && (start > 0)) {
+            // Wrap around and search from the beginning upto the chain which could cross the start
+            claimed = try_claim_next_reset_bits_in_range(0, std::min(start + n, nbits) - 1, n);
+        }
+        return claimed;
+    }
+
+    /**
+     * @brief Is a particular bit is set/reset. If the bit is outside the available range throws std::out_of_range
+     * exception
+     *
+     * @param start Starting bit of the sequence to check
+     * @param nbits Total number of bits from starting bit
+     */
+    bool is_bits_set(const uint64_t start, const uint64_t nbits) const { return is_bits_set_reset(start, nbits, true); }
+    bool is_bits_reset(const uint64_t start, const uint64_t nbits) const {
+        return is_bits_set_reset(start, nbits, false);
+    }
+
+    /**
+     * @brief Get the value of the bit
+     *
+     * @param b Bit to get the value of
+     * @return true or false based on if bit is set or reset respectively
+     */
+    bool get_bitval(const uint64_t bit) const {
+        ReadLockGuard lock{this};
+        assert(m_s->valid_bit(bit));
+
+        const bitword_type* word_ptr{get_word_const(bit)};
+        if (!word_ptr) { return false; }
+        const uint8_t offset{get_word_offset(bit)};
+        const bool ret{word_ptr->get_bitval(offset)};
+
+        return ret;
+    }
+
+    /**
+     * @brief Get the next set bit from given bit
      *
      * @param start_bit Start bit after which (inclusive) search for next bit is on
      * @return uint64_t Returns the next set bit, if one available, else Bitset::npos is returned
@@ -880,6 +1863,8 @@ public:
         } else {
             m_s->m_skip_bits += nbits;
             if (m_s->m_skip_bits >= compaction_threshold()) { resize_impl(total_bits(), false); }
+            if (m_rank) { m_rank->invalidate(0); }
+            mark_all_dirty();
         }
     }
 
@@ -937,6 +1922,34 @@ public:
         const uint64_t final_bit{end_bit ? std::min(*end_bit + 1, total_bits()) : total_bits()};
 
         while ((retb.nbits < max_needed) && (current_bit < final_bit)) {
+            if (offset == 0) {
+                // Fully set words can never be part of the chain, so skip them in bulk
+                const uint64_t nfull{count_words_matching(word_ptr, words_in_range(current_bit, final_bit),
+                                                          static_cast< word_t >(~word_t{}))};
+                if (nfull > 0) {
+                    if (retb.nbits >= min_needed) { break; } // It has met the min with previous scan, use it
+                    current_bit += nfull * word_size();
+                    word_ptr += nfull;
+                    retb = {current_bit, 0}; // Reset everything and start over
+                    continue;
+                }
+
+                if constexpr (Summarized) {
+                    // If there is no chain in progress and the block doesn't have enough reset bits, only the reset
+                    // bits at the tail of the block can be the start of the chain, jump to it.
+                    if (retb.nbits == 0) {
+                        const uint64_t skip_bits{summary_skippable_bits(word_ptr, min_needed)};
+                        if (skip_bits > 0) {
+                            current_bit += skip_bits;
+                            word_ptr += skip_bits / word_size();
+                            offset = get_word_offset(current_bit);
+                            retb = {current_bit, 0};
+                            continue;
+                        }
+                    }
+                }
+            }
+
             const bit_filter filter{(retb.nbits >= min_needed)
                                         ? static_cast< uint32_t >(1)
                                         : std::min< uint32_t >(min_needed - retb.nbits, word_size()),
@@ -991,6 +2004,53 @@ public:
         return retb;
     }
 
+    /**
+     * @brief Get the smallest run of at least n contiguous reset bits (best fit) in the bitset
+     *
+     * @param n Count of required continuous reset bits
+     * @return BitBlock Returns the start of the run and n, start_bit npos if there is no such run
+     */
+    BitBlock get_best_fit_contiguous_n_reset_bits(const uint32_t n) const {
+        return get_best_fit_contiguous_n_reset_bits(0, std::nullopt, n, n);
+    }
+
+    /**
+     * @brief Get the smallest run of at least min_needed contiguous reset bits (best fit) in the range
+     * [start_bit, end_bit] inclusive. Unlike get_next_contiguous_n_reset_bits which returns the first run, this serves
+     * the small requests from the small holes and leaves the large holes for the large requests. The runs crossing
+     * the range are considered only for their bits within the range. Among the runs of the same size, the lowest one
+     * is returned.
+     *
+     * Without the free run index (see enable_free_run_index()), each call scans the entire range. With it, the first
+     * call builds the index of the runs by their size and the next calls update the runs only in the ranges modified
+     * since then. Since the call updates the index, it takes an exclusive lock on it and the concurrent calls are
+     * serialized.
+     *
+     * @param start_bit Start bit to search from
+     * @param end_bit Optional End bit to search to inclusive; otherwise to end of set
+     * @param min_needed Minimum number of reset bits needed
+     * @param max_needed Maximum number of reset bits needed
+     *
+     * @return BitBlock Returns the start of the run and its size, limited to max_needed. start_bit npos if there is no
+     * run of min_needed reset bits.
+     */
+    BitBlock get_best_fit_contiguous_n_reset_bits(const uint64_t start_bit, const std::optional< uint64_t > end_bit,
+                                                  const uint32_t min_needed, const uint32_t max_needed) const {
+        ReadLockGuard lock{this};
+        const uint64_t final_bit{end_bit ? std::min(*end_bit + 1, total_bits()) : total_bits()};
+        if ((start_bit >= final_bit) || (min_needed == 0)) { return {npos, 0}; }
+
+        if (!m_free_runs) {
+            // Without the index, the runs of only the range are collected for this search
+            free_run_index range_index{0};
+            add_free_runs(range_index, start_bit, final_bit);
+            return best_fit_run(range_index, start_bit, final_bit, min_needed, max_needed);
+        }
+        std::scoped_lock< std::mutex > index_lock{m_free_runs->m_lock};
+        refresh_free_runs(*m_free_runs);
+        return best_fit_run(*m_free_runs, start_bit, final_bit, min_needed, max_needed);
+    }
+
     uint64_t get_next_reset_bit(const uint64_t start_bit) const {
         ReadLockGuard lock{this};
         uint64_t ret{npos};
@@ -1006,13 +2066,26 @@ public:
             // test rest of whole words
             uint64_t current_bit{start_bit + (word_size() - offset)};
             uint64_t bits_remaining{current_bit > total_bits() ? 0 : total_bits() - current_bit};
+            ++word_ptr;
             while (bits_remaining > 0) {
-                if ((++word_ptr)->get_next_reset_bit(0, &nbit)) {
+                // skip all fully set words in bulk
+                const uint64_t nfull{count_words_matching(word_ptr, words_in_range(current_bit, total_bits()),
+                                                          static_cast< word_t >(~word_t{}))};
+                if (nfull > 0) {
+                    const uint64_t nfull_bits{std::min< uint64_t >(nfull * word_size(), bits_remaining)};
+                    current_bit += nfull_bits;
+                    bits_remaining -= nfull_bits;
+                    word_ptr += nfull;
+                    continue;
+                }
+
+                if (word_ptr->get_next_reset_bit(0, &nbit)) {
                     ret = current_bit + nbit;
                     break;
                 }
                 current_bit += word_size();
                 bits_remaining -= std::min< uint64_t >(bits_remaining, word_size());
+                ++word_ptr;
             }
         }
 
@@ -1038,7 +2111,7 @@ public:
             const word_t val{(word_ptr--)->to_integer()};
             const uint8_t valid_bits{static_cast< uint8_t >(
                 (bits_remaining > static_cast< uint64_t >(offset + 1)) ? (offset + 1) : bits_remaining)};
-            word_t mask{static_cast< word_t >(bit_mask[offset])};
+            word_t mask{word_bit_mask< word_t >(offset)};
             for (uint8_t bit{0}; bit < valid_bits; ++bit, mask >>= 1) {
                 output.push_back((((val & mask) == mask) ? '1' : '0'));
             }
@@ -1048,7 +2121,7 @@ public:
         // print whole words
         while (bits_remaining >= word_size()) {
             const word_t val{(word_ptr--)->to_integer()};
-            word_t mask{static_cast< word_t >(bit_mask[word_size() - 1])};
+            word_t mask{word_bit_mask< word_t >(word_size() - 1)};
             for (uint8_t bit{0}; bit < word_size(); ++bit, mask >>= 1) {
                 output.push_back((((val & mask) == mask) ? '1' : '0'));
             }
@@ -1058,7 +2131,7 @@ public:
         // get first word possibly partial word
         if (bits_remaining > 0) {
             const word_t val{word_ptr->to_integer()};
-            word_t mask{static_cast< word_t >(bit_mask[word_size() - 1])};
+            word_t mask{word_bit_mask< word_t >(word_size() - 1)};
             for (uint8_t bit{0}; bit < bits_remaining; ++bit, mask >>= 1) {
                 output.push_back((((val & mask) == mask) ? '1' : '0'));
             }
@@ -1067,7 +2140,224 @@ public:
         return output;
     }
 
+    /**
+     * @brief Parallel versions of full range operations for huge bitsets. The range is split into chunks of at least
+     * min_parallel_bits, each of them processed by a separate thread (calling thread included) and their results
+     * combined. nthreads of 0 uses as many threads as hardware concurrency. Each thread scans the whole words of its
+     * range with the vectorized kernels. Concurrent writes to the bitset are visible (or not) to them just like their
+     * single threaded versions.
+     */
+    static constexpr uint64_t min_parallel_bits{1024 * 1024};
+
+    uint64_t get_set_count_parallel(const uint64_t start_bit = 0,
+                                    const uint64_t end_bit = std::numeric_limits< uint64_t >::max(),
+                                    const uint32_t nthreads = 0) const {
+        ReadLockGuard lock{this};
+        assert(end_bit >= start_bit);
+        if (start_bit >= total_bits()) { return 0; }
+        const uint64_t last_bit{std::min(total_bits() - 1, end_bit)};
+        const auto counts{run_parallel(start_bit, last_bit + 1, nthreads,
+                                       [this](const uint64_t start, const uint64_t end) {
+                                           return scan_set_count(start, end);
+                                       })};
+        return std::accumulate(counts.cbegin(), counts.cend(), uint64_t{0});
+    }
+
+    uint64_t get_next_set_bit_parallel(const uint64_t start_bit, const uint32_t nthreads = 0) const {
+        return find_next_bit_parallel(start_bit, true, nthreads);
+    }
+
+    uint64_t get_next_reset_bit_parallel(const uint64_t start_bit, const uint32_t nthreads = 0) const {
+        return find_next_bit_parallel(start_bit, false, nthreads);
+    }
+
+    bool equals_parallel(const BitsetImpl& rhs, const uint32_t nthreads = 0) const {
+        if (this == &rhs) return true;
+        ReadLockGuard lock{this};
+        ReadLockGuard rhs_lock{&rhs};
+        if (total_bits() != rhs.total_bits()) { return false; }
+        if (total_bits() == 0) { return true; }
+        // Result is uint8_t instead of bool, since threads write their results to the adjacent elements
+        const auto compare_range{[this, &rhs](const uint64_t start, const uint64_t end) {
+            return static_cast< uint8_t >(scan_equals(rhs, start, end) ? 1 : 0);
+        }};
+        const auto results{run_parallel(0, total_bits(), nthreads, compare_range)};
+        return std::all_of(results.cbegin(), results.cend(), [](const uint8_t result) { return result == 1; });
+    }
+
+    std::string to_string_parallel(const uint32_t nthreads = 0) const {
+        ReadLockGuard lock{this};
+        if (total_bits() == 0) { return std::string{}; }
+        const auto outputs{run_parallel(0, total_bits(), nthreads, [this](const uint64_t start, const uint64_t end) {
+            std::string output{};
+            output.reserve(end - start);
+            for (uint64_t bit{end}; bit > start;) {
+                const uint8_t count{static_cast< uint8_t >(std::min< uint64_t >(word_size(), bit - start))};
+                bit -= count;
+                const word_t val{extract_bits(bit, count)};
+                for (uint8_t i{count}; i > 0; --i) {
+                    output.push_back(((val & word_bit_mask< word_t >(i - 1)) != 0) ? '1' : '0');
+                }
+            }
+            return output;
+        })};
+
+        // Last bit first, so the chunks are concatenated in the reverse order
+        std::string output{};
+        output.reserve(total_bits());
+        for (auto itr{outputs.crbegin()}; itr != outputs.crend(); ++itr) {
+            output.append(*itr);
+        }
+        return output;
+    }
+
 private:
+    // Bits scanned by a parallel search between the checks of the lowest hit found so far
+    static constexpr uint64_t parallel_scan_step_bits{64 * 1024};
+
+    uint64_t find_next_bit_parallel(const uint64_t start_bit, const bool set, const uint32_t nthreads) const {
+        ReadLockGuard lock{this};
+        if (start_bit >= total_bits()) { return npos; }
+
+        // Each range publishes its hit and stops once it is past the lowest hit, so a hit in an earlier range spares
+        // the scan of the rest of the later ranges
+        std::atomic< uint64_t > lowest{npos};
+        const auto found{run_parallel(
+            start_bit, total_bits(), nthreads, [this, set, &lowest](const uint64_t start, const uint64_t end) {
+                for (uint64_t step{start}; step < end; step += parallel_scan_step_bits) {
+                    if (step >= lowest.load(std::memory_order_relaxed)) { break; }
+                    const uint64_t bit{scan_next_bit(step, std::min(step + parallel_scan_step_bits, end), set)};
+                    if (bit != npos) {
+                        uint64_t cur{lowest.load(std::memory_order_relaxed)};
+                        while ((bit < cur) && !lowest.compare_exchange_weak(cur, bit, std::memory_order_relaxed)) {}
+                        return bit;
+                    }
+                }
+                return npos;
+            })};
+        return *std::min_element(found.cbegin(), found.cend());
+    }
+
+    // NOTE: must be called under lock
+    // Count of set bits in [start, end), with the whole words counted by the vectorized kernel
+    uint64_t scan_set_count(const uint64_t start, const uint64_t end) const {
+        if constexpr (s_raw_word_scan) {
+            const uint8_t offset{get_word_offset(start)};
+            const uint64_t head_bits{std::min< uint64_t >((offset == 0) ? 0 : (word_size() - offset), end - start)};
+            const uint64_t nwords{(end - start - head_bits) / word_size()};
+            if (nwords > 0) {
+                const auto* const words{reinterpret_cast< const uint64_t* >(get_word_const(start + head_bits))};
+                uint64_t count{simd::count_words< simd::word_and >(words, words, nwords)};
+                if (head_bits > 0) { count += get_set_count_impl(start, start + head_bits - 1); }
+                const uint64_t tail_start{start + head_bits + nwords * word_size()};
+                if (tail_start < end) { count += get_set_count_impl(tail_start, end - 1); }
+                return count;
+            }
+        }
+        return get_set_count_impl(start, end - 1);
+    }
+
+    // NOTE: must be called under lock
+    // First set (or reset) bit in [start, end), npos if there is none. Whole words which do not have it are skipped by
+    // the vectorized kernel.
+    uint64_t scan_next_bit(const uint64_t start, const uint64_t end, const bool set) const {
+        [[maybe_unused]] const word_t skip_pattern{set ? word_t{} : static_cast< word_t >(~word_t{})};
+        uint64_t bit{start};
+        while (bit < end) {
+            const uint8_t offset{get_word_offset(bit)};
+            if constexpr (s_raw_word_scan) {
+                const uint64_t nwords{(offset == 0) ? ((end - bit) / word_size()) : 0};
+                if (nwords > 0) {
+                    const uint64_t nskip{simd::find_first_word_not_equal(
+                        reinterpret_cast< const uint64_t* >(get_word_const(bit)), nwords,
+                        static_cast< uint64_t >(skip_pattern))};
+                    bit += nskip * word_size();
+                    if (nskip == nwords) { continue; }
+                }
+            }
+
+            const uint8_t count{static_cast< uint8_t >(std::min< uint64_t >(word_size() - offset, end - bit))};
+            word_t val{extract_bits(bit, count)};
+            if (!set) { val = static_cast< word_t >(~val & word_consecutive_bitmask< word_t >(count)); }
+            if (val != 0) { return bit + get_trailing_zeros(val); }
+            bit += count;
+        }
+        return npos;
+    }
+
+    // NOTE: must be called under lock of both the bitsets
+    // Compares the bits in [start, end) of both the bitsets. If the words of both are aligned alike, the whole words
+    // are compared by counting the bits of their xor with the vectorized kernel.
+    bool scan_equals(const BitsetImpl& rhs, const uint64_t start, const uint64_t end) const {
+        uint64_t bit{start};
+        if constexpr (s_raw_word_scan) {
+            const uint8_t offset{get_word_offset(start)};
+            if (offset == rhs.get_word_offset(start)) {
+                const uint64_t head_bits{
+                    std::min< uint64_t >((offset == 0) ? 0 : (word_size() - offset), end - start)};
+                if ((head_bits > 0) && (extract_bits(start, static_cast< uint8_t >(head_bits)) !=
+                                        rhs.extract_bits(start, static_cast< uint8_t >(head_bits)))) {
+                    return false;
+                }
+                bit += head_bits;
+                const uint64_t nwords{(end - bit) / word_size()};
+                if (nwords > 0) {
+                    const auto* const lhs_words{reinterpret_cast< const uint64_t* >(get_word_const(bit))};
+                    const auto* const rhs_words{reinterpret_cast< const uint64_t* >(rhs.get_word_const(bit))};
+                    if (simd::count_words< simd::word_xor >(lhs_words, rhs_words, nwords) != 0) { return false; }
+                    bit += nwords * word_size();
+                }
+            }
+        }
+
+        for (; bit < end; bit += word_size()) {
+            const uint8_t count{static_cast< uint8_t >(std::min< uint64_t >(word_size(), end - bit))};
+            if (extract_bits(bit, count) != rhs.extract_bits(bit, count)) { return false; }
+        }
+        return true;
+    }
+
+    // NOTE: must be called under lock
+    // Splits [start_bit, end_bit) into ranges, runs func(range_start, range_end) for each of them on a separate thread,
+    // the first one on the calling thread, and returns their results in the order of the ranges
+    template < typename FuncT >
+    auto run_parallel(const uint64_t start_bit, const uint64_t end_bit, const uint32_t nthreads, FuncT&& func) const {
+        using result_t = std::invoke_result_t< FuncT, uint64_t, uint64_t >;
+        const uint64_t nbits{end_bit - start_bit};
+        const uint64_t max_ranges{std::max< uint64_t >((nbits + min_parallel_bits - 1) / min_parallel_bits, 1)};
+        const uint64_t max_threads{
+            (nthreads > 0) ? nthreads : std::max< uint64_t >(std::thread::hardware_concurrency(), 1)};
+        // Keep the ranges a multiple of the word size, which could reduce the count of ranges needed
+        const uint64_t range_bits{
+            round_up((nbits + std::min(max_threads, max_ranges) - 1) / std::min(max_threads, max_ranges), word_size())};
+        const uint64_t nranges{std::max< uint64_t >((nbits + range_bits - 1) / range_bits, 1)};
+
+        std::vector< result_t > results(nranges);
+        {
+            std::vector< std::jthread > threads;
+            threads.reserve(nranges - 1);
+            for (uint64_t r{1}; r < nranges; ++r) {
+                const uint64_t range_start{start_bit + r * range_bits};
+                const uint64_t range_end{std::min(range_start + range_bits, end_bit)};
+                threads.emplace_back(
+                    [&func, &results, r, range_start, range_end]() { results[r] = func(range_start, range_end); });
+            }
+            results[0] = func(start_bit, std::min(start_bit + range_bits, end_bit));
+        }
+        return results;
+    }
+
+    BitBlock try_claim_next_reset_bits_in_range(const uint64_t start_bit, const std::optional< uint64_t > end_bit,
+                                                const uint32_t n) {
+        uint64_t search_bit{start_bit};
+        while (true) {
+            const BitBlock found{get_next_contiguous_n_reset_bits(search_bit, end_bit, n, n)};
+            if ((found.start_bit == npos) || try_claim_bits(found.start_bit, n)) { return found; }
+            // Lost the race for some of the bits, search again which will skip over the bits claimed by others
+            search_bit = found.start_bit;
+        }
+    }
+
     void set_reset_bits(const uint64_t start, const uint64_t nbits, const bool value) {
         ReadLockGuard lock{this};
         assert(m_s && m_s->valid_bit(start));
@@ -1093,6 +2383,8 @@ private:
             current_bit += count;
             bits_remaining -= count;
         }
+        update_summary(start, current_bit - start);
+        mark_dirty(start, current_bit - start);
 
         if (bits_remaining > 0) { throw std::out_of_range("Set/Reset bits not in range"); }
     }
@@ -1105,6 +2397,8 @@ private:
         if (!word_ptr) { return; }
         const uint8_t offset{get_word_offset(bit)};
         word_ptr->set_reset_bits(offset, 1, value);
+        update_summary(bit, 1);
+        mark_dirty(bit, 1);
     }
 
     bool is_bits_set_reset(const uint64_t start, const uint64_t nbits, const bool expected) const {
@@ -1145,29 +2439,64 @@ private:
         const uint64_t new_skip_bits{m_s->m_skip_bits & m_word_mask};
 
         const uint64_t new_nbits{nbits + new_skip_bits};
-        auto new_buf{make_byte_array_with_deleter(bitset_serialized::nbytes(new_nbits), m_s->m_alignment_size)};
+        const uint64_t unchanged_bits{std::min(total_bits(), nbits)};
+        if (owns_file()) {
+            resize_mapped(new_nbits, new_skip_bits, shrink_words, value, unchanged_bits);
+            return;
+        }
+        auto new_buf{make_byte_array_with_deleter(checked_blob_size(bitset_serialized::nbytes(new_nbits)),
+                                                  m_s->m_alignment_size)};
         auto new_s{new (new_buf->bytes)
                        bitset_serialized{m_s->m_id, new_nbits, new_skip_bits, m_s->m_alignment_size, false}};
         const auto new_cap{new_s->m_words_cap};
 
         // copy to resized
         const uint64_t move_nwords{std::min(m_s->m_words_cap - shrink_words, new_cap)};
-        std::uninitialized_copy(std::next(m_s->get_words_const(), shrink_words), m_s->end_words_const(),
-                                new_s->get_words());
+        std::uninitialized_copy(std::next(m_s->get_words_const(), shrink_words),
+                                std::next(m_s->get_words_const(), shrink_words + move_nwords), new_s->get_words());
         if (new_cap > move_nwords) {
             // Fill in the remaining space with value passed
             std::uninitialized_fill(std::next(new_s->get_words(), move_nwords), new_s->end_words(),
                                     (value ? bitword_type{static_cast< word_t >(~word_t{})} : bitword_type{word_t{}}));
         }
 
-        // swap old with new
+        // swap old with new, a shallow copy whose file was replaced moves to memory
         m_buf = new_buf;
         m_s = new_s;
+        m_mapped.reset();
+        rebuild_summary(unchanged_bits);
+        mark_all_dirty();
 
         LOGDEBUG("Resize to total_bits={} total_actual_bits={}, skip_bits={}, words_cap={}", total_bits(), m_s->m_nbits,
                  m_s->m_skip_bits, m_s->m_words_cap);
     }
 
+    // NOTE: This function should be called under a write lock. Words are compacted into a replacement file, which
+    // then atomically takes the place of the backing file. A crash midway leaves the old file intact and the shallow
+    // copies keep their mapping of the old file.
+    void resize_mapped(const uint64_t new_nbits, const uint64_t new_skip_bits, const uint64_t shrink_words,
+                       const bool value, const uint64_t unchanged_bits) {
+        auto [file, new_buf]{create_replacement_file(bitset_serialized::nbytes(new_nbits))};
+        auto new_s{new (new_buf->bytes)
+                       bitset_serialized{m_s->m_id, new_nbits, new_skip_bits, m_s->m_alignment_size, false}};
+        const auto new_cap{new_s->m_words_cap};
+        const uint64_t move_nwords{std::min(m_s->m_words_cap - shrink_words, new_cap)};
+        std::copy(std::next(m_s->get_words_const(), shrink_words),
+                  std::next(m_s->get_words_const(), shrink_words + move_nwords), new_s->get_words());
+        if (new_cap > move_nwords) {
+            std::fill(std::next(new_s->get_words(), move_nwords), new_s->end_words(),
+                      (value ? bitword_type{static_cast< word_t >(~word_t{})} : bitword_type{word_t{}}));
+        }
+
+        commit_replacement_file(std::move(file), std::move(new_buf));
+        m_s = new_s;
+        rebuild_summary(unchanged_bits);
+        mark_all_dirty();
+
+        LOGDEBUG("Resize mapped file={} to total_bits={} total_actual_bits={}, skip_bits={}, words_cap={}",
+                 m_mapped->m_path, total_bits(), m_s->m_nbits, m_s->m_skip_bits, m_s->m_words_cap);
+    }
+
     // NOTE: must be called under lock
     bitword_type* get_word(const uint64_t bit) {
         assert(m_s);
@@ -1195,7 +2524,648 @@ private:
         return (m_s->m_nbits - m_s->m_skip_bits);
     }
 
+    // Number of words (including partial words) which covers the bits in the range [start_bit, end_bit)
+    static constexpr uint64_t words_in_range(const uint64_t start_bit, const uint64_t end_bit) {
+        return (end_bit > start_bit) ? ((end_bit - start_bit + m_word_mask) / word_size()) : 0;
+    }
+
+    // NOTE: must be called under lock
+    // Returns number of consecutive words starting at word_ptr (upto max_words) whose value is same as pattern.
+    uint64_t count_words_matching(const bitword_type* const word_ptr, const uint64_t max_words,
+                                  const word_t pattern) const {
+        // Most of the time the first word itself doesn't match, avoid the cost of a bulk scan in that case
+        if ((max_words == 0) || (word_ptr->to_integer() != pattern)) { return 0; }
+
+        if constexpr (Summarized) {
+            if (pattern == static_cast< word_t >(~word_t{})) {
+                const uint64_t word_n{static_cast< uint64_t >(word_ptr - m_s->get_words_const())};
+                return summary_next_non_full_word(word_n, word_n + max_words) - word_n;
+            }
+        }
+
+        if constexpr (s_raw_word_scan) {
+            return 1 +
+                simd::find_first_word_not_equal(reinterpret_cast< const uint64_t* >(word_ptr + 1), max_words - 1,
+                                                static_cast< uint64_t >(pattern));
+        } else {
+            uint64_t n{1};
+            while ((n < max_words) && (word_ptr[n].to_integer() == pattern)) {
+                ++n;
+            }
+            return n;
+        }
+    }
+
+    // NOTE: must be called under lock
+    void mark_dirty(const uint64_t start, const uint64_t nbits) {
+        if (nbits == 0) { return; }
+        if (m_rank) { m_rank->invalidate(start); }
+        if (m_free_runs) { m_free_runs->invalidate(start, nbits); }
+        if (!m_dirty) { return; }
+        // Always do the atomic or (even if already dirty), so that it pairs with the clearing in serialize_delta() and
+        // the modified bits are guaranteed to be visible to it
+        const uint64_t first_page{start / m_dirty->m_page_bits};
+        const uint64_t last_page{(start + nbits - 1) / m_dirty->m_page_bits};
+        for (uint64_t page{first_page}; page <= last_page; ++page) {
+            m_dirty->m_pages[page / 64].fetch_or(bit_mask[page % 64], std::memory_order_release);
+        }
+    }
+
+    // NOTE: must be called under write lock. Rank index is invalidated by rebuild_summary() or by the caller.
+    void mark_all_dirty() {
+        if (m_free_runs) { m_free_runs->invalidate_all(); }
+        if (!m_dirty) { return; }
+        if (m_dirty->m_pages.size() < ((m_dirty->total_pages(total_bits()) + 63) / 64)) {
+            m_dirty = std::make_shared< dirty_tracker >(m_dirty->m_page_bits, total_bits());
+        }
+        m_dirty->m_all_dirty.store(true, std::memory_order_release);
+    }
+
+    // NOTE: must be called under write lock or during construction
+    // unchanged_bits is the count of bits at the start of the bitset, which are not modified or moved since the rank
+    // index was built (say retained by a resize), so that their counts are reused.
+    void rebuild_summary(const uint64_t unchanged_bits = 0) {
+        if (m_rank && (m_rank.use_count() == 1)) {
+            m_rank->invalidate(unchanged_bits);
+        } else {
+            // Old rank index could still be shared with the shallow copies of the same buffer
+            if (m_rank) { m_rank->invalidate(0); }
+            m_rank = std::make_shared< rank_index >();
+        }
+        if (m_free_runs) {
+            // Old index could still be shared with the shallow copies of the same buffer
+            m_free_runs->invalidate_all();
+            m_free_runs = std::make_shared< free_run_index >(total_bits());
+        }
+        if constexpr (Summarized) {
+            const uint64_t nblocks{(m_s->m_words_cap + bitset_summary::summary_block_words - 1) /
+                                   bitset_summary::summary_block_words};
+            m_summary = std::make_shared< bitset_summary >(nblocks);
+            for (uint64_t block{0}; block < nblocks; ++block) {
+                m_summary->m_full_words[block] = compute_summary_block(block);
+            }
+        }
+    }
+
+    // NOTE: must be called under lock
+    // Updates the full bits of the modified words and marks their blocks stale, the counts are recomputed on search.
+    void update_summary(const uint64_t start, const uint64_t nbits) {
+        if constexpr (Summarized) {
+            if (nbits == 0) { return; }
+            constexpr word_t all_ones{static_cast< word_t >(~word_t{})};
+            const uint64_t first_word{(start + m_s->m_skip_bits) / word_size()};
+            const uint64_t last_word{(start + nbits - 1 + m_s->m_skip_bits) / word_size()};
+            for (uint64_t word_n{first_word}; word_n <= last_word; ++word_n) {
+                uint64_t& full_words{m_summary->m_full_words[word_n / bitset_summary::summary_block_words]};
+                const uint64_t mask{bit_mask[word_n % bitset_summary::summary_block_words]};
+                if (nth_word(word_n)->to_integer() == all_ones) {
+                    full_words |= mask;
+                } else {
+                    full_words &= ~mask;
+                }
+            }
+
+            const uint64_t last_block{last_word / bitset_summary::summary_block_words};
+            for (uint64_t block{first_word / bitset_summary::summary_block_words}; block <= last_block; ++block) {
+                m_summary->mark_stale(block);
+            }
+        }
+    }
+
+    // NOTE: must be called under lock. Returns with the rank index read locked and up to date, unless it is being
+    // modified concurrently.
+    std::shared_lock< folly::SharedMutex > lock_rank_index() const {
+        rank_index& index{*m_rank};
+        std::shared_lock< folly::SharedMutex > rank_lock{index.m_lock};
+        if (index.m_stale_from.load(std::memory_order_acquire) != npos) {
+            rank_lock.unlock();
+            {
+                std::unique_lock< folly::SharedMutex > build_lock{index.m_lock};
+                build_rank_index(index);
+            }
+            rank_lock.lock();
+        }
+        return rank_lock;
+    }
+
+    // NOTE: must be called under lock and with the index locked, if it is the free run index of the bitset
+    BitBlock best_fit_run(const free_run_index& index, const uint64_t start_bit, const uint64_t final_bit,
+                          const uint32_t min_needed, const uint32_t max_needed) const {
+        uint64_t best_start{npos};
+        uint64_t best_nbits{std::numeric_limits< uint64_t >::max()};
+        const auto consider{[&](const uint64_t run_start, const uint64_t run_nbits) {
+            const uint64_t clip_start{std::max(run_start, start_bit)};
+            const uint64_t clip_end{std::min(run_start + run_nbits, final_bit)};
+            if ((clip_end <= clip_start) || ((clip_end - clip_start) < min_needed)) { return; }
+            const uint64_t nbits{clip_end - clip_start};
+            if ((nbits < best_nbits) || ((nbits == best_nbits) && (clip_start < best_start))) {
+                best_start = clip_start;
+                best_nbits = nbits;
+            }
+        }};
+
+        // Runs crossing the start and end of the range are smaller within the range than their size in the index
+        for (const uint64_t bit : {start_bit, final_bit - 1}) {
+            auto itr{index.m_by_start.upper_bound(bit)};
+            if (itr != index.m_by_start.begin()) {
+                --itr;
+                consider(itr->first, itr->second);
+            }
+        }
+
+        // Smallest run which is within the range
+        for (auto itr{index.m_by_size.lower_bound(std::make_pair(uint64_t{min_needed}, uint64_t{0}))};
+             (itr != index.m_by_size.end()) && (itr->first <= best_nbits); ++itr) {
+            if ((itr->second >= start_bit) && ((itr->second + itr->first) <= final_bit)) {
+                consider(itr->second, itr->first);
+                break;
+            }
+        }
+
+        if (best_start == npos) { return {npos, 0}; }
+        return {best_start, static_cast< uint32_t >(std::min< uint64_t >(best_nbits, max_needed))};
+    }
+
+    // NOTE: must be called under lock and with the free run index locked
+    void refresh_free_runs(free_run_index& index) const {
+        const uint64_t nbits{total_bits()};
+
+        // Clear the stale marks before scanning, so that the writes during the scan mark them stale again
+        std::vector< std::pair< uint64_t, uint64_t > > stale;
+        for (uint64_t i{0}; i < index.m_stale_blocks.size(); ++i) {
+            uint64_t blocks{index.m_stale_blocks[i].exchange(0, std::memory_order_acq_rel)};
+            while (blocks != 0) {
+                const uint64_t block{i * 64 + get_trailing_zeros(blocks)};
+                stale.emplace_back(block * free_run_index::block_bits, (block + 1) * free_run_index::block_bits);
+                blocks &= (blocks - 1);
+            }
+        }
+        if (index.m_all_stale.exchange(false, std::memory_order_acq_rel)) {
+            index.m_by_start.clear();
+            index.m_by_size.clear();
+            add_free_runs(index, 0, nbits);
+            return;
+        }
+
+        // Blocks are collected in order, so the adjacent ones are merged into one range
+        for (size_t i{0}; i < stale.size();) {
+            uint64_t start{stale[i].first};
+            uint64_t end{stale[i].second};
+            for (++i; (i < stale.size()) && (stale[i].first <= end); ++i) {
+                end = std::max(end, stale[i].second);
+            }
+            start = std::min(start, nbits);
+            end = std::min(end, nbits);
+
+            // Remove the runs overlapping or adjacent to the range and rescan only the range. The parts of those runs
+            // outside the range are unmodified and still reset, so they are joined to the runs found at the edges.
+            auto itr{index.m_by_start.lower_bound(start)};
+            uint64_t run_start{npos};
+            uint64_t tail_end{0};
+            if (itr != index.m_by_start.begin()) {
+                const auto prev{std::prev(itr)};
+                if ((prev->first + prev->second) >= start) {
+                    run_start = prev->first;
+                    tail_end = prev->first + prev->second;
+                    index.remove_run(prev);
+                }
+            }
+            while ((itr != index.m_by_start.end()) && (itr->first <= end)) {
+                tail_end = std::max(tail_end, itr->first + itr->second);
+                index.remove_run(itr++);
+            }
+            add_free_runs(index, start, end, run_start, std::min(tail_end, nbits));
+        }
+    }
+
+    // NOTE: must be called under lock and with the free run index locked
+    // Adds the runs of reset bits in [start, end) to the index. run_start is the start of the reset bits continuing
+    // into the start of the range and tail_end is the end of the reset bits continuing from the end of the range.
+    void add_free_runs(free_run_index& index, const uint64_t start, const uint64_t end, uint64_t run_start = npos,
+                       const uint64_t tail_end = 0) const {
+        for (uint64_t bit{start}; bit < end; bit += word_size()) {
+            const uint8_t count{static_cast< uint8_t >(std::min< uint64_t >(word_size(), end - bit))};
+            const word_t val{extract_bits(bit, count)};
+            const word_t reset_val{static_cast< word_t >(~val & word_consecutive_bitmask< word_t >(count))};
+            uint8_t pos{0};
+            while (pos < count) {
+                if (run_start == npos) {
+                    const word_t reset_bits{static_cast< word_t >(reset_val >> pos)};
+                    if (reset_bits == 0) { break; }
+                    pos += get_trailing_zeros(reset_bits);
+                    run_start = bit + pos;
+                } else {
+                    const word_t set_bits{static_cast< word_t >(val >> pos)};
+                    if (set_bits == 0) { break; }
+                    pos += get_trailing_zeros(set_bits);
+                    index.add_run(run_start, bit + pos - run_start);
+                    run_start = npos;
+                }
+            }
+        }
+        if (run_start != npos) {
+            index.add_run(run_start, std::max(end, tail_end) - run_start);
+        } else if (tail_end > end) {
+            index.add_run(end, tail_end - end);
+        }
+    }
+
+    // NOTE: must be called under lock and with the rank index write locked
+    void build_rank_index(rank_index& index) const {
+        // Reset the stale mark before counting, so that writes during the counting mark it stale again
+        const uint64_t stale_from{index.m_stale_from.exchange(npos, std::memory_order_acq_rel)};
+        if (stale_from == npos) { return; }
+
+        const uint64_t nbits{total_bits()};
+        const uint64_t nsuperblocks{(nbits + rank_index::superblock_bits - 1) / rank_index::superblock_bits};
+        // Counts upto the stale superblock are valid, even if the bitset is resized since they were computed
+        if (index.m_ranks.size() != (nsuperblocks + 1)) { index.m_ranks.resize(nsuperblocks + 1, 0); }
+        uint64_t superblock{std::min(stale_from, nsuperblocks)};
+
+        uint64_t count{index.m_ranks[superblock]};
+        for (; superblock < nsuperblocks; ++superblock) {
+            const uint64_t start_bit{superblock * rank_index::superblock_bits};
+            count += get_set_count_impl(start_bit, std::min(start_bit + rank_index::superblock_bits, nbits) - 1);
+            index.m_ranks[superblock + 1] = count;
+        }
+    }
+
     // NOTE: must be called under lock
+    // Recomputes the counts of the block if it was modified since they were computed
+    void refresh_summary_block(const uint64_t block) const {
+        auto& stale{m_summary->m_stale_blocks[block / 64]};
+        const uint64_t mask{bit_mask[block % 64]};
+        if ((stale.load(std::memory_order_acquire) & mask) == 0) { return; }
+        compute_summary_block(block);
+        stale.fetch_and(~mask, std::memory_order_release);
+    }
+
+    // NOTE: must be called under lock
+    // Computes the counts of the block and returns the bitmap of its full words
+    uint64_t compute_summary_block(const uint64_t block) const {
+        constexpr word_t all_ones{static_cast< word_t >(~word_t{})};
+        const uint64_t start_word{block * bitset_summary::summary_block_words};
+        const uint64_t end_word{std::min(start_word + bitset_summary::summary_block_words, uint64_t{m_s->m_words_cap})};
+
+        uint64_t full_words{0};
+        uint32_t max_reset_bits{0};
+        uint32_t cur_reset_bits{0}; // Reset bits chain continuing from previous word
+        for (uint64_t word_n{start_word}; word_n < end_word; ++word_n) {
+            const bitword_type* const word_ptr{nth_word(word_n)};
+            const word_t val{word_ptr->to_integer()};
+            if (val == all_ones) {
+                full_words |= bit_mask[word_n - start_word];
+                max_reset_bits = std::max(max_reset_bits, cur_reset_bits);
+                cur_reset_bits = 0;
+            } else if (val == word_t{}) {
+                cur_reset_bits += word_size();
+            } else {
+                // low order reset bits continue the chain and high order reset bits start a new one
+                cur_reset_bits += get_trailing_zeros(val);
+                uint8_t word_max{0};
+                word_ptr->get_max_contiguous_reset_bits(0, &word_max);
+                max_reset_bits = std::max({max_reset_bits, cur_reset_bits, static_cast< uint32_t >(word_max)});
+                cur_reset_bits = get_leading_zeros(val);
+            }
+        }
+
+        m_summary->m_max_reset_bits[block].store(std::max(max_reset_bits, cur_reset_bits), std::memory_order_relaxed);
+        m_summary->m_tail_reset_bits[block].store(cur_reset_bits, std::memory_order_relaxed);
+        return full_words;
+    }
+
+    // NOTE: must be called under lock
+    // Returns the first word in [word_n, end_word) which is not fully set; end_word if all of them are set.
+    uint64_t summary_next_non_full_word(const uint64_t word_n, const uint64_t end_word) const {
+        const auto& full_words{m_summary->m_full_words};
+        uint64_t block{word_n / bitset_summary::summary_block_words};
+        const uint8_t block_offset{static_cast< uint8_t >(word_n % bitset_summary::summary_block_words)};
+        uint64_t non_full{~full_words[block] & ~((block_offset == 0) ? 0 : consecutive_bitmask[block_offset - 1])};
+        while (non_full == 0) {
+            if ((++block >= full_words.size()) || ((block * bitset_summary::summary_block_words) >= end_word)) {
+                return end_word;
+            }
+            non_full = ~full_words[block];
+        }
+        return std::min(block * bitset_summary::summary_block_words + get_trailing_zeros(non_full), end_word);
+    }
+
+    // NOTE: must be called under lock
+    // Returns number of bits that can be skipped from the start of word_ptr, since rest of its summary block doesn't
+    // have min_needed contiguous reset bits, other than the chain at the tail of the block.
+    uint64_t summary_skippable_bits(const bitword_type* const word_ptr, const uint32_t min_needed) const {
+        const uint64_t word_n{static_cast< uint64_t >(word_ptr - m_s->get_words_const())};
+        const uint64_t block{word_n / bitset_summary::summary_block_words};
+        refresh_summary_block(block);
+        if (m_summary->m_max_reset_bits[block].load(std::memory_order_relaxed) >= min_needed) { return 0; }
+
+        const uint64_t end_word{
+            std::min((block + 1) * bitset_summary::summary_block_words, uint64_t{m_s->m_words_cap})};
+        const uint64_t tail_start_bit{end_word * word_size() -
+                                      m_summary->m_tail_reset_bits[block].load(std::memory_order_relaxed)};
+        const uint64_t cur_bit{word_n * word_size()};
+        return (tail_start_bit > cur_bit) ? (tail_start_bit - cur_bit) : 0;
+    }
+
+    // Loads the bitset from the compressed buffer, with its header already validated by read_compressed_header()
+    BitsetImpl(compressed_tag, const sisl::byte_array& b, const compressed_header& hdr,
+               const std::optional< uint32_t > opt_alignment_size) :
+            BitsetImpl{hdr.m_nbits, hdr.m_id, opt_alignment_size ? (*opt_alignment_size) : hdr.m_alignment_size} {
+        const uint8_t* cur{b->bytes + sizeof(compressed_header)};
+        const uint8_t* const end{b->bytes + b->size};
+        const uint64_t nbits{total_bits()};
+        std::array< uint64_t, compressed_chunk_groups > groups;
+
+        for (uint64_t chunk_start{0}; chunk_start < nbits; chunk_start += compressed_chunk_bits) {
+            const uint64_t chunk_bits{std::min(compressed_chunk_bits, nbits - chunk_start)};
+            const auto type{static_cast< compressed_chunk_type >(read_serialized_value< uint8_t >(cur, end))};
+            if (type == compressed_chunk_type::empty) {
+                continue; // Bitset is already reset to begin with
+            } else if (type == compressed_chunk_type::full) {
+                set_bits(chunk_start, chunk_bits);
+            } else if (type == compressed_chunk_type::runs) {
+                const uint32_t nruns{read_serialized_value< uint32_t >(cur, end)};
+                for (uint32_t r{0}; r < nruns; ++r) {
+                    const uint64_t run_start{read_serialized_value< uint16_t >(cur, end)};
+                    const uint64_t run_bits{static_cast< uint64_t >(read_serialized_value< uint16_t >(cur, end)) + 1};
+                    if ((run_start + run_bits) > chunk_bits) {
+                        throw std::out_of_range("Compressed bitset run is beyond the bitset size");
+                    }
+                    set_bits(chunk_start + run_start, run_bits);
+                }
+            } else if (type == compressed_chunk_type::dense) {
+                const uint64_t ngroups{(chunk_bits + 63) / 64};
+                for (uint64_t g{0}; g < ngroups; ++g) {
+                    groups[g] = read_serialized_value< uint64_t >(cur, end);
+                }
+                store_bits(chunk_start, groups.data(), chunk_bits);
+            } else {
+                throw std::out_of_range("Invalid chunk type in compressed bitset");
+            }
+        }
+        rebuild_summary();
+    }
+
+    static compressed_header read_compressed_header(const sisl::byte_array& b) {
+        if (b->size < sizeof(compressed_header)) { throw std::out_of_range("Compressed bitset buffer is truncated"); }
+        compressed_header hdr;
+        std::memcpy(static_cast< void* >(&hdr), b->bytes, sizeof(compressed_header));
+        if ((hdr.m_magic != compressed_header::s_magic) || (hdr.m_version != compressed_header::s_version)) {
+            throw std::out_of_range("Buffer is not a compressed bitset");
+        }
+        // Every chunk has atleast its type byte, so the bits can't be more than the chunks the buffer can hold
+        if (hdr.m_nbits > ((b->size - sizeof(compressed_header)) * compressed_chunk_bits)) {
+            throw std::out_of_range("Compressed bitset buffer is truncated");
+        }
+        return hdr;
+    }
+
+    template < typename T >
+    static T read_serialized_value(const uint8_t*& cur, const uint8_t* const end) {
+        if (static_cast< size_t >(end - cur) < sizeof(T)) {
+            throw std::out_of_range("Compressed bitset buffer is truncated");
+        }
+        T val;
+        std::memcpy(static_cast< void* >(&val), cur, sizeof(T));
+        cur += sizeof(T);
+        return val;
+    }
+
+    template < typename T >
+    static uint8_t* write_serialized_value(uint8_t* const cur, const T& val) {
+        std::memcpy(cur, static_cast< const void* >(&val), sizeof(T));
+        return cur + sizeof(T);
+    }
+
+    // NOTE: must be called under lock
+    void load_chunk_groups(const uint64_t chunk_start, const uint64_t chunk_bits, uint64_t* const groups) const {
+        const uint64_t ngroups{(chunk_bits + 63) / 64};
+        for (uint64_t g{0}; g < ngroups; ++g) {
+            uint64_t val{0};
+            const uint64_t group_start{chunk_start + g * 64};
+            const uint64_t group_end{std::min(group_start + 64, chunk_start + chunk_bits)};
+            for (uint64_t bit{group_start}; bit < group_end; bit += word_size()) {
+                const uint8_t count{static_cast< uint8_t >(std::min< uint64_t >(word_size(), group_end - bit))};
+                val |= static_cast< uint64_t >(extract_bits(bit, count)) << (bit - group_start);
+            }
+            groups[g] = val;
+        }
+    }
+
+    // NOTE: must be called under lock
+    // Overwrite nbits from the start_bit with the bits packed in the groups of uint64_t
+    void store_bits(const uint64_t start_bit, const uint64_t* const groups, const uint64_t nbits) {
+        uint64_t bits_done{0};
+        while (bits_done < nbits) {
+            const uint64_t bit{start_bit + bits_done};
+            bitword_type* const word_ptr{get_word(bit)};
+            if (!word_ptr) { throw std::out_of_range("Store bits not in range"); }
+            const uint8_t offset{get_word_offset(bit)};
+            // Words wider than 64 bits are stored a group at a time
+            const uint64_t word_bits_remaining{static_cast< uint64_t >(word_size() - offset)};
+            const uint8_t count{
+                static_cast< uint8_t >(std::min< uint64_t >({word_bits_remaining, nbits - bits_done, uint64_t{64}}))};
+
+            const uint64_t group_offset{bits_done % 64};
+            uint64_t val{groups[bits_done / 64] >> group_offset};
+            if ((group_offset + count) > 64) { val |= groups[bits_done / 64 + 1] << (64 - group_offset); }
+            const word_t mask{static_cast< word_t >(word_consecutive_bitmask< word_t >(count) << offset)};
+            word_ptr->and_with(static_cast< word_t >(~mask));
+            const word_t shifted_val{static_cast< word_t >(static_cast< word_t >(val) << offset)};
+            word_ptr->or_with(static_cast< word_t >(shifted_val & mask));
+            bits_done += count;
+        }
+    }
+
+    static compressed_chunk_info analyze_chunk(const uint64_t chunk_bits,
+                                               const std::array< uint64_t, compressed_chunk_groups >& groups) {
+        const uint64_t ngroups{(chunk_bits + 63) / 64};
+        uint64_t set_cnt{0};
+        uint32_t nruns{0};
+        uint64_t prev_msb{0};
+        for (uint64_t g{0}; g < ngroups; ++g) {
+            // Every set bit whose previous bit is reset is the start of a run
+            set_cnt += get_set_bit_count(groups[g]);
+            nruns += get_set_bit_count(groups[g] & ~((groups[g] << 1) | prev_msb));
+            prev_msb = groups[g] >> 63;
+        }
+
+        if (set_cnt == 0) { return {compressed_chunk_type::empty, 0}; }
+        if (set_cnt == chunk_bits) { return {compressed_chunk_type::full, 0}; }
+        const uint64_t runs_size{sizeof(uint32_t) + nruns * 2 * sizeof(uint16_t)};
+        return {(runs_size < ngroups * sizeof(uint64_t)) ? compressed_chunk_type::runs : compressed_chunk_type::dense,
+                nruns};
+    }
+
+    static uint64_t compressed_chunk_size(const compressed_chunk_info& chunk, const uint64_t chunk_bits) {
+        switch (chunk.type) {
+        case compressed_chunk_type::runs:
+            return sizeof(uint8_t) + sizeof(uint32_t) + chunk.nruns * 2 * sizeof(uint16_t);
+        case compressed_chunk_type::dense:
+            return sizeof(uint8_t) + ((chunk_bits + 63) / 64) * sizeof(uint64_t);
+        default:
+            return sizeof(uint8_t);
+        }
+    }
+
+    // Returns the next bit with value from the start bit in the chunk, chunk_bits if there are none
+    static uint64_t next_chunk_bit(const std::array< uint64_t, compressed_chunk_groups >& groups, uint64_t bit,
+                                   const uint64_t chunk_bits, const bool value) {
+        while (bit < chunk_bits) {
+            const uint64_t val{(value ? groups[bit / 64] : ~groups[bit / 64]) >> (bit % 64)};
+            if (val != 0) { return std::min(bit + get_trailing_zeros(val), chunk_bits); }
+            bit = (bit / 64 + 1) * 64;
+        }
+        return chunk_bits;
+    }
+
+    // NOTE: must be called under lock
+    uint64_t get_set_count_impl(const uint64_t start_bit, const uint64_t end_bit) const {
+        assert(end_bit >= start_bit);
+        const uint64_t last_bit{std::min(total_bits() - 1, end_bit)};
+        const uint64_t num_bits{last_bit - start_bit + 1};
+
+        // get first word count which may be partial and we assume that at least 1 word worth of bits
+        uint64_t set_cnt{0};
+        const bitword_type* word_ptr{get_word_const(start_bit)};
+        if (!word_ptr) { return set_cnt; }
+        const uint8_t offset{get_word_offset(start_bit)};
+        if ((offset + num_bits) <= word_size()) {
+            // all bits in first word
+            const word_t mask{word_consecutive_bitmask< word_t >(num_bits)};
+            set_cnt += get_set_bit_count((word_ptr->to_integer() >> offset) & mask);
+        } else {
+            set_cnt += get_set_bit_count(word_ptr->to_integer() >> offset);
+
+            // count rest of words
+            const uint64_t word_skip_bits{static_cast< uint64_t >(word_size() - offset)};
+            uint64_t bits_remaining{word_skip_bits >= num_bits ? 0 : num_bits - word_skip_bits};
+            while (bits_remaining >= word_size()) {
+                set_cnt += (++word_ptr)->get_set_count();
+                bits_remaining -= word_size();
+            }
+
+            // count last possibly partial word
+            if (bits_remaining > 0) {
+                const word_t mask{word_consecutive_bitmask< word_t >(bits_remaining)};
+                set_cnt += get_set_bit_count(((++word_ptr)->to_integer()) & mask);
+            }
+        }
+        return set_cnt;
+    }
+
+    // NOTE: must be called under lock
+    uint64_t bits_after(const uint64_t bit) const { return (bit < total_bits()) ? (total_bits() - bit) : 0; }
+
+    // NOTE: must be called under lock
+    // Returns count bits from the start_bit shifted to the lsb. Bits beyond the end of bitset are returned as reset.
+    word_t extract_bits(const uint64_t start_bit, const uint8_t count) const {
+        const uint64_t valid_bits{std::min< uint64_t >(count, bits_after(start_bit))};
+        if (valid_bits == 0) { return word_t{}; }
+
+        const bitword_type* const word_ptr{get_word_const(start_bit)};
+        const uint8_t offset{get_word_offset(start_bit)};
+        word_t val{static_cast< word_t >(word_ptr->to_integer() >> offset)};
+        if ((offset > 0) && (valid_bits > static_cast< uint64_t >(word_size() - offset))) {
+            val |= static_cast< word_t >((word_ptr + 1)->to_integer() << (word_size() - offset));
+        }
+        return static_cast< word_t >(val & word_consecutive_bitmask< word_t >(valid_bits));
+    }
+
+    static void apply_words_bulk(uint64_t* const dst, const uint64_t* const src, const uint64_t nwords,
+                                 const bitwise_op op) {
+        switch (op) {
+        case bitwise_op::op_and:
+            simd::apply_words< simd::word_and >(dst, src, nwords);
+            break;
+        case bitwise_op::op_or:
+            simd::apply_words< simd::word_or >(dst, src, nwords);
+            break;
+        case bitwise_op::op_xor:
+            simd::apply_words< simd::word_xor >(dst, src, nwords);
+            break;
+        case bitwise_op::op_andnot:
+            simd::apply_words< simd::word_andnot >(dst, src, nwords);
+            break;
+        }
+    }
+
+    static uint64_t count_words_bulk(const uint64_t* const lhs, const uint64_t* const rhs, const uint64_t nwords,
+                                     const bitwise_op op) {
+        switch (op) {
+        case bitwise_op::op_and:
+            return simd::count_words< simd::word_and >(lhs, rhs, nwords);
+        case bitwise_op::op_or:
+            return simd::count_words< simd::word_or >(lhs, rhs, nwords);
+        case bitwise_op::op_xor:
+            return simd::count_words< simd::word_xor >(lhs, rhs, nwords);
+        case bitwise_op::op_andnot:
+            return simd::count_words< simd::word_andnot >(lhs, rhs, nwords);
+        }
+        return 0;
+    }
+
+    // NOTE: must be called under lock
+    // Size of the buffer, which for a file mapping could be beyond the 32 bit size of the byte_array
+    uint64_t buf_size() const {
+        return m_mapped ? static_cast< const mapped_byte_array_impl* >(m_buf.get())->m_mapped_size
+                        : static_cast< uint64_t >(m_buf->size);
+    }
+
+    // NOTE: must be called under lock
+    // True if the words are in the backing file, false if the file was replaced through a shallow copy
+    bool owns_file() const { return m_mapped && !m_mapped->m_detached.load(std::memory_order_acquire); }
+
+    // NOTE: must be called under write lock
+    // Creates and maps a replacement of the backing file with the given size, it is removed unless committed
+    std::pair< std::shared_ptr< mapped_file_info >, sisl::byte_array > create_replacement_file(const uint64_t size) const {
+        const std::string pending_path{m_mapped->m_path + ".resize"};
+        const int fd{::open(pending_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "Unable to create bitset file " + pending_path);
+        }
+        auto file{std::make_shared< mapped_file_info >(m_mapped->m_path, fd, pending_path)};
+        file->extend(size);
+        auto buf{make_mapped_byte_array(*file, size)};
+        return {std::move(file), std::move(buf)};
+    }
+
+    // NOTE: must be called under write lock
+    // Persists the replacement file mapped by buf and renames it over the backing file, which is then detached from the
+    // shallow copies still mapping it
+    void commit_replacement_file(std::shared_ptr< mapped_file_info > file, sisl::byte_array buf) {
+        const uint64_t size{static_cast< const mapped_byte_array_impl* >(buf.get())->m_mapped_size};
+        if (::msync(buf->bytes, size, MS_SYNC) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Unable to flush bitset file " + file->m_path);
+        }
+        file->sync();
+        if (::rename(file->m_pending_path.c_str(), file->m_path.c_str()) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Unable to replace bitset file " + file->m_path);
+        }
+        file->m_pending_path.clear();
+
+        // Persist the rename itself
+        const auto sep{file->m_path.find_last_of('/')};
+        const std::string dir{(sep == std::string::npos) ? std::string{"."}
+                                                         : ((sep == 0) ? std::string{"/"} : file->m_path.substr(0, sep))};
+        const int dir_fd{::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (dir_fd >= 0) {
+            ::fsync(dir_fd);
+            ::close(dir_fd);
+        }
+
+        m_mapped->m_detached.store(true, std::memory_order_release);
+        m_mapped = std::move(file);
+        m_buf = std::move(buf);
+    }
+
+    static uint32_t checked_blob_size(const uint64_t size) {
+        if (size > mapped_byte_array_impl::max_blob_size) {
+            throw std::out_of_range("Bitset is larger than the max byte array size");
+        }
+        return static_cast< uint32_t >(size);
+    }
+
     bitword_type* nth_word(const uint64_t word_n) {
         assert(m_s);
         return &(m_s->get_words()[word_n]);
@@ -1207,9 +3177,9 @@ private:
     }
 };
 
-template < typename charT, typename traits, typename Word, bool ThreadSafeResizing = false >
+template < typename charT, typename traits, typename Word, bool ThreadSafeResizing = false, bool Summarized = false >
 std::basic_ostream< charT, traits >& operator<<(std::basic_ostream< charT, traits >& out_stream,
-                                                const BitsetImpl< Word, ThreadSafeResizing >& bitset) {
+                                                const BitsetImpl< Word, ThreadSafeResizing, Summarized >& bitset) {
     // copy the stream formatting
     std::basic_ostringstream< charT, traits > out_stream_working;
     out_stream_working.copyfmt(out_stream);
@@ -1224,15 +3194,36 @@ std::basic_ostream< charT, traits >& operator<<(std::basic_ostream< charT, trait
 }
 
 // external comparison functions
-template < typename Word, const bool ThreadSafeResizing >
-inline bool operator==(const BitsetImpl< Word, ThreadSafeResizing >& bitset1,
-                       const BitsetImpl< Word, ThreadSafeResizing >& bitset2) {
+template < typename Word, const bool ThreadSafeResizing, const bool Summarized >
+inline bool operator==(const BitsetImpl< Word, ThreadSafeResizing, Summarized >& bitset1,
+                       const BitsetImpl< Word, ThreadSafeResizing, Summarized >& bitset2) {
     return bitset1.operator==(bitset2);
 }
 
-template < typename Word, const bool ThreadSafeResizing >
-inline bool operator!=(const BitsetImpl< Word, ThreadSafeResizing >& bitset1,
-                       const BitsetImpl< Word, ThreadSafeResizing >& bitset2) {
+template < typename Word, const bool ThreadSafeResizing, const bool Summarized >
+inline BitsetImpl< Word, ThreadSafeResizing, Summarized >
+operator&(const BitsetImpl< Word, ThreadSafeResizing, Summarized >& bitset1,
+          const BitsetImpl< Word, ThreadSafeResizing, Summarized >& bitset2) {
+    return bitset1.bitwise(bitset2, bitwise_op::op_and);
+}
+
+template < typename Word, const bool ThreadSafeResizing, const bool Summarized >
+inline BitsetImpl< Word, ThreadSafeResizing, Summarized >
+operator|(const BitsetImpl< Word, ThreadSafeResizing, Summarized >& bitset1,
+          const BitsetImpl< Word, ThreadSafeResizing, Summarized >& bitset2) {
+    return bitset1.bitwise(bitset2, bitwise_op::op_or);
+}
+
+template < typename Word, const bool ThreadSafeResizing, const bool Summarized >
+inline BitsetImpl< Word, ThreadSafeResizing, Summarized >
+operator^(const BitsetImpl< Word, ThreadSafeResizing, Summarized >& bitset1,
+          const BitsetImpl< Word, ThreadSafeResizing, Summarized >& bitset2) {
+    return bitset1.bitwise(bitset2, bitwise_op::op_xor);
+}
+
+template < typename Word, const bool ThreadSafeResizing, const bool Summarized >
+inline bool operator!=(const BitsetImpl< Word, ThreadSafeResizing, Summarized >& bitset1,
+                       const BitsetImpl< Word, ThreadSafeResizing, Summarized >& bitset2) {
     return bitset1.operator!=(bitset2);
 }
 
@@ -1242,6 +3233,12 @@ inline bool operator!=(const BitsetImpl< Word, ThreadSafeResizing >& bitset1,
  */
 typedef BitsetImpl< Bitword< unsafe_bits< uint64_t > >, false > Bitset;
 
+/**
+ * @brief SummarizedBitset: Bitset which maintains a summary index of its words, so searching for reset bits in a
+ * large and mostly filled bitset jumps directly to the candidate words. Thread safety is same as Bitset.
+ */
+typedef BitsetImpl< Bitword< unsafe_bits< uint64_t > >, false, true > SummarizedBitset;
+
 /**
  * @brief AtomicBitset: The only thread safety this version provides is concurrently 2 different bits can be
  * set/unset. However, set/unset concurrently along with increasing the size, setting a bit beyond original
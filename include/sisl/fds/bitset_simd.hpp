@@ -0,0 +1,297 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define SISL_BITSET_SIMD_X86 1
+#endif
+
+//
+// Vectorized kernels which operates on an array of 64 bit words of a bitset. Each kernel has a scalar version
+// and where the cpu supports it, AVX2 (256 bits at a time) and AVX-512 (512 bits at a time) versions. The best
+// available version is picked at runtime on first use, so the library can be compiled without any -m flags.
+//
+
+namespace sisl {
+namespace simd {
+
+/**
+ * @brief Scalar version of find_first_word_not_equal
+ */
+inline uint64_t find_first_word_not_equal_scalar(const uint64_t* const words, const uint64_t nwords,
+                                                 const uint64_t pattern) {
+    for (uint64_t i{0}; i < nwords; ++i) {
+        if (words[i] != pattern) { return i; }
+    }
+    return nwords;
+}
+
+#ifdef SISL_BITSET_SIMD_X86
+__attribute__((target("avx2"))) inline uint64_t
+find_first_word_not_equal_avx2(const uint64_t* const words, const uint64_t nwords, const uint64_t pattern) {
+    const __m256i pat{_mm256_set1_epi64x(static_cast< long long >(pattern))};
+    uint64_t i{0};
+
+    // Compare 512 bits per iteration as 2 x 256 bit lanes, so that the common case of long runs of fully
+    // set (or reset) words is skipped with minimal branches.
+    for (; (i + 8) <= nwords; i += 8) {
+        const __m256i v1{_mm256_loadu_si256(reinterpret_cast< const __m256i* >(words + i))};
+        const __m256i v2{_mm256_loadu_si256(reinterpret_cast< const __m256i* >(words + i + 4))};
+        const __m256i eq{_mm256_and_si256(_mm256_cmpeq_epi64(v1, pat), _mm256_cmpeq_epi64(v2, pat))};
+        if (_mm256_movemask_epi8(eq) != -1) { break; }
+    }
+    for (; (i + 4) <= nwords; i += 4) {
+        const __m256i v{_mm256_loadu_si256(reinterpret_cast< const __m256i* >(words + i))};
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi64(v, pat)) != -1) { break; }
+    }
+    return i + find_first_word_not_equal_scalar(words + i, nwords - i, pattern);
+}
+
+__attribute__((target("avx512f"))) inline uint64_t
+find_first_word_not_equal_avx512(const uint64_t* const words, const uint64_t nwords, const uint64_t pattern) {
+    const __m512i pat{_mm512_set1_epi64(static_cast< long long >(pattern))};
+    uint64_t i{0};
+    for (; (i + 8) <= nwords; i += 8) {
+        const __mmask8 neq{_mm512_cmpneq_epu64_mask(_mm512_loadu_si512(words + i), pat)};
+        if (neq) { return i + static_cast< uint64_t >(__builtin_ctz(static_cast< unsigned >(neq))); }
+    }
+    return i + find_first_word_not_equal_scalar(words + i, nwords - i, pattern);
+}
+
+inline bool cpu_has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+inline bool cpu_has_avx512() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+}
+#else
+inline bool cpu_has_avx2() { return false; }
+inline bool cpu_has_avx512() { return false; }
+#endif
+
+/**
+ * @brief Find the first word in the array which is not equal to the pattern. Typically used to skip past fully set
+ * (pattern = ~0) or fully reset (pattern = 0) regions of the bitset in bulk.
+ *
+ * @param words Start of the word array
+ * @param nwords Total number of words to check
+ * @param pattern Pattern to compare against
+ * @return uint64_t Index of the first word not equal to pattern, nwords if all of them match
+ */
+inline uint64_t find_first_word_not_equal(const uint64_t* const words, const uint64_t nwords, const uint64_t pattern) {
+    using scan_fn_t = uint64_t (*)(const uint64_t*, uint64_t, uint64_t);
+    static const scan_fn_t s_scan_fn{[]() -> scan_fn_t {
+#ifdef SISL_BITSET_SIMD_X86
+        if (cpu_has_avx512()) { return &find_first_word_not_equal_avx512; }
+        if (cpu_has_avx2()) { return &find_first_word_not_equal_avx2; }
+#endif
+        return &find_first_word_not_equal_scalar;
+    }()};
+    return s_scan_fn(words, nwords, pattern);
+}
+
+/**
+ * Word operations which can be applied by the kernels below between 2 word arrays. Each of them has the scalar and
+ * vector forms of the operation.
+ */
+struct word_and {
+    static uint64_t apply(const uint64_t a, const uint64_t b) { return a & b; }
+#ifdef SISL_BITSET_SIMD_X86
+    __attribute__((target("avx2"))) static __m256i apply(const __m256i a, const __m256i b) {
+        return _mm256_and_si256(a, b);
+    }
+    __attribute__((target("avx512f"))) static __m512i apply(const __m512i a, const __m512i b) {
+        return _mm512_and_si512(a, b);
+    }
+#endif
+};
+
+struct word_or {
+    static uint64_t apply(const uint64_t a, const uint64_t b) { return a | b; }
+#ifdef SISL_BITSET_SIMD_X86
+    __attribute__((target("avx2"))) static __m256i apply(const __m256i a, const __m256i b) {
+        return _mm256_or_si256(a, b);
+    }
+    __attribute__((target("avx512f"))) static __m512i apply(const __m512i a, const __m512i b) {
+        return _mm512_or_si512(a, b);
+    }
+#endif
+};
+
+struct word_xor {
+    static uint64_t apply(const uint64_t a, const uint64_t b) { return a ^ b; }
+#ifdef SISL_BITSET_SIMD_X86
+    __attribute__((target("avx2"))) static __m256i apply(const __m256i a, const __m256i b) {
+        return _mm256_xor_si256(a, b);
+    }
+    __attribute__((target("avx512f"))) static __m512i apply(const __m512i a, const __m512i b) {
+        return _mm512_xor_si512(a, b);
+    }
+#endif
+};
+
+struct word_andnot {
+    static uint64_t apply(const uint64_t a, const uint64_t b) { return a & ~b; }
+#ifdef SISL_BITSET_SIMD_X86
+    __attribute__((target("avx2"))) static __m256i apply(const __m256i a, const __m256i b) {
+        return _mm256_andnot_si256(b, a);
+    }
+    __attribute__((target("avx512f"))) static __m512i apply(const __m512i a, const __m512i b) {
+        // Avoid _mm512_andnot_si512 which trips -Wmaybe-uninitialized in some gcc versions
+        return _mm512_and_si512(a, _mm512_xor_si512(b, _mm512_set1_epi64(-1)));
+    }
+#endif
+};
+
+template < typename Op >
+inline void apply_words_scalar(uint64_t* const dst, const uint64_t* const src, const uint64_t nwords) {
+    for (uint64_t i{0}; i < nwords; ++i) {
+        dst[i] = Op::apply(dst[i], src[i]);
+    }
+}
+
+template < typename Op >
+inline uint64_t count_words_scalar(const uint64_t* const lhs, const uint64_t* const rhs, const uint64_t nwords) {
+    uint64_t count{0};
+    for (uint64_t i{0}; i < nwords; ++i) {
+        count += static_cast< uint64_t >(__builtin_popcountll(Op::apply(lhs[i], rhs[i])));
+    }
+    return count;
+}
+
+#ifdef SISL_BITSET_SIMD_X86
+template < typename Op >
+__attribute__((target("avx2"))) inline void apply_words_avx2(uint64_t* const dst, const uint64_t* const src,
+                                                              const uint64_t nwords) {
+    uint64_t i{0};
+    for (; (i + 4) <= nwords; i += 4) {
+        const __m256i a{_mm256_loadu_si256(reinterpret_cast< const __m256i* >(dst + i))};
+        const __m256i b{_mm256_loadu_si256(reinterpret_cast< const __m256i* >(src + i))};
+        _mm256_storeu_si256(reinterpret_cast< __m256i* >(dst + i), Op::apply(a, b));
+    }
+    apply_words_scalar< Op >(dst + i, src + i, nwords - i);
+}
+
+template < typename Op >
+__attribute__((target("avx512f"))) inline void apply_words_avx512(uint64_t* const dst, const uint64_t* const src,
+                                                                   const uint64_t nwords) {
+    uint64_t i{0};
+    for (; (i + 8) <= nwords; i += 8) {
+        _mm512_storeu_si512(dst + i, Op::apply(_mm512_loadu_si512(dst + i), _mm512_loadu_si512(src + i)));
+    }
+    apply_words_scalar< Op >(dst + i, src + i, nwords - i);
+}
+
+// Popcount of 256 bits using nibble lookup table (Mula's algorithm), returns 4 x 64 bit counts
+__attribute__((target("avx2"))) inline __m256i popcount_avx2(const __m256i v) {
+    const __m256i lookup{_mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2,
+                                          2, 3, 2, 3, 3, 4)};
+    const __m256i low_mask{_mm256_set1_epi8(0x0f)};
+    const __m256i lo{_mm256_and_si256(v, low_mask)};
+    const __m256i hi{_mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask)};
+    const __m256i cnt{_mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi))};
+    return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+template < typename Op >
+__attribute__((target("avx2"))) inline uint64_t count_words_avx2(const uint64_t* const lhs, const uint64_t* const rhs,
+                                                                  const uint64_t nwords) {
+    __m256i acc{_mm256_setzero_si256()};
+    uint64_t i{0};
+    for (; (i + 4) <= nwords; i += 4) {
+        const __m256i a{_mm256_loadu_si256(reinterpret_cast< const __m256i* >(lhs + i))};
+        const __m256i b{_mm256_loadu_si256(reinterpret_cast< const __m256i* >(rhs + i))};
+        acc = _mm256_add_epi64(acc, popcount_avx2(Op::apply(a, b)));
+    }
+    const uint64_t count{static_cast< uint64_t >(_mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) +
+                                                 _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3))};
+    return count + count_words_scalar< Op >(lhs + i, rhs + i, nwords - i);
+}
+
+template < typename Op >
+__attribute__((target("avx512f,avx512vpopcntdq"))) inline uint64_t
+count_words_avx512(const uint64_t* const lhs, const uint64_t* const rhs, const uint64_t nwords) {
+    __m512i acc{_mm512_setzero_si512()};
+    uint64_t i{0};
+    for (; (i + 8) <= nwords; i += 8) {
+        const __m512i v{Op::apply(_mm512_loadu_si512(lhs + i), _mm512_loadu_si512(rhs + i))};
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+    }
+    alignas(64) uint64_t lanes[8];
+    _mm512_store_si512(lanes, acc);
+    uint64_t count{0};
+    for (const auto lane : lanes) {
+        count += lane;
+    }
+    return count + count_words_scalar< Op >(lhs + i, rhs + i, nwords - i);
+}
+
+inline bool cpu_has_avx512_popcount() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq");
+}
+#else
+inline bool cpu_has_avx512_popcount() { return false; }
+#endif
+
+/**
+ * @brief Apply the word operation between 2 arrays in place, i.e dst[i] = Op(dst[i], src[i]). Arrays could be the same.
+ *
+ * @tparam Op One of word_and, word_or, word_xor, word_andnot
+ * @param dst Start of the word array which is both the lhs and the result
+ * @param src Start of the rhs word array
+ * @param nwords Total number of words to apply
+ */
+template < typename Op >
+inline void apply_words(uint64_t* const dst, const uint64_t* const src, const uint64_t nwords) {
+    using apply_fn_t = void (*)(uint64_t*, const uint64_t*, uint64_t);
+    static const apply_fn_t s_apply_fn{[]() -> apply_fn_t {
+#ifdef SISL_BITSET_SIMD_X86
+        if (cpu_has_avx512()) { return &apply_words_avx512< Op >; }
+        if (cpu_has_avx2()) { return &apply_words_avx2< Op >; }
+#endif
+        return &apply_words_scalar< Op >;
+    }()};
+    s_apply_fn(dst, src, nwords);
+}
+
+/**
+ * @brief Count the number of set bits in the result of the word operation between 2 arrays, without storing the
+ * result anywhere.
+ *
+ * @tparam Op One of word_and, word_or, word_xor, word_andnot
+ * @return uint64_t Total number of set bits in Op(lhs[i], rhs[i]) for all i < nwords
+ */
+template < typename Op >
+inline uint64_t count_words(const uint64_t* const lhs, const uint64_t* const rhs, const uint64_t nwords) {
+    using count_fn_t = uint64_t (*)(const uint64_t*, const uint64_t*, uint64_t);
+    static const count_fn_t s_count_fn{[]() -> count_fn_t {
+#ifdef SISL_BITSET_SIMD_X86
+        if (cpu_has_avx512_popcount()) { return &count_words_avx512< Op >; }
+        if (cpu_has_avx2()) { return &count_words_avx2< Op >; }
+#endif
+        return &count_words_scalar< Op >;
+    }()};
+    return s_count_fn(lhs, rhs, nwords);
+}
+
+} // namespace simd
+} // namespace sisl
@@ -223,7 +223,56 @@ static inline constexpr uint8_t get_leading_zeros(const uint64_t v) {
 #endif
 }
 
+#ifdef __SIZEOF_INT128__
+// 128 bit words are handled as two 64 bit halves, since std bit functions and type traits do not take the 128 bit
+// integer in the strict standard modes
+typedef unsigned __int128 uint128_t;
+
+static inline constexpr uint8_t get_trailing_zeros(const uint128_t v) {
+    const uint64_t low{static_cast< uint64_t >(v)};
+    return (low != 0) ? get_trailing_zeros(low)
+                      : static_cast< uint8_t >(64 + get_trailing_zeros(static_cast< uint64_t >(v >> 64)));
+}
+
+static inline constexpr uint8_t get_leading_zeros(const uint128_t v) {
+    const uint64_t high{static_cast< uint64_t >(v >> 64)};
+    return (high != 0) ? get_leading_zeros(high)
+                       : static_cast< uint8_t >(64 + get_leading_zeros(static_cast< uint64_t >(v)));
+}
+
+static inline constexpr uint8_t get_set_bit_count(const uint128_t v) {
+    return static_cast< uint8_t >(get_set_bit_count(static_cast< uint64_t >(v)) +
+                                  get_set_bit_count(static_cast< uint64_t >(v >> 64)));
+}
+
+static constexpr uint8_t logBase2(const uint128_t v) {
+    return static_cast< uint8_t >((v == 0) ? 255 : 127 - get_leading_zeros(v));
+}
+
+template < typename DataType >
+inline constexpr bool is_unsigned_word_v{std::is_unsigned_v< DataType > || std::is_same_v< DataType, uint128_t >};
+#else
+template < typename DataType >
+inline constexpr bool is_unsigned_word_v{std::is_unsigned_v< DataType >};
+#endif
+
+/**
+ * @brief Mask with only the given bit set and with the lsb nbits (1 to bits of DataType) set. Unlike the bit_mask and
+ * consecutive_bitmask tables, they work for words wider than 64 bits as well.
+ */
+template < typename DataType >
+static constexpr DataType word_bit_mask(const uint8_t bit) {
+    return static_cast< DataType >(static_cast< DataType >(1) << bit);
+}
+
+template < typename DataType >
+static constexpr DataType word_consecutive_bitmask(const uint8_t nbits) {
+    return (nbits >= (sizeof(DataType) * 8)) ? static_cast< DataType >(~DataType{})
+                                             : static_cast< DataType >((static_cast< DataType >(1) << nbits) - 1);
+}
+
 ENUM(bit_match_type, uint8_t, no_match, full_match, lsb_match, mid_match, msb_match)
+ENUM(bitwise_op, uint8_t, op_and, op_or, op_xor, op_andnot)
 
 struct bit_filter {
     // All of them are or'd
@@ -231,9 +280,9 @@ struct bit_filter {
     uint32_t n_mid_reqd;
     uint32_t n_msb_reqd;
 
-    bit_filter(const uint32_t lsb_reqd = 0, const uint32_t mid_reqd = 0, const uint32_t msb_reqd = 0) :
+    constexpr bit_filter(const uint32_t lsb_reqd = 0, const uint32_t mid_reqd = 0, const uint32_t msb_reqd = 0) :
             n_lsb_reqd{lsb_reqd}, n_mid_reqd{mid_reqd}, n_msb_reqd{msb_reqd} {}
-    bit_filter(const bit_filter&) = default;
+    constexpr bit_filter(const bit_filter&) = default;
     bit_filter(bit_filter&&) noexcept = default;
     bit_filter& operator=(const bit_filter&) = delete;
     bit_filter& operator=(bit_filter&&) noexcept = delete;
@@ -249,10 +298,10 @@ struct bit_match_result {
     uint8_t start_bit;
     uint8_t count;
 
-    bit_match_result(const bit_match_type match_type = bit_match_type::no_match, const uint8_t start_bit = 0,
+    constexpr bit_match_result(const bit_match_type match_type = bit_match_type::no_match, const uint8_t start_bit = 0,
                      const uint8_t count = 0) :
             match_type{match_type}, start_bit{start_bit}, count{count} {}
-    bit_match_result(const bit_match_result&) = default;
+    constexpr bit_match_result(const bit_match_result&) = default;
     bit_match_result(bit_match_result&&) noexcept = default;
     bit_match_result& operator=(const bit_match_result&) = delete;
     bit_match_result& operator=(bit_match_result&&) noexcept = delete;
@@ -268,47 +317,59 @@ struct bit_match_result {
     }
 };
 
+// Range of bits, returned by the searches of contiguous bits in the bitsets
+struct BitBlock {
+    uint64_t start_bit;
+    uint32_t nbits;
+    constexpr BitBlock(const uint64_t start, const uint32_t bits) : start_bit{start}, nbits{bits} {}
+    constexpr BitBlock(const BitBlock&) = default;
+    constexpr BitBlock(BitBlock&&) noexcept = default;
+    constexpr BitBlock& operator=(const BitBlock&) = default;
+    constexpr BitBlock& operator=(BitBlock&&) noexcept = default;
+    ~BitBlock() = default;
+};
+
 template < typename Word >
 class Bitword {
 public:
     typedef typename std::decay_t< Word > word_type;
     static constexpr uint8_t bits() { return (sizeof(word_type) * 8); }
     typedef typename word_type::word_t word_t;
-    static_assert(std::is_unsigned_v< word_t > && (sizeof(word_t) <= 16),
+    static_assert(is_unsigned_word_v< word_t > && (sizeof(word_t) <= 16),
                   "Underlying type must be unsigned of 128 bits or less.");
     typedef typename word_type::value_type value_type;
 
-    Bitword() { m_bits.set(0); }
-    explicit Bitword(const word_type& b) { m_bits.set(b.get()); }
-    explicit Bitword(const word_t& val) { m_bits.set(val); }
-    Bitword(const Bitword& other) : m_bits{other.to_integer()} {}
+    constexpr Bitword() { m_bits.set(0); }
+    constexpr explicit Bitword(const word_type& b) { m_bits.set(b.get()); }
+    constexpr explicit Bitword(const word_t& val) { m_bits.set(val); }
+    constexpr Bitword(const Bitword& other) : m_bits{other.to_integer()} {}
     Bitword(Bitword&&) noexcept = delete;
-    Bitword& operator=(const Bitword& rhs) {
+    constexpr Bitword& operator=(const Bitword& rhs) {
         if (this != &rhs) { m_bits.set(rhs.to_integer()); }
         return *this;
     }
     Bitword& operator=(Bitword&&) noexcept = delete;
     ~Bitword() = default;
 
-    void set(const word_t& value) { m_bits.set(value); }
+    constexpr void set(const word_t& value) { m_bits.set(value); }
 
     /**
      * @brief:
      * Total number of bits set in the bitset
      */
-    uint8_t get_set_count() const { return get_set_bit_count(m_bits.get()); }
+    constexpr uint8_t get_set_count() const { return get_set_bit_count(m_bits.get()); }
 
     /**
      * @brief:
      * Total number of bits reset in the bitset
      */
-    uint8_t get_reset_count() const { return bits() - get_set_bit_count(m_bits.get()); }
+    constexpr uint8_t get_reset_count() const { return bits() - get_set_bit_count(m_bits.get()); }
 
-    word_t set_bits(const uint8_t start, const uint8_t nbits) {
+    constexpr word_t set_bits(const uint8_t start, const uint8_t nbits) {
         assert(start < bits());
         return set_reset_bits(start, nbits, true /* set */);
     }
-    word_t reset_bits(const uint8_t start, const uint8_t nbits) {
+    constexpr word_t reset_bits(const uint8_t start, const uint8_t nbits) {
         assert(start < bits());
         return set_reset_bits(start, nbits, false /* set */);
     }
@@ -321,12 +382,12 @@ public:
      *
      * Returns the final bitmap set of entry_type
      */
-    word_t set_reset_bit(const uint8_t start, const bool set) {
+    constexpr word_t set_reset_bit(const uint8_t start, const bool set) {
         assert(start < bits());
         if (set) {
-            return m_bits.or_with(bit_mask[start]);
+            return m_bits.or_with(word_bit_mask< word_t >(start));
         } else {
-            return m_bits.and_with(~bit_mask[start]);
+            return m_bits.and_with(static_cast< word_t >(~word_bit_mask< word_t >(start)));
         }
     }
 
@@ -339,13 +400,13 @@ public:
      *
      * Returns the final bitmap set of entry_type
      */
-    word_t set_reset_bits(const uint8_t start, const uint8_t nbits, const bool set) {
+    constexpr word_t set_reset_bits(const uint8_t start, const uint8_t nbits, const bool set) {
         assert(start < bits());
         if (nbits == 1) { return set_reset_bit(start, set); }
 
         const uint8_t wanted_bits{std::min< uint8_t >(bits() - start, nbits)};
         const word_t bit_mask{
-            static_cast< word_t >(static_cast< word_t >(consecutive_bitmask[wanted_bits - 1]) << start)};
+            static_cast< word_t >(word_consecutive_bitmask< word_t >(wanted_bits) << start)};
         if (set) {
             return m_bits.or_with(bit_mask);
         } else {
@@ -353,28 +414,81 @@ public:
         }
     }
 
-    bool get_bitval(const uint8_t bit) const { return (m_bits.get() & bit_mask[bit]); }
+    /**
+     * @brief: Set multiple bits specified at the start, only if all of them are currently reset. With safe_bits it is
+     * done using compare and swap and hence out of many concurrent callers trying to set overlapping bits, only one
+     * of them succeeds.
+     * Params:
+     * Start - A bit number which is expected to be less than sizeof(entry_type) * 8
+     * nBits - Total number of bits to set from start bit num.
+     *
+     * Returns true if all the bits are set by this call, false if any one of them was already set
+     */
+    constexpr bool try_set_bits(const uint8_t start, const uint8_t nbits) {
+        assert(start < bits());
+        assert(nbits > 0);
+
+        const uint8_t wanted_bits{std::min< uint8_t >(bits() - start, nbits)};
+        const word_t mask{static_cast< word_t >(word_consecutive_bitmask< word_t >(wanted_bits) << start)};
+        word_t old_value{m_bits.get()};
+        while ((old_value & mask) == static_cast< word_t >(0)) {
+            if (m_bits.set_if(old_value, static_cast< word_t >(old_value | mask))) { return true; }
+            old_value = m_bits.get();
+        }
+        return false;
+    }
+
+    /**
+     * @brief: Reset multiple bits specified at the start, only if all of them are currently set. It is the counterpart
+     * of try_set_bits and with safe_bits only one of many concurrent callers resetting overlapping bits succeeds.
+     *
+     * Returns true if all the bits are reset by this call, false if any one of them was already reset
+     */
+    constexpr bool try_reset_bits(const uint8_t start, const uint8_t nbits) {
+        assert(start < bits());
+        assert(nbits > 0);
+
+        const uint8_t wanted_bits{std::min< uint8_t >(bits() - start, nbits)};
+        const word_t mask{static_cast< word_t >(word_consecutive_bitmask< word_t >(wanted_bits) << start)};
+        word_t old_value{m_bits.get()};
+        while ((old_value & mask) == mask) {
+            if (m_bits.set_if(old_value, static_cast< word_t >(old_value & ~mask))) { return true; }
+            old_value = m_bits.get();
+        }
+        return false;
+    }
+
+    /**
+     * @brief: Bitwise or/and/xor the entire word with the value. With safe_bits, each of them is atomic.
+     *
+     * Returns the final bitmap set of entry_type
+     */
+    constexpr word_t or_with(const word_t value) { return m_bits.or_with(value); }
+    constexpr word_t and_with(const word_t value) { return m_bits.and_with(value); }
+    constexpr word_t xor_with(const word_t value) { return m_bits.xor_with(value); }
+
+    constexpr bool get_bitval(const uint8_t bit) const { return (m_bits.get() & word_bit_mask< word_t >(bit)) != 0; }
 
     /**
      * @brief
      * is_bit_set_reset: Is bits either set or reset from start bit
      */
-    bool is_bit_set_reset(const uint8_t start, const bool check_for_set) const {
+    constexpr bool is_bit_set_reset(const uint8_t start, const bool check_for_set) const {
         assert(start < bits());
-        const word_t v{m_bits.get() & static_cast< word_t >(bit_mask[start])};
+        const word_t v{static_cast< word_t >(m_bits.get() & word_bit_mask< word_t >(start))};
         return check_for_set ? (v != static_cast< word_t >(0)) : (v == static_cast< word_t >(0));
     }
 
-    bool is_bits_set_reset(const uint8_t start, const uint8_t nbits, const bool check_for_set) const {
+    constexpr bool is_bits_set_reset(const uint8_t start, const uint8_t nbits, const bool check_for_set) const {
         assert(start < bits());
         if (nbits == 1) { return (is_bit_set_reset(start, check_for_set)); }
 
         const word_t actual{extract(start, nbits)};
-        const word_t expected{static_cast< word_t >(check_for_set ? consecutive_bitmask[nbits - 1] : 0)};
+        const word_t expected{static_cast< word_t >(check_for_set ? word_consecutive_bitmask< word_t >(nbits) : 0)};
         return (actual == expected);
     }
 
-    bool get_next_set_bit(const uint8_t start, uint8_t* const p_set_bit) const {
+    constexpr bool get_next_set_bit(const uint8_t start, uint8_t* const p_set_bit) const {
         assert(start < bits());
         assert(p_set_bit);
         const word_t e{extract(start, bits())};
@@ -386,7 +500,7 @@ public:
         }
     }
 
-    bool get_next_reset_bit(const uint8_t start, uint8_t* const p_reset_bit) const {
+    constexpr bool get_next_reset_bit(const uint8_t start, uint8_t* const p_reset_bit) const {
         assert(start < bits());
         assert(p_reset_bit);
         const word_t e{~extract(start, bits())};
@@ -398,7 +512,7 @@ public:
         }
     }
 
-    uint8_t get_next_reset_bits(const uint8_t start, uint8_t* const pcount) const {
+    constexpr uint8_t get_next_reset_bits(const uint8_t start, uint8_t* const pcount) const {
         assert(start < bits());
         assert(pcount);
         *pcount = 0;
@@ -422,7 +536,7 @@ public:
     }
 
     // match the number of bits required at the beginning(lsb), middle(mid), end(msb) of the value
-    bit_match_result get_next_reset_bits_filtered(const uint8_t offset, const bit_filter& filter) const {
+    constexpr bit_match_result get_next_reset_bits_filtered(const uint8_t offset, const bit_filter& filter) const {
         assert(offset < bits());
         bit_match_result result{bit_match_type::no_match, offset};
         bool lsb_search{offset == 0};
@@ -471,7 +585,7 @@ public:
         return result;
     }
 
-    bool set_next_reset_bit(const uint8_t start, const uint8_t maxbits, uint8_t* const p_bit) {
+    constexpr bool set_next_reset_bit(const uint8_t start, const uint8_t maxbits, uint8_t* const p_bit) {
         assert(start < bits());
         assert(p_bit);
         const bool found{get_next_reset_bit(start, p_bit)};
@@ -481,13 +595,13 @@ public:
         return true;
     }
 
-    bool set_next_reset_bit(const uint8_t start, uint8_t* const* p_bit) {
+    constexpr bool set_next_reset_bit(const uint8_t start, uint8_t* const* p_bit) {
         return set_next_reset_bit(start, bits(), p_bit);
     }
 
-    word_t right_shift(const uint8_t nbits) { return m_bits.right_shift(nbits); }
+    constexpr word_t right_shift(const uint8_t nbits) { return m_bits.right_shift(nbits); }
 
-    uint8_t get_max_contiguous_reset_bits(const uint8_t start, uint8_t* const pmax_count) const {
+    constexpr uint8_t get_max_contiguous_reset_bits(const uint8_t start, uint8_t* const pmax_count) const {
         assert(start < bits());
         assert(pmax_count);
 
@@ -532,12 +646,12 @@ public:
         return start_largest_group;
     }
 
-    word_t to_integer() const { return m_bits.get(); }
+    constexpr word_t to_integer() const { return m_bits.get(); }
 
     std::string to_string() const {
         std::ostringstream oSS{};
         const word_t e{m_bits.get()};
-        word_t mask{static_cast< word_t >(bit_mask[bits() - 1])};
+        word_t mask{word_bit_mask< word_t >(bits() - 1)};
         for (uint8_t bit{0}; bit < bits(); ++bit, mask >>= 1) {
             oSS << (((e & mask) == mask) ? '1' : '0');
         }
@@ -546,15 +660,15 @@ public:
 
     void print() const { std::cout << to_string() << std::endl; }
 
-    bool operator==(const Bitword& rhs) const { return m_bits == rhs.m_bits; }
+    constexpr bool operator==(const Bitword& rhs) const { return m_bits == rhs.m_bits; }
 
-    bool operator!=(const Bitword& rhs) const { return m_bits != rhs.m_bits; }
+    constexpr bool operator!=(const Bitword& rhs) const { return m_bits != rhs.m_bits; }
 
 private:
-    word_t extract(const uint8_t start, const uint8_t nbits) const {
+    constexpr word_t extract(const uint8_t start, const uint8_t nbits) const {
         const uint8_t wanted_bits{std::min< uint8_t >(bits() - start, nbits)};
         assert(wanted_bits > 0);
-        const word_t mask{static_cast< word_t >(static_cast< word_t >(consecutive_bitmask[wanted_bits - 1]) << start)};
+        const word_t mask{static_cast< word_t >(word_consecutive_bitmask< word_t >(wanted_bits) << start)};
         return ((m_bits.get() & mask) >> start);
     }
 
@@ -578,22 +692,24 @@ std::basic_ostream< charT, traits >& operator<<(std::basic_ostream< charT, trait
     return outStream;
 }
 
+// Bitset words follow its 8 byte aligned header, so the 128 bit words are held with at most 8 byte alignment
+#pragma pack(8)
 template < typename WType >
 class unsafe_bits {
 public:
     typedef std::decay_t< WType > word_t;
-    static_assert(std::is_unsigned_v< word_t >, "Underlying type must be unsigned.");
+    static_assert(is_unsigned_word_v< word_t >, "Underlying type must be unsigned.");
     typedef word_t value_type;
 
-    unsafe_bits(const word_t& t = static_cast< word_t >(0)) : m_Value{t} {}
+    constexpr unsafe_bits(const word_t& t = static_cast< word_t >(0)) : m_Value{t} {}
     unsafe_bits(const unsafe_bits&) = delete;
     unsafe_bits(unsafe_bits&&) noexcept = delete;
     unsafe_bits& operator=(const unsafe_bits&) = delete;
     unsafe_bits& operator=(unsafe_bits&&) noexcept = delete;
     ~unsafe_bits() = default;
 
-    void set(const word_t& value) { m_Value = value; }
-    bool set_if(const word_t& old_value, const word_t& new_value) {
+    constexpr void set(const word_t& value) { m_Value = value; }
+    constexpr bool set_if(const word_t& old_value, const word_t& new_value) {
         if (m_Value == old_value) {
             m_Value = new_value;
             return true;
@@ -601,36 +717,43 @@ public:
         return false;
     }
 
-    word_t or_with(const word_t value) {
+    constexpr word_t or_with(const word_t value) {
         m_Value |= value;
         return m_Value;
     }
 
-    word_t and_with(const word_t value) {
+    constexpr word_t and_with(const word_t value) {
         m_Value &= value;
         return m_Value;
     }
 
-    word_t right_shift(const uint8_t nbits) {
+    constexpr word_t xor_with(const word_t value) {
+        m_Value ^= value;
+        return m_Value;
+    }
+
+    constexpr word_t right_shift(const uint8_t nbits) {
         m_Value >>= nbits;
         return m_Value;
     }
 
-    word_t get() const { return m_Value; }
+    constexpr word_t get() const { return m_Value; }
 
-    bool operator==(const unsafe_bits& rhs) const { return get() == rhs.get(); }
+    constexpr bool operator==(const unsafe_bits& rhs) const { return get() == rhs.get(); }
 
-    bool operator!=(const unsafe_bits& rhs) const { return get() != rhs.get(); }
+    constexpr bool operator!=(const unsafe_bits& rhs) const { return get() != rhs.get(); }
 
 private:
     value_type m_Value;
 };
+#pragma pack()
 
 template < typename WType >
 class safe_bits {
 public:
     typedef std::decay_t< WType > word_t;
     static_assert(std::is_unsigned_v< word_t >, "Underlying type must be unsigned.");
+    static_assert(sizeof(word_t) <= sizeof(uint64_t), "Atomic words wider than 64 bits are not lock free.");
     typedef std::atomic< word_t > value_type;
 
     safe_bits(const word_t& t = static_cast< word_t >(0)) : m_Value{t} {}
@@ -641,9 +764,9 @@ public:
     ~safe_bits() = default;
 
     void set(const word_t& bits) { m_Value.store(bits, std::memory_order_relaxed); }
-    void set_if(const word_t& old_value, const word_t& new_value) {
+    bool set_if(const word_t& old_value, const word_t& new_value) {
         word_t expected_value{old_value};
-        return m_Value.compare_exchange_strong(expected_value, new_value, std::memory_order_relaxed);
+        return m_Value.compare_exchange_strong(expected_value, new_value, std::memory_order_acq_rel);
     }
 
     word_t or_with(const word_t value) {
@@ -656,6 +779,11 @@ public:
         return (old_value & value);
     }
 
+    word_t xor_with(const word_t value) {
+        const word_t old_value{m_Value.fetch_xor(value, std::memory_order_relaxed)};
+        return (old_value ^ value);
+    }
+
     word_t right_shift(const uint8_t nbits) {
         word_t old_value{m_Value.get(std::memory_order_acquire)};
         word_t new_value{static_cast< word_t >(old_value >> nbits)};
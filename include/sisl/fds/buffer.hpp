@@ -18,10 +18,16 @@
 #include <memory>
 #include <array>
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstring>
+#include <limits>
 #include <type_traits>
+#include <vector>
 
 #include <boost/preprocessor/stringize.hpp>
+#include <folly/small_vector.h>
 #ifdef __linux__
 #include <malloc.h>
 #include <sys/uio.h>
@@ -39,44 +45,6 @@ struct blob {
     blob(uint8_t* const b, const uint32_t s) : bytes{b}, size{s} {}
 };
 
-struct sg_list {
-    uint64_t size; // total size of data pointed by iovs;
-    std::vector< iovec > iovs;
-};
-
-struct sg_iterator {
-    sg_iterator(const std::vector< iovec >& v) : m_input_iovs{v} { assert(v.size() > 0); }
-
-    std::vector< iovec > next_iovs(uint32_t size) {
-        std::vector< iovec > ret_iovs;
-        uint64_t remain_size = size;
-
-        while ((remain_size > 0) && (m_cur_index < m_input_iovs.size())) {
-            const auto& inp_iov = m_input_iovs[m_cur_index];
-            iovec this_iov;
-            this_iov.iov_base = static_cast< uint8_t* >(inp_iov.iov_base) + m_cur_offset;
-            if (remain_size < inp_iov.iov_len - m_cur_offset) {
-                this_iov.iov_len = remain_size;
-                m_cur_offset += remain_size;
-            } else {
-                this_iov.iov_len = inp_iov.iov_len - m_cur_offset;
-                ++m_cur_index;
-                m_cur_offset = 0;
-            }
-
-            ret_iovs.push_back(this_iov);
-            assert(remain_size >= this_iov.iov_len);
-            remain_size -= this_iov.iov_len;
-        }
-
-        return ret_iovs;
-    }
-
-    const std::vector< iovec >& m_input_iovs;
-    uint64_t m_cur_offset{0};
-    size_t m_cur_index{0};
-};
-
 // typedef size_t buftag_t;
 
 // TODO: Ideally we want this to be registration, but this tag needs to be used as template
@@ -96,6 +64,14 @@ VENUM(buftag, uint8_t,   // Tags
       sentinel = 10      // This is expected to be the last. Anything below is not registered
 )
 
+/*
+ * Metrics of the aligned buffers of each buftag: live bytes, number of allocations, histogram of the allocation sizes
+ * and the high watermark of the live bytes.
+ *
+ * With sampling enabled, 1 in every N allocations records its stack, so that the buffers which are alive for long can
+ * be attributed to the code which allocated them. Sampled buffers older than the long lived age are reported by
+ * dump_json (grouped by the allocation stack) and as the long lived bytes of their buftag.
+ */
 class AlignedAllocatorMetrics : public MetricsGroup {
 public:
     AlignedAllocatorMetrics(const AlignedAllocatorMetrics&) = delete;
@@ -103,19 +79,87 @@ public:
     AlignedAllocatorMetrics& operator=(const AlignedAllocatorMetrics&) = delete;
     AlignedAllocatorMetrics& operator=(AlignedAllocatorMetrics&&) noexcept = delete;
 
-    AlignedAllocatorMetrics() : MetricsGroup("AlignedAllocation", "Singleton") {
-        for (auto t{(uint8_t)buftag::common}; t < (uint8_t)buftag::sentinel; ++t) {
-            const std::string name = "buftag_" + enum_name((buftag)t);
-            m_tag_idx[t] = m_impl_ptr->register_counter(name, name, _publish_as::publish_as_gauge);
-        }
-        register_me_to_farm();
+    AlignedAllocatorMetrics();
+    ~AlignedAllocatorMetrics();
+
+    void increment(const buftag tag, const size_t size, const uint8_t* const buf = nullptr) {
+        const auto t{static_cast< size_t >(tag)};
+        m_impl_ptr->counter_increment(m_tag_idx[t], size);
+        m_impl_ptr->counter_increment(m_tag_alloc_idx[t], 1);
+        m_impl_ptr->histogram_observe(m_tag_size_hist_idx[t], size);
+
+        auto& stats{m_tag_stats[t]};
+        stats.alloc_count.fetch_add(1, std::memory_order_relaxed);
+        const int64_t live{stats.live_bytes.fetch_add(size, std::memory_order_relaxed) + static_cast< int64_t >(size)};
+        int64_t hwm{stats.high_watermark.load(std::memory_order_relaxed)};
+        while ((live > hwm) && !stats.high_watermark.compare_exchange_weak(hwm, live, std::memory_order_relaxed)) {}
+
+        if ((buf != nullptr) && (m_sample_one_in.load(std::memory_order_relaxed) != 0)) { sample(tag, size, buf); }
     }
 
-    void increment(const buftag tag, const size_t size) { m_impl_ptr->counter_increment(m_tag_idx[(size_t)tag], size); }
-    void decrement(const buftag tag, const size_t size) { m_impl_ptr->counter_decrement(m_tag_idx[(size_t)tag], size); }
+    void decrement(const buftag tag, const size_t size, const uint8_t* const buf = nullptr) {
+        const auto t{static_cast< size_t >(tag)};
+        m_impl_ptr->counter_decrement(m_tag_idx[t], size);
+        m_tag_stats[t].live_bytes.fetch_sub(size, std::memory_order_relaxed);
+        if ((buf != nullptr) && (m_nsampled.load(std::memory_order_relaxed) != 0)) { drop_sample(buf); }
+    }
+
+    void pool_hit() { m_impl_ptr->counter_increment(m_pool_hit_idx, 1); }
+    void pool_miss() { m_impl_ptr->counter_increment(m_pool_miss_idx, 1); }
+
+    int64_t live_bytes(const buftag tag) const {
+        return m_tag_stats[static_cast< size_t >(tag)].live_bytes.load(std::memory_order_relaxed);
+    }
+    int64_t high_watermark(const buftag tag) const {
+        return m_tag_stats[static_cast< size_t >(tag)].high_watermark.load(std::memory_order_relaxed);
+    }
+    uint64_t alloc_count(const buftag tag) const {
+        return m_tag_stats[static_cast< size_t >(tag)].alloc_count.load(std::memory_order_relaxed);
+    }
+
+    // Restart the high watermarks from the current live bytes
+    void reset_high_watermarks();
+
+    // Sample 1 in every one_in allocations (of each thread). Buffers freed before the long_lived age are not reported.
+    void enable_sampling(const uint32_t one_in, const std::chrono::milliseconds long_lived);
+
+    // Stop sampling the new allocations and drop the samples recorded so far
+    void disable_sampling();
+
+    // Number of sampled buffers which are not freed yet
+    uint64_t sampled_count() const { return m_nsampled.load(std::memory_order_relaxed); }
+
+    // Number of distinct allocation stacks kept for the sampled buffers
+    size_t sampled_stack_count() const;
+
+    nlohmann::json dump_json() const;
+
+    struct sampler;
 
 private:
+    void sample(const buftag tag, const size_t size, const uint8_t* const buf);
+    void drop_sample(const uint8_t* const buf);
+    void on_gather();
+
+private:
+    struct alignas(64) tag_stats {
+        std::atomic< int64_t > live_bytes{0};
+        std::atomic< int64_t > high_watermark{0};
+        std::atomic< uint64_t > alloc_count{0};
+    };
+
     std::array< size_t, (size_t)buftag::sentinel > m_tag_idx;
+    std::array< size_t, (size_t)buftag::sentinel > m_tag_alloc_idx;
+    std::array< size_t, (size_t)buftag::sentinel > m_tag_size_hist_idx;
+    std::array< size_t, (size_t)buftag::sentinel > m_tag_hwm_idx;
+    std::array< size_t, (size_t)buftag::sentinel > m_tag_long_lived_idx;
+    size_t m_pool_hit_idx;
+    size_t m_pool_miss_idx;
+    std::array< tag_stats, (size_t)buftag::sentinel > m_tag_stats;
+
+    std::atomic< uint32_t > m_sample_one_in{0};
+    std::atomic< uint64_t > m_nsampled{0};
+    std::unique_ptr< sampler > m_sampler;
 };
 
 // NOTE:  Might consider writing this as a true allocator
@@ -131,7 +175,7 @@ public:
     virtual uint8_t* aligned_alloc(const size_t align, const size_t sz, const sisl::buftag tag);
     virtual void aligned_free(uint8_t* const b, const sisl::buftag tag);
     virtual uint8_t* aligned_realloc(uint8_t* const old_buf, const size_t align, const size_t new_sz,
-                                     const size_t old_sz = 0);
+                                     const size_t old_sz = 0, const sisl::buftag tag = sisl::buftag::common);
 
     template < typename T >
     void aligned_delete(T* const p, const sisl::buftag tag) {
@@ -153,6 +197,120 @@ public:
     }
 };
 
+/*
+ * AlignedAllocatorImpl which keeps the freed buffers of a few sizes (size classes), so that the frequent I/O sizes are
+ * served without going to malloc. Each thread has a small cache per size class, which exchanges the buffers in batches
+ * with a depot shared by all the threads. Buffers of a size class are allocated at the pool alignment, so requests of
+ * smaller alignment share them.
+ *
+ * Only aligned_pool_alloc/aligned_pool_free are pooled, since the size is needed on free. Sizes which are larger than
+ * all the size classes or less than half of the smallest class that fits are allocated as usual. Pooled buffers are
+ * regular aligned allocations, so they can also be freed by aligned_free/aligned_realloc (and a buffer is returned to
+ * the pool only if it is actually large and aligned enough for its size class).
+ *
+ * When the allocator is destroyed, the buffers cached by the other threads are freed by each of them on its next pool
+ * call (of any pooled allocator) or when it exits.
+ */
+class PooledAlignedAllocatorImpl : public AlignedAllocatorImpl {
+public:
+    static constexpr size_t npos{std::numeric_limits< size_t >::max()};
+
+    PooledAlignedAllocatorImpl(std::vector< size_t > size_classes = {4096, 8192, 64 * 1024, 1024 * 1024},
+                               const size_t pool_align = 4096, const size_t thread_cache_bytes = 4 * 1024 * 1024,
+                               const size_t depot_bytes = 256 * 1024 * 1024);
+    PooledAlignedAllocatorImpl(const PooledAlignedAllocatorImpl&) = delete;
+    PooledAlignedAllocatorImpl(PooledAlignedAllocatorImpl&&) noexcept = delete;
+    PooledAlignedAllocatorImpl& operator=(const PooledAlignedAllocatorImpl&) noexcept = delete;
+    PooledAlignedAllocatorImpl& operator=(PooledAlignedAllocatorImpl&&) noexcept = delete;
+    ~PooledAlignedAllocatorImpl() override;
+
+    uint8_t* aligned_pool_alloc(const size_t align, const size_t sz, const sisl::buftag tag) override;
+    void aligned_pool_free(uint8_t* const b, const size_t sz, const sisl::buftag tag) override;
+
+    // Index of the size class used for the size, npos if it is not pooled
+    size_t size_class_of(const size_t sz) const;
+
+    // Number of buffers in the depot, the buffers in the thread caches are not included
+    size_t depot_count() const;
+
+    // Free the buffers in the depot and in the cache of the calling thread
+    void release_cached();
+
+    struct pool_depot;
+    struct thread_cache;
+
+private:
+    thread_cache* my_cache();
+
+private:
+    std::shared_ptr< pool_depot > m_depot;
+    size_t m_id;
+};
+
+/*
+ * AlignedAllocatorImpl which carves the buffers out of a few large regions mapped upfront and backed by hugepages
+ * (MAP_HUGETLB if hugepages are reserved, else transparent hugepages advised with madvise). Since the regions are
+ * mapped only once, they can be registered with the device (e.g. io_uring fixed buffers) with registered_regions() and
+ * buffer_index() of a buffer gives the index of its region to be used as the registered buffer id.
+ *
+ * Buffers are allocated in multiples of the chunk size within a region, so alignment upto the chunk size is served
+ * from the arena. Larger alignments and the allocations which don't fit in the arena go to the heap, for which
+ * buffer_index() returns npos.
+ */
+class HugePageArenaAllocatorImpl : public AlignedAllocatorImpl {
+public:
+    static constexpr uint32_t npos{std::numeric_limits< uint32_t >::max()};
+    static constexpr uint64_t hugepage_size{2 * 1024 * 1024};
+
+    HugePageArenaAllocatorImpl(const uint64_t region_size = 64 * 1024 * 1024, const uint32_t nregions = 4,
+                               const uint32_t chunk_size = 4096);
+    HugePageArenaAllocatorImpl(const HugePageArenaAllocatorImpl&) = delete;
+    HugePageArenaAllocatorImpl(HugePageArenaAllocatorImpl&&) noexcept = delete;
+    HugePageArenaAllocatorImpl& operator=(const HugePageArenaAllocatorImpl&) noexcept = delete;
+    HugePageArenaAllocatorImpl& operator=(HugePageArenaAllocatorImpl&&) noexcept = delete;
+    ~HugePageArenaAllocatorImpl() override;
+
+    uint8_t* aligned_alloc(const size_t align, const size_t sz, const sisl::buftag tag) override;
+    void aligned_free(uint8_t* const b, const sisl::buftag tag) override;
+    // Buffers of the arena keep the tag they were allocated with
+    uint8_t* aligned_realloc(uint8_t* const old_buf, const size_t align, const size_t new_sz, const size_t old_sz = 0,
+                             const sisl::buftag tag = sisl::buftag::common) override;
+    size_t buf_size(uint8_t* buf) const override;
+
+    // Index of the region the buffer is in, npos if it is not allocated from the arena
+    uint32_t buffer_index(const uint8_t* const buf) const {
+        if ((buf < m_base) || (buf >= m_base + (m_region_size * m_nregions))) { return npos; }
+        return static_cast< uint32_t >((buf - m_base) / m_region_size);
+    }
+
+    // Regions to register with the device, in the order of their index
+    std::vector< iovec > registered_regions() const;
+
+    bool is_hugetlb() const { return m_hugetlb; }
+    uint64_t arena_bytes(const sisl::buftag tag) const {
+        return m_tag_bytes[static_cast< size_t >(tag)].load(std::memory_order_relaxed);
+    }
+    uint64_t heap_fallback_count() const { return m_fallback_count.load(std::memory_order_relaxed); }
+
+    struct arena_region;
+
+private:
+    uint8_t* arena_alloc(const uint32_t nchunks, const sisl::buftag tag);
+
+private:
+    uint8_t* m_base{nullptr};
+    uint64_t m_region_size;
+    uint32_t m_nregions;
+    uint32_t m_chunk_size;
+    bool m_hugetlb{false};
+    std::vector< std::unique_ptr< arena_region > > m_regions;
+    std::atomic< uint32_t > m_next_region{0};
+
+    // Bytes allocated from the arena for each tag
+    std::array< std::atomic< uint64_t >, static_cast< size_t >(buftag::sentinel) > m_tag_bytes{};
+    std::atomic< uint64_t > m_fallback_count{0};
+};
+
 class AlignedAllocator {
 public:
     static AlignedAllocator& instance() {
@@ -181,6 +339,8 @@ private:
 #define sisl_aligned_alloc sisl::AlignedAllocator::allocator().aligned_alloc
 #define sisl_aligned_free sisl::AlignedAllocator::allocator().aligned_free
 #define sisl_aligned_realloc sisl::AlignedAllocator::allocator().aligned_realloc
+#define sisl_aligned_pool_alloc sisl::AlignedAllocator::allocator().aligned_pool_alloc
+#define sisl_aligned_pool_free sisl::AlignedAllocator::allocator().aligned_pool_free
 
 template < typename T, buftag Tag >
 struct aligned_deleter {
@@ -237,25 +397,25 @@ struct io_blob : public blob {
     void buf_alloc(const size_t sz, const uint32_t align_size = 512, const buftag tag = buftag::common) {
         aligned = (align_size != 0);
         blob::size = sz;
-        blob::bytes = aligned ? sisl_aligned_alloc(align_size, sz, tag) : (uint8_t*)malloc(sz);
+        blob::bytes = aligned ? sisl_aligned_pool_alloc(align_size, sz, tag) : (uint8_t*)malloc(sz);
     }
 
     void buf_free(const buftag tag = buftag::common) const {
-        aligned ? sisl_aligned_free(blob::bytes, tag) : std::free(blob::bytes);
+        aligned ? sisl_aligned_pool_free(blob::bytes, blob::size, tag) : std::free(blob::bytes);
     }
 
-    void buf_realloc(const size_t new_size, const uint32_t align_size = 512,
-                     [[maybe_unused]] const buftag tag = buftag::common) {
+    void buf_realloc(const size_t new_size, const uint32_t align_size = 512, const buftag tag = buftag::common) {
         uint8_t* new_buf{nullptr};
         if (aligned) {
             // aligned before, so do not need check for new align size, once aligned will be aligned on realloc also
-            new_buf = sisl_aligned_realloc(blob::bytes, align_size, new_size, blob::size);
+            new_buf = sisl_aligned_realloc(blob::bytes, align_size, new_size, blob::size, tag);
         } else if (align_size != 0) {
             // Not aligned before, but need aligned now
-            uint8_t* const new_buf{sisl_aligned_alloc(align_size, new_size, buftag::common)};
+            new_buf = sisl_aligned_alloc(align_size, new_size, tag);
             std::memcpy(static_cast< void* >(new_buf), static_cast< const void* >(blob::bytes),
                         std::min(new_size, static_cast< size_t >(blob::size)));
             std::free(blob::bytes);
+            aligned = true;
         } else {
             // don't bother about alignment, just do standard realloc
             new_buf = (uint8_t*)std::realloc(blob::bytes, new_size);
@@ -281,7 +441,7 @@ struct byte_array_impl : public io_blob {
             io_blob(bytes, size, is_aligned) {}
     ~byte_array_impl() { io_blob::buf_free(m_tag); }
 
-    buftag m_tag;
+    buftag m_tag{buftag::common};
 };
 
 using byte_array = std::shared_ptr< byte_array_impl >;
@@ -293,6 +453,201 @@ inline byte_array to_byte_array(const sisl::io_blob& blob) {
     return std::make_shared< byte_array_impl >(blob.bytes, blob.size, blob.aligned);
 }
 
+// Most of the I/Os have only a few iovs, which are kept inline without any allocation
+using iovec_array = folly::small_vector< iovec, 4 >;
+
+/*
+ * List of buffers for scatter/gather I/O. None of the operations copy the data the iovs point to, except gather and
+ * scatter. iov_data()/iov_count() can be passed as is to readv/writev/preadv2/pwritev2.
+ */
+struct sg_list {
+    uint64_t size{0}; // total size of data pointed by iovs;
+    iovec_array iovs;
+
+    const iovec* iov_data() const { return iovs.data(); }
+    int iov_count() const { return static_cast< int >(iovs.size()); }
+    bool is_contiguous() const { return (iovs.size() <= 1); }
+
+    void append(const iovec& iov) {
+        if (iov.iov_len == 0) { return; }
+        iovs.push_back(iov);
+        size += iov.iov_len;
+    }
+    void append(uint8_t* const buf, const uint64_t len) { append(iovec{buf, len}); }
+    void append(const sg_list& other) {
+        // Inserting the own range of iovs is not allowed, so the list appended to itself goes through a copy
+        if (&other == this) { return append(sg_list{other}); }
+        iovs.insert(iovs.end(), other.iovs.begin(), other.iovs.end());
+        size += other.size;
+    }
+
+    void prepend(const iovec& iov) {
+        if (iov.iov_len == 0) { return; }
+        iovs.insert(iovs.begin(), iov);
+        size += iov.iov_len;
+    }
+    void prepend(uint8_t* const buf, const uint64_t len) { prepend(iovec{buf, len}); }
+    void prepend(const sg_list& other) {
+        if (&other == this) { return prepend(sg_list{other}); }
+        iovs.insert(iovs.begin(), other.iovs.begin(), other.iovs.end());
+        size += other.size;
+    }
+
+    static sg_list concat(const sg_list& first, const sg_list& second) {
+        sg_list ret{first};
+        ret.append(second);
+        return ret;
+    }
+
+    // View of len bytes starting at the offset, pointing to the same buffers
+    sg_list slice(const uint64_t offset, const uint64_t len) const {
+        assert(offset + len <= size);
+        sg_list ret;
+        uint64_t skip{offset};
+        uint64_t remain{len};
+        for (size_t i{0}; (i < iovs.size()) && (remain > 0); ++i) {
+            if (skip >= iovs[i].iov_len) {
+                skip -= iovs[i].iov_len;
+                continue;
+            }
+            const uint64_t this_len{std::min< uint64_t >(iovs[i].iov_len - skip, remain)};
+            ret.append(static_cast< uint8_t* >(iovs[i].iov_base) + skip, this_len);
+            remain -= this_len;
+            skip = 0;
+        }
+        return ret;
+    }
+
+    // Keep only the first len bytes
+    void truncate(const uint64_t len) {
+        assert(len <= size);
+        uint64_t remain{len};
+        size_t i{0};
+        for (; (i < iovs.size()) && (remain > 0); ++i) {
+            if (iovs[i].iov_len >= remain) {
+                iovs[i].iov_len = remain;
+                remain = 0;
+            } else {
+                remain -= iovs[i].iov_len;
+            }
+        }
+        iovs.erase(iovs.begin() + i, iovs.end());
+        size = len;
+    }
+
+    // Split the list at the offset, this keeps the bytes before the offset and the rest are returned
+    sg_list split_at(const uint64_t offset) {
+        sg_list tail{slice(offset, size - offset)};
+        truncate(offset);
+        return tail;
+    }
+
+    // Copy len bytes of the data starting at the offset to/from a contiguous buffer. Returns the bytes copied
+    uint64_t copy_to(uint8_t* const dst, const uint64_t offset = 0, const uint64_t len = UINT64_MAX) const {
+        return copy(dst, offset, len, true /* to_dst */);
+    }
+    uint64_t copy_from(const uint8_t* const src, const uint64_t offset = 0, const uint64_t len = UINT64_MAX) {
+        return copy(const_cast< uint8_t* >(src), offset, len, false /* to_dst */);
+    }
+
+    // Copy of the entire data in a newly allocated contiguous buffer
+    byte_array gather(const uint32_t alignment = 0, const buftag tag = buftag::common) const {
+        auto buf{make_byte_array(uint32_cast(size), alignment, tag)};
+        copy_to(buf->bytes);
+        return buf;
+    }
+
+    // Contiguous blob of the data. It is copied into the holder only if the data is spread across more than one iov.
+    blob flatten(byte_array& holder, const uint32_t alignment = 0, const buftag tag = buftag::common) const {
+        if (iovs.empty()) { return blob{}; }
+        if (is_contiguous()) { return blob{static_cast< uint8_t* >(iovs[0].iov_base), uint32_cast(iovs[0].iov_len)}; }
+        holder = gather(alignment, tag);
+        return blob{holder->bytes, holder->size};
+    }
+
+    // Scatter the contiguous data into the buffers of the list
+    uint64_t scatter(const blob& b) { return copy_from(b.bytes, 0, b.size); }
+
+private:
+    uint64_t copy(uint8_t* const buf, const uint64_t offset, const uint64_t len, const bool to_dst) const {
+        uint64_t skip{offset};
+        uint64_t remain{std::min(len, (offset < size) ? (size - offset) : 0)};
+        uint64_t copied{0};
+        for (size_t i{0}; (i < iovs.size()) && (remain > 0); ++i) {
+            if (skip >= iovs[i].iov_len) {
+                skip -= iovs[i].iov_len;
+                continue;
+            }
+            uint8_t* const iov_buf{static_cast< uint8_t* >(iovs[i].iov_base) + skip};
+            const uint64_t this_len{std::min< uint64_t >(iovs[i].iov_len - skip, remain)};
+            to_dst ? std::memcpy(buf + copied, iov_buf, this_len) : std::memcpy(iov_buf, buf + copied, this_len);
+            copied += this_len;
+            remain -= this_len;
+            skip = 0;
+        }
+        return copied;
+    }
+};
+
+struct sg_iterator {
+    sg_iterator(const std::vector< iovec >& v) : sg_iterator{v.data(), v.size()} {}
+    sg_iterator(const iovec_array& v) : sg_iterator{v.data(), v.size()} {}
+    sg_iterator(const iovec* const iovs, const size_t niovs) : m_input_iovs{iovs}, m_niovs{niovs} {
+        assert(niovs > 0);
+    }
+
+    std::vector< iovec > next_iovs(uint32_t size) {
+        std::vector< iovec > ret_iovs;
+        advance(size, [&ret_iovs](const iovec& iov) { ret_iovs.push_back(iov); });
+        return ret_iovs;
+    }
+
+    // Same as next_iovs, without allocating for the usual small number of iovs
+    sg_list next_sg(uint64_t size) {
+        sg_list ret;
+        advance(size, [&ret](const iovec& iov) { ret.append(iov); });
+        return ret;
+    }
+
+    // Move forward by the size, returns the bytes actually skipped
+    uint64_t skip(uint64_t size) {
+        uint64_t skipped{0};
+        advance(size, [&skipped](const iovec& iov) { skipped += iov.iov_len; });
+        return skipped;
+    }
+
+    bool has_more() const { return (m_cur_index < m_niovs); }
+
+    const iovec* m_input_iovs;
+    size_t m_niovs;
+    uint64_t m_cur_offset{0};
+    size_t m_cur_index{0};
+
+private:
+    template < typename CB >
+    void advance(uint64_t size, const CB& cb) {
+        uint64_t remain_size = size;
+
+        while ((remain_size > 0) && (m_cur_index < m_niovs)) {
+            const auto& inp_iov = m_input_iovs[m_cur_index];
+            iovec this_iov;
+            this_iov.iov_base = static_cast< uint8_t* >(inp_iov.iov_base) + m_cur_offset;
+            if (remain_size < inp_iov.iov_len - m_cur_offset) {
+                this_iov.iov_len = remain_size;
+                m_cur_offset += remain_size;
+            } else {
+                this_iov.iov_len = inp_iov.iov_len - m_cur_offset;
+                ++m_cur_index;
+                m_cur_offset = 0;
+            }
+
+            cb(this_iov);
+            assert(remain_size >= this_iov.iov_len);
+            remain_size -= this_iov.iov_len;
+        }
+    }
+};
+
 struct byte_view {
 public:
     byte_view() = default;
@@ -300,7 +655,7 @@ public:
         m_base_buf = make_byte_array(sz, alignment, tag);
         m_view = *m_base_buf;
     }
-    byte_view(byte_array buf) : byte_view(std::move(buf), 0, buf->size) {}
+    byte_view(byte_array buf) : byte_view(buf, 0, buf->size) {}
     byte_view(byte_array buf, const uint32_t offset, const uint32_t sz) {
         m_base_buf = std::move(buf);
         m_view.bytes = m_base_buf->bytes + offset;
@@ -357,6 +712,10 @@ public:
     bool can_do_shallow_copy() const {
         return (m_view.bytes == m_base_buf->bytes) && (m_view.size == m_base_buf->size);
     }
+
+    // Whether any other view refers to the underlying byte_array
+    bool is_shared() const { return (m_base_buf.use_count() > 1); }
+    buftag tag() const { return m_base_buf ? m_base_buf->m_tag : buftag::common; }
     void set_size(const uint32_t sz) { m_view.size = sz; }
     void validate() { assert((m_base_buf->bytes + m_base_buf->size) >= (m_view.bytes + m_view.size)); }
 
@@ -366,4 +725,159 @@ private:
     byte_array m_base_buf;
     blob m_view;
 };
+
+/*
+ * Chain of byte_views (rope), which lets the buffers received in pieces be appended, trimmed, split and cloned without
+ * copying the data. The segments share the underlying byte_arrays, so the data is copied only when it is coalesced
+ * into a single buffer or a segment shared with other views is written to (writable_segment). A chain of a single
+ * segment is the same as the byte_view, which is returned as is by coalesce()/extract().
+ */
+class byte_view_chain {
+public:
+    byte_view_chain() = default;
+    byte_view_chain(byte_view v) { append(std::move(v)); }
+
+    void append(byte_view v) {
+        if (v.size() == 0) { return; }
+        m_size += v.size();
+        m_segments.push_back(std::move(v));
+    }
+    void append(const byte_view_chain& other) {
+        // Other could be this chain itself, so only its segments as of now are appended, by index
+        const size_t nsegments{other.m_segments.size()};
+        m_segments.reserve(m_segments.size() + nsegments);
+        for (size_t i{0}; i < nsegments; ++i) {
+            append(other.m_segments[i]);
+        }
+    }
+
+    void prepend(byte_view v) {
+        if (v.size() == 0) { return; }
+        m_size += v.size();
+        m_segments.insert(m_segments.begin(), std::move(v));
+    }
+
+    uint64_t size() const { return m_size; }
+    bool empty() const { return (m_size == 0); }
+    size_t nsegments() const { return m_segments.size(); }
+    const byte_view& segment(const size_t i) const { return m_segments[i]; }
+
+    // Another chain referring to the same buffers
+    byte_view_chain clone() const { return *this; }
+
+    void trim_front(uint64_t n) {
+        assert(n <= m_size);
+        m_size -= n;
+        size_t nremove{0};
+        while (n > 0) {
+            auto& seg{m_segments[nremove]};
+            if (n < seg.size()) {
+                seg.move_forward(n);
+                break;
+            }
+            n -= seg.size();
+            ++nremove;
+        }
+        m_segments.erase(m_segments.begin(), m_segments.begin() + nremove);
+    }
+
+    void trim_back(uint64_t n) {
+        assert(n <= m_size);
+        m_size -= n;
+        while (n > 0) {
+            auto& seg{m_segments.back()};
+            if (n < seg.size()) {
+                seg.set_size(seg.size() - n);
+                break;
+            }
+            n -= seg.size();
+            m_segments.pop_back();
+        }
+    }
+
+    // Split the chain at the offset, this keeps the bytes before the offset and the rest are returned
+    byte_view_chain split_at(const uint64_t offset) {
+        assert(offset <= m_size);
+        byte_view_chain tail;
+        uint64_t seg_start{0};
+        size_t i{0};
+        for (; i < m_segments.size(); ++i) {
+            const uint64_t seg_size{m_segments[i].size()};
+            if (offset < seg_start + seg_size) {
+                // Segment which has the offset is shared by both, the ones after it are moved to the tail
+                const uint32_t head_size{uint32_cast(offset - seg_start)};
+                tail.append(byte_view{m_segments[i], head_size, uint32_cast(seg_size - head_size)});
+                for (size_t j{i + 1}; j < m_segments.size(); ++j) {
+                    tail.append(std::move(m_segments[j]));
+                }
+                m_segments.erase(m_segments.begin() + i + ((head_size > 0) ? 1 : 0), m_segments.end());
+                if (head_size > 0) { m_segments[i].set_size(head_size); }
+                break;
+            }
+            seg_start += seg_size;
+        }
+        m_size = offset;
+        return tail;
+    }
+
+    // Single byte_view of the entire chain, copied into a new buffer only if it has more than one segment
+    byte_view coalesce(const uint32_t alignment = 0) const {
+        if (m_segments.empty()) { return byte_view{}; }
+        if (m_segments.size() == 1) { return m_segments[0]; }
+
+        byte_view ret{uint32_cast(m_size), alignment, m_segments[0].tag()};
+        uint64_t offset{0};
+        for (const auto& seg : m_segments) {
+            std::memcpy(ret.bytes() + offset, seg.bytes(), seg.size());
+            offset += seg.size();
+        }
+        return ret;
+    }
+
+    // Same as coalesce, but the chain is also replaced by the coalesced buffer
+    const byte_view& coalesce_in_place(const uint32_t alignment = 0) {
+        if (m_segments.size() > 1) {
+            auto coalesced{coalesce(alignment)};
+            m_segments.clear();
+            m_segments.push_back(std::move(coalesced));
+        }
+        return m_segments[0];
+    }
+
+    byte_array extract(const uint32_t alignment = 0) const { return coalesce(alignment).extract(alignment); }
+
+    // Data of the segment which can be modified. If any other view refers to its buffer, the segment is copied to a
+    // new buffer first, so that the others don't see the modification.
+    blob writable_segment(const size_t i, const uint32_t alignment = 0) {
+        auto& seg{m_segments[i]};
+        if (seg.is_shared()) {
+            byte_view copy{seg.size(), alignment, seg.tag()};
+            std::memcpy(copy.bytes(), seg.bytes(), seg.size());
+            seg = std::move(copy);
+        }
+        return seg.get_blob();
+    }
+
+    // Zero copy view of the chain to do I/O with
+    sg_list to_sg_list() const {
+        sg_list sgl;
+        for (const auto& seg : m_segments) {
+            sgl.append(seg.bytes(), seg.size());
+        }
+        return sgl;
+    }
+
+    std::string get_string() const {
+        std::string str;
+        str.reserve(m_size);
+        for (const auto& seg : m_segments) {
+            str.append(r_cast< const char* >(seg.bytes()), seg.size());
+        }
+        return str;
+    }
+
+private:
+    folly::small_vector< byte_view, 4 > m_segments;
+    uint64_t m_size{0};
+};
 } // namespace sisl
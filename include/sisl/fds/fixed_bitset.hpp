@@ -0,0 +1,224 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "bitword.hpp"
+
+//
+// Bitset of size known at compile time, which holds the words inline. It has no header, resize locks or skip bits
+// and hence meant for small fixed bitmaps (like per page slot maps) which are embedded in other structures. All
+// operations are constexpr (with the default non atomic words), so the bitmaps can also be built at compile time.
+//
+
+namespace sisl {
+/**
+ * @brief FixedBitset
+ *
+ * @tparam N Count of bits in the bitset
+ * @tparam Word Bitword type which holds the bits
+ */
+template < uint64_t N, typename Word = Bitword< unsafe_bits< uint64_t > > >
+class FixedBitset {
+public:
+    typedef std::decay_t< Word > bitword_type;
+    typedef typename bitword_type::word_t word_t;
+    static_assert(N > 0, "FixedBitset must have at least one bit");
+
+    static constexpr uint64_t npos{std::numeric_limits< uint64_t >::max()};
+    static constexpr uint8_t word_size() { return bitword_type::bits(); }
+    static constexpr uint64_t size() { return N; }
+
+    constexpr FixedBitset() = default;
+    constexpr FixedBitset(const FixedBitset&) = default;
+    constexpr FixedBitset& operator=(const FixedBitset&) = default;
+    ~FixedBitset() = default;
+
+    /**
+     * @brief Set or reset the bit(s). If the bits are outside the available range throws std::out_of_range exception
+     */
+    constexpr void set_bit(const uint64_t bit) { set_reset_bits(bit, 1, true); }
+    constexpr void set_bits(const uint64_t start, const uint64_t nbits) { set_reset_bits(start, nbits, true); }
+    constexpr void reset_bit(const uint64_t bit) { set_reset_bits(bit, 1, false); }
+    constexpr void reset_bits(const uint64_t start, const uint64_t nbits) { set_reset_bits(start, nbits, false); }
+
+    constexpr void set_all() { set_reset_bits(0, N, true); }
+    constexpr void reset_all() { set_reset_bits(0, N, false); }
+
+    constexpr bool get_bitval(const uint64_t bit) const {
+        if (bit >= N) { throw std::out_of_range("Bit is not in range"); }
+        return m_words[bit / word_size()].get_bitval(static_cast< uint8_t >(bit % word_size()));
+    }
+
+    constexpr bool is_bits_set(const uint64_t start, const uint64_t nbits) const {
+        return is_bits_set_reset(start, nbits, true);
+    }
+    constexpr bool is_bits_reset(const uint64_t start, const uint64_t nbits) const {
+        return is_bits_set_reset(start, nbits, false);
+    }
+
+    constexpr uint64_t get_set_count() const {
+        uint64_t count{0};
+        for (const auto& word : m_words) {
+            count += word.get_set_count();
+        }
+        return count;
+    }
+
+    constexpr uint64_t get_reset_count() const { return N - get_set_count(); }
+
+    /**
+     * @brief Get the next set bit from given bit (inclusive), npos if there is none
+     */
+    constexpr uint64_t get_next_set_bit(const uint64_t start_bit) const {
+        for (uint64_t w{start_bit / word_size()}; w < s_nwords; ++w) {
+            const uint8_t offset{(w == (start_bit / word_size())) ? get_word_offset(start_bit) : uint8_t{0}};
+            uint8_t nbit{0};
+            if (m_words[w].get_next_set_bit(offset, &nbit)) { return w * word_size() + nbit; }
+        }
+        return npos;
+    }
+
+    /**
+     * @brief Get the next reset bit from given bit (inclusive), npos if there is none
+     */
+    constexpr uint64_t get_next_reset_bit(const uint64_t start_bit) const {
+        for (uint64_t w{start_bit / word_size()}; w < s_nwords; ++w) {
+            const uint8_t offset{(w == (start_bit / word_size())) ? get_word_offset(start_bit) : uint8_t{0}};
+            uint8_t nbit{0};
+            if (m_words[w].get_next_reset_bit(offset, &nbit)) {
+                // Bits beyond N in the last word are always reset
+                const uint64_t bit{w * word_size() + nbit};
+                return (bit < N) ? bit : npos;
+            }
+        }
+        return npos;
+    }
+
+    /**
+     * @brief Get the next contiguous n reset bits from the start bit. Returns the first run of at least n reset bits,
+     * BitBlock with start_bit npos if there is none.
+     */
+    constexpr BitBlock get_next_contiguous_n_reset_bits(const uint64_t start_bit, const uint32_t n) const {
+        return get_next_contiguous_n_reset_bits(start_bit, std::nullopt, n, n);
+    }
+
+    /**
+     * @brief Get the next contiguous [min_needed, max_needed] inclusive reset bits in the range [start_bit, end_bit]
+     * inclusive. Returns the first run of at least min_needed reset bits, truncated to max_needed bits.
+     */
+    constexpr BitBlock get_next_contiguous_n_reset_bits(const uint64_t start_bit,
+                                                        const std::optional< uint64_t > end_bit,
+                                                        const uint32_t min_needed, const uint32_t max_needed) const {
+        const uint64_t final_bit{end_bit ? std::min(*end_bit + 1, N) : N};
+        uint64_t bit{start_bit};
+        while (bit < final_bit) {
+            const BitBlock run{get_reset_run(bit, final_bit)};
+            if (run.start_bit == npos) { break; }
+            if (run.nbits >= min_needed) { return BitBlock{run.start_bit, std::min(run.nbits, max_needed)}; }
+            bit = run.start_bit + run.nbits;
+        }
+        return BitBlock{npos, 0};
+    }
+
+    /**
+     * @brief Get the largest contiguous reset bits in the range [start_bit, end_bit] inclusive. If there are many of
+     * the same size, the first one is returned. BitBlock with start_bit npos if all the bits are set.
+     */
+    constexpr BitBlock get_max_contiguous_reset_bits(const uint64_t start_bit = 0,
+                                                     const std::optional< uint64_t > end_bit = std::nullopt) const {
+        const uint64_t final_bit{end_bit ? std::min(*end_bit + 1, N) : N};
+        BitBlock max_run{npos, 0};
+        uint64_t bit{start_bit};
+        while (bit < final_bit) {
+            const BitBlock run{get_reset_run(bit, final_bit)};
+            if (run.start_bit == npos) { break; }
+            if (run.nbits > max_run.nbits) { max_run = run; }
+            bit = run.start_bit + run.nbits;
+        }
+        return max_run;
+    }
+
+    constexpr bool operator==(const FixedBitset& rhs) const {
+        for (uint64_t w{0}; w < s_nwords; ++w) {
+            if (m_words[w] != rhs.m_words[w]) { return false; }
+        }
+        return true;
+    }
+    constexpr bool operator!=(const FixedBitset& rhs) const { return !(*this == rhs); }
+
+    // print out the bitset in the order last bit to first bit
+    std::string to_string() const {
+        std::string output{};
+        output.reserve(N);
+        for (uint64_t bit{N}; bit > 0; --bit) {
+            output.push_back(get_bitval(bit - 1) ? '1' : '0');
+        }
+        return output;
+    }
+
+    void print() const { std::cout << to_string() << std::endl; }
+
+private:
+    static constexpr uint64_t s_nwords{(N + word_size() - 1) / word_size()};
+
+    static constexpr uint8_t get_word_offset(const uint64_t bit) { return static_cast< uint8_t >(bit % word_size()); }
+
+    constexpr void set_reset_bits(const uint64_t start, const uint64_t nbits, const bool value) {
+        if ((start >= N) || (nbits > (N - start))) { throw std::out_of_range("Set/Reset bits not in range"); }
+        uint64_t bit{start};
+        uint64_t bits_remaining{nbits};
+        while (bits_remaining > 0) {
+            const uint8_t offset{get_word_offset(bit)};
+            const uint8_t count{static_cast< uint8_t >(std::min< uint64_t >(bits_remaining, word_size() - offset))};
+            m_words[bit / word_size()].set_reset_bits(offset, count, value);
+            bit += count;
+            bits_remaining -= count;
+        }
+    }
+
+    constexpr bool is_bits_set_reset(const uint64_t start, const uint64_t nbits, const bool expected) const {
+        if ((start >= N) || (nbits > (N - start))) { throw std::out_of_range("Bits not in range"); }
+        uint64_t bit{start};
+        uint64_t bits_remaining{nbits};
+        while (bits_remaining > 0) {
+            const uint8_t offset{get_word_offset(bit)};
+            const uint8_t count{static_cast< uint8_t >(std::min< uint64_t >(bits_remaining, word_size() - offset))};
+            if (!m_words[bit / word_size()].is_bits_set_reset(offset, count, expected)) { return false; }
+            bit += count;
+            bits_remaining -= count;
+        }
+        return true;
+    }
+
+    // Run of reset bits starting at or after the bit, which ends before end_bit
+    constexpr BitBlock get_reset_run(const uint64_t bit, const uint64_t end_bit) const {
+        const uint64_t run_start{get_next_reset_bit(bit)};
+        if (run_start >= end_bit) { return BitBlock{npos, 0}; }
+        const uint64_t run_end{std::min(get_next_set_bit(run_start), end_bit)};
+        return BitBlock{run_start, static_cast< uint32_t >(run_end - run_start)};
+    }
+
+    std::array< bitword_type, s_nwords > m_words{};
+};
+} // namespace sisl
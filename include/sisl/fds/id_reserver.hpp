@@ -16,33 +16,43 @@
  *********************************************************************************/
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <cassert>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 #include "bitset.hpp"
 #include "utils.hpp"
 
 namespace sisl {
+struct id_reserver_options {
+    // Track a reuse counter of each id, to hand out 64 bit ids tagged with it (reserve_tagged)
+    bool generation_tagged{false};
+
+    // Shrink the bitset when the upper 3/4th of it becomes free, but never below the estimated ids
+    bool auto_shrink{false};
+};
+
 class IDReserver {
 public:
-    IDReserver(uint32_t estimated_ids = 1024) : m_reserved_bits(estimated_ids) { assert(estimated_ids != 0); }
+    IDReserver(uint32_t estimated_ids = 1024, const id_reserver_options& opts = {}) :
+            m_reserved_bits(estimated_ids), m_opts{opts}, m_min_size{estimated_ids} {
+        assert(estimated_ids != 0);
+        if (m_opts.generation_tagged) { m_generations.resize(estimated_ids, 0); }
+    }
 
-    IDReserver(const sisl::byte_array& b) : m_reserved_bits(b) {}
+    IDReserver(const sisl::byte_array& b, const id_reserver_options& opts = {}) :
+            m_reserved_bits(b), m_opts{opts}, m_min_size{m_reserved_bits.size()} {
+        if (m_opts.generation_tagged) { m_generations.resize(m_reserved_bits.size(), 0); }
+        recount_upper_reserved();
+    }
 
     uint32_t reserve() {
         std::unique_lock lg(m_mutex);
-        size_t nbit = m_reserved_bits.get_next_reset_bit(0);
-        if (nbit == Bitset::npos) {
-            // We ran out of room to allocate bits, resize and allocate more
-            const auto cur_size = m_reserved_bits.size();
-            assert(cur_size != 0);
-            m_reserved_bits.resize(cur_size * 2);
-            nbit = cur_size;
-        }
-        m_reserved_bits.set_bit(nbit);
-        return nbit;
+        return reserve_locked();
     }
 
     void reserve(uint32_t id) {
@@ -50,19 +60,110 @@ public:
         assert(!(m_reserved_bits.get_bitval(id)));
         assert(id < m_reserved_bits.size());
         m_reserved_bits.set_bit(id);
+        m_upper_reserved += upper_reserved_in(id, 1);
     }
 
     void unreserve(uint32_t id) {
         std::unique_lock lg(m_mutex);
-        assert(id < m_reserved_bits.size());
-        m_reserved_bits.reset_bit(id);
+        unreserve_locked(id);
+    }
+
+    // Reserve count contiguous ids and return the first of them
+    uint32_t reserve_range(uint32_t count) {
+        assert(count != 0);
+        std::unique_lock lg(m_mutex);
+        auto blk = m_reserved_bits.get_next_contiguous_n_reset_bits(0, count);
+        if (blk.start_bit == Bitset::npos) {
+            // Resize enough that the run of reset bits at the end (if any) along with the new bits fit the range
+            const auto cur_size = m_reserved_bits.size();
+            resize(std::max(cur_size * 2, cur_size + count));
+            blk = m_reserved_bits.get_next_contiguous_n_reset_bits((cur_size >= count) ? (cur_size - count) : 0, count);
+            assert(blk.start_bit != Bitset::npos);
+        }
+        m_reserved_bits.set_bits(blk.start_bit, count);
+        m_upper_reserved += upper_reserved_in(blk.start_bit, count);
+        return static_cast< uint32_t >(blk.start_bit);
+    }
+
+    void reserve_range(uint32_t start, uint32_t count) {
+        std::unique_lock lg(m_mutex);
+        if ((uint64_t{start} + count) > m_reserved_bits.size()) {
+            resize(std::max(m_reserved_bits.size() * 2, uint64_t{start} + count));
+        }
+        assert(m_reserved_bits.is_bits_reset(start, count));
+        m_reserved_bits.set_bits(start, count);
+        m_upper_reserved += upper_reserved_in(start, count);
+    }
+
+    void unreserve_range(uint32_t start, uint32_t count) {
+        std::unique_lock lg(m_mutex);
+        assert((uint64_t{start} + count) <= m_reserved_bits.size());
+        m_upper_reserved -= upper_reserved_in(start, count);
+        m_reserved_bits.reset_bits(start, count);
+        if (m_opts.generation_tagged) {
+            for (uint32_t id{start}; id < start + count; ++id) {
+                ++m_generations[id];
+            }
+        }
+        shrink_if_free();
+    }
+
+    /*
+     * Generation tagged ids carry the id in the lower 32 bits and the number of times the id was reused in the upper
+     * 32 bits. A tagged id held after the id is unreserved (and possibly reserved again) no longer matches, so the
+     * lookups keyed by it can detect the stale id with is_valid() instead of getting the reused one.
+     */
+    static constexpr uint64_t make_tagged_id(uint32_t id, uint32_t generation) {
+        return (static_cast< uint64_t >(generation) << 32) | id;
+    }
+    static constexpr uint32_t tagged_id_index(uint64_t tagged_id) { return static_cast< uint32_t >(tagged_id); }
+    static constexpr uint32_t tagged_id_generation(uint64_t tagged_id) {
+        return static_cast< uint32_t >(tagged_id >> 32);
+    }
+
+    uint64_t reserve_tagged() {
+        assert(m_opts.generation_tagged);
+        std::unique_lock lg(m_mutex);
+        const uint32_t id{reserve_locked()};
+        return make_tagged_id(id, m_generations[id]);
+    }
+
+    // Returns false without unreserving anything if the tagged id is stale, i.e. the id was already unreserved (and
+    // possibly reserved again) since it was handed out
+    bool unreserve_tagged(uint64_t tagged_id) {
+        assert(m_opts.generation_tagged);
+        std::unique_lock lg(m_mutex);
+        if (!is_valid_locked(tagged_id)) { return false; }
+        unreserve_locked(tagged_id_index(tagged_id));
+        return true;
+    }
+
+    // Whether the tagged id is reserved and is not reused since it was handed out
+    bool is_valid(uint64_t tagged_id) {
+        assert(m_opts.generation_tagged);
+        std::unique_lock lg(m_mutex);
+        return is_valid_locked(tagged_id);
     }
 
     bool is_reserved(uint32_t id) {
         std::unique_lock lg(m_mutex);
-        return m_reserved_bits.get_bitval(id);
+        return (id < m_reserved_bits.size()) && m_reserved_bits.get_bitval(id);
     }
 
+    // Count of reserved ids. Large reservers loaded from the serialized buffer could count with multiple threads
+    uint64_t reserved_count(const uint32_t nthreads = 1) {
+        std::unique_lock lg(m_mutex);
+        return (nthreads == 1) ? m_reserved_bits.get_set_count()
+                               : m_reserved_bits.get_set_count_parallel(0, Bitset::npos, nthreads);
+    }
+
+    // Number of ids the reserver has room for without growing
+    uint64_t capacity() {
+        std::unique_lock lg(m_mutex);
+        return m_reserved_bits.size();
+    }
+
+    // Generations are not serialized, the ids loaded from it start over with generation 0
     sisl::byte_array serialize() {
         std::unique_lock lg(m_mutex);
         return m_reserved_bits.serialize();
@@ -72,6 +173,71 @@ public:
     bool next_reserved_id(uint32_t& last_found_id) { return find_next_reserved_id(false, last_found_id); }
 
 private:
+    void unreserve_locked(uint32_t id) {
+        assert(id < m_reserved_bits.size());
+        m_upper_reserved -= upper_reserved_in(id, 1);
+        m_reserved_bits.reset_bit(id);
+        if (m_opts.generation_tagged) { ++m_generations[id]; }
+        shrink_if_free();
+    }
+
+    bool is_valid_locked(uint64_t tagged_id) const {
+        const uint32_t id{tagged_id_index(tagged_id)};
+        return (id < m_reserved_bits.size()) && m_reserved_bits.get_bitval(id) &&
+            (m_generations[id] == tagged_id_generation(tagged_id));
+    }
+
+    uint32_t reserve_locked() {
+        size_t nbit = m_reserved_bits.get_next_reset_bit(0);
+        if (nbit == Bitset::npos) {
+            // We ran out of room to allocate bits, resize and allocate more
+            const auto cur_size = m_reserved_bits.size();
+            assert(cur_size != 0);
+            resize(cur_size * 2);
+            nbit = cur_size;
+        }
+        m_reserved_bits.set_bit(nbit);
+        m_upper_reserved += upper_reserved_in(nbit, 1);
+        return nbit;
+    }
+
+    void resize(uint64_t nbits) {
+        if (m_opts.generation_tagged) {
+            if (nbits < m_generations.size()) {
+                // Ids dropped now could come back with a later resize, so they continue after the largest generation
+                // dropped, so that none of the tagged ids handed out earlier matches again.
+                const auto dropped_max{*std::max_element(std::next(m_generations.begin(), nbits), m_generations.end())};
+                m_generation_floor = std::max(m_generation_floor, dropped_max);
+            }
+            m_generations.resize(nbits, m_generation_floor);
+        }
+        m_reserved_bits.resize(nbits);
+        recount_upper_reserved();
+    }
+
+    // Halve the bitset (repeatedly, upto the estimated ids) while the upper 3/4th of it is free. Shrinking only to half
+    // leaves room for 1/4th of the ids before it grows again, so reserve/unreserve around the boundary don't resize.
+    void shrink_if_free() {
+        if (!m_opts.auto_shrink) { return; }
+        while ((m_reserved_bits.size() > m_min_size) && (m_upper_reserved == 0)) {
+            resize(std::max(m_reserved_bits.size() / 2, m_min_size));
+        }
+    }
+
+    // Count of reserved ids in the range, which are in the upper 3/4th of the bitset. Only tracked with auto_shrink.
+    uint64_t upper_reserved_in(uint64_t start, uint64_t count) const {
+        if (!m_opts.auto_shrink) { return 0; }
+        const uint64_t upper_start{std::max(start, m_reserved_bits.size() / 4)};
+        if (upper_start >= (start + count)) { return 0; }
+        return m_reserved_bits.get_set_count(upper_start, start + count - 1);
+    }
+
+    // Called whenever the bitset is resized, since the upper 3/4th moves along with the size
+    void recount_upper_reserved() {
+        if (!m_opts.auto_shrink) { return; }
+        m_upper_reserved = m_reserved_bits.get_set_count(m_reserved_bits.size() / 4);
+    }
+
     bool find_next_reserved_id(bool first, uint32_t& last_found_id) {
         std::unique_lock lg(m_mutex);
         size_t nbit = m_reserved_bits.get_next_set_bit(first ? 0 : last_found_id + 1);
@@ -83,5 +249,321 @@ private:
 private:
     std::mutex m_mutex;
     sisl::Bitset m_reserved_bits;
+    id_reserver_options m_opts;
+    uint64_t m_min_size;
+
+    // Reserved ids in the upper 3/4th of the bitset, so that shrink_if_free does not have to search it
+    uint64_t m_upper_reserved{0};
+
+    // Reuse count of each id and the generation where the ids added by growing the bitset start
+    std::vector< uint32_t > m_generations;
+    uint32_t m_generation_floor{0};
 };
+
+//
+// IDReserver for many concurrent threads. Each thread reserves a batch of ids from the shared bitset at once (claimed
+// with compare and swap, without any lock) and hands them out from its own cache. Unreserved ids go back to the cache
+// of the unreserving thread if it has room and the caches are returned to the shared bitset when the thread exits.
+// Claims start from a rotating hint instead of the beginning of the bitset, so they don't scan the filled range.
+//
+// The caches are thread_local, so only the owning thread ever touches its cache. A thread exiting after the reserver
+// is destroyed drops its cache, and the caches of a destroyed reserver held by the other threads are dropped on their
+// next call to any reserver.
+//
+// An id sitting in a thread cache is taken out of it by reserve(id), and the thread skips it when it gets to it. The
+// cached ids are released with compare and swap on their bits, so only one of them hands out the id.
+//
+class ConcurrentIDReserver {
+public:
+    static constexpr uint32_t default_cache_batch{32};
+
+    ConcurrentIDReserver(uint32_t estimated_ids = 1024, uint32_t cache_batch = default_cache_batch) :
+            m_reserved_bits{estimated_ids}, m_cached_bits{estimated_ids}, m_cache_batch{cache_batch} {
+        assert(estimated_ids != 0);
+        assert(cache_batch != 0);
+    }
+
+    ConcurrentIDReserver(const sisl::byte_array& b, uint32_t cache_batch = default_cache_batch) :
+            m_reserved_bits{b}, m_cached_bits{m_reserved_bits.size()}, m_cache_batch{cache_batch} {
+        assert(cache_batch != 0);
+    }
+
+    ConcurrentIDReserver(const ConcurrentIDReserver&) = delete;
+    ConcurrentIDReserver(ConcurrentIDReserver&&) noexcept = delete;
+    ConcurrentIDReserver& operator=(const ConcurrentIDReserver&) = delete;
+    ConcurrentIDReserver& operator=(ConcurrentIDReserver&&) noexcept = delete;
+
+    ~ConcurrentIDReserver() {
+        // Retire it before dropping the cache of this thread, so that the exiting threads don't return their ids
+        {
+            std::scoped_lock lg(m_owner->m_mutex);
+            m_owner->m_retired.store(true, std::memory_order_release);
+        }
+        if (!t_caches_destroyed && (t_caches.m_caches.size() > m_id)) { t_caches.m_caches[m_id].reset(); }
+        s_retire_epoch.fetch_add(1, std::memory_order_acq_rel);
+        release_reserver_id(m_id);
+    }
+
+    uint32_t reserve() {
+        id_cache* const cache{my_cache()};
+        if (cache == nullptr) { return reserve_uncached(); }
+        while (true) {
+            if (cache->m_count == 0) { refill(*cache); }
+
+            // The id could have been taken out of the cache by reserve(id)
+            const uint32_t id{cache->m_ids[--cache->m_count]};
+            if (m_cached_bits.try_release_bit(id)) { return id; }
+        }
+    }
+
+    // Reserve the specific id, taking it out of the thread cache it is in, if any. Returns false if it is already
+    // reserved, which includes an id being claimed into a cache concurrently.
+    bool reserve(uint32_t id) {
+        while (id >= m_reserved_bits.size()) {
+            grow(id + 1);
+        }
+        if (m_reserved_bits.try_claim_bit(id)) { return true; }
+        return m_cached_bits.try_release_bit(id);
+    }
+
+    void unreserve(uint32_t id) {
+        assert(id < m_reserved_bits.size());
+        assert(is_reserved(id));
+
+        // Keep it in this thread's cache, so that it is handed out again without going through the shared bitset
+        id_cache* const cache{my_cache()};
+        if ((cache != nullptr) && (cache->m_count < m_cache_batch)) {
+            m_cached_bits.set_bit(id);
+            cache->m_ids[cache->m_count++] = id;
+        } else {
+            m_reserved_bits.reset_bit(id);
+        }
+    }
+
+    // Reserve count contiguous ids directly from the shared bitset and return the first of them
+    uint32_t reserve_range(uint32_t count) {
+        assert(count != 0);
+        while (true) {
+            const BitBlock blk{
+                m_reserved_bits.try_claim_next_reset_bits(m_search_hint.load(std::memory_order_relaxed), count)};
+            if (blk.start_bit != ThreadSafeBitset::npos) {
+                m_search_hint.store(blk.start_bit + count, std::memory_order_relaxed);
+                return static_cast< uint32_t >(blk.start_bit);
+            }
+            grow(m_reserved_bits.size() + count);
+        }
+    }
+
+    void reserve_range(uint32_t start, uint32_t count) {
+        while ((uint64_t{start} + count) > m_reserved_bits.size()) {
+            grow(uint64_t{start} + count);
+        }
+        [[maybe_unused]] const bool claimed{m_reserved_bits.try_claim_bits(start, count)};
+        assert(claimed);
+    }
+
+    // Ranges are always returned to the shared bitset, since they would rarely fit in a cache
+    void unreserve_range(uint32_t start, uint32_t count) {
+        assert((uint64_t{start} + count) <= m_reserved_bits.size());
+        assert(m_cached_bits.is_bits_reset(start, count));
+        m_reserved_bits.reset_bits(start, count);
+    }
+
+    bool is_reserved(uint32_t id) const {
+        if (id >= m_reserved_bits.size()) { return false; }
+        return m_reserved_bits.get_bitval(id) && !m_cached_bits.get_bitval(id);
+    }
+
+    // Count of reserved ids, excluding the ones in the thread caches
+    uint64_t reserved_count() const { return m_reserved_bits.get_set_count() - m_cached_bits.get_set_count(); }
+
+    // Serialized in the IDReserver format, with only the ids which are reserved
+    sisl::byte_array serialize() const {
+        sisl::Bitset bits{m_reserved_bits.serialize(std::nullopt, true /* force_copy */)};
+        for (auto bit{m_cached_bits.get_next_set_bit(0)}; bit != ThreadSafeBitset::npos;
+             bit = m_cached_bits.get_next_set_bit(bit + 1)) {
+            if (bit < bits.size()) { bits.reset_bit(bit); }
+        }
+        return bits.serialize(std::nullopt, true /* force_copy */);
+    }
+
+    bool first_reserved_id(uint32_t& found_id) const { return find_next_reserved_id(0, found_id); }
+    bool next_reserved_id(uint32_t& last_found_id) const {
+        return find_next_reserved_id(last_found_id + 1, last_found_id);
+    }
+
+private:
+    // Shared by the reserver with its thread caches, which return their ids on thread exit only while it is alive
+    struct cache_owner {
+        explicit cache_owner(ConcurrentIDReserver* reserver) : m_reserver{reserver} {}
+
+        std::mutex m_mutex; // Taken by the destroying reserver and the exiting threads
+        ConcurrentIDReserver* m_reserver;
+        std::atomic< bool > m_retired{false};
+    };
+
+    struct id_cache {
+        id_cache(std::shared_ptr< cache_owner > owner, uint32_t batch) : m_owner{std::move(owner)}, m_ids(batch) {}
+        id_cache(const id_cache&) = delete;
+        id_cache& operator=(const id_cache&) = delete;
+
+        ~id_cache() {
+            std::scoped_lock lg(m_owner->m_mutex);
+            if (!m_owner->m_retired.load(std::memory_order_acquire)) { m_owner->m_reserver->return_cached(*this); }
+        }
+
+        std::shared_ptr< cache_owner > m_owner;
+        std::vector< uint32_t > m_ids;
+        uint32_t m_count{0};
+    };
+
+    // Caches of this thread, indexed by the id of the reserver
+    struct thread_caches {
+        ~thread_caches() {
+            m_caches.clear();
+            t_caches_destroyed = true;
+        }
+
+        std::vector< std::unique_ptr< id_cache > > m_caches;
+        uint64_t m_retire_epoch{0};
+    };
+
+    // Ids of the destroyed reservers are reused, so the caches of a thread don't grow with every reserver created
+    struct reserver_ids {
+        std::mutex m_mutex;
+        std::vector< size_t > m_free_ids;
+        size_t m_next_id{0};
+    };
+
+    static reserver_ids& reserver_id_registry() {
+        static reserver_ids s_ids;
+        return s_ids;
+    }
+
+    static size_t acquire_reserver_id() {
+        auto& ids{reserver_id_registry()};
+        std::scoped_lock lg(ids.m_mutex);
+        if (ids.m_free_ids.empty()) { return ids.m_next_id++; }
+        const size_t id{ids.m_free_ids.back()};
+        ids.m_free_ids.pop_back();
+        return id;
+    }
+
+    static void release_reserver_id(size_t id) {
+        auto& ids{reserver_id_registry()};
+        std::scoped_lock lg(ids.m_mutex);
+        ids.m_free_ids.push_back(id);
+    }
+
+    // Cache of the calling thread, nullptr if the caches of the thread are already destroyed (called by the
+    // thread_local destructors which run after it)
+    id_cache* my_cache() {
+        if (t_caches_destroyed) { return nullptr; }
+        auto& caches{t_caches.m_caches};
+        if (const uint64_t epoch{s_retire_epoch.load(std::memory_order_acquire)}; t_caches.m_retire_epoch != epoch) {
+            // Some reserver was destroyed since, drop the caches of this thread which belong to it. It also clears the
+            // slot of a reused id, before it is used for this reserver.
+            for (auto& cache : caches) {
+                if (cache && cache->m_owner->m_retired.load(std::memory_order_acquire)) { cache.reset(); }
+            }
+            t_caches.m_retire_epoch = epoch;
+        }
+        if (caches.size() <= m_id) { caches.resize(m_id + 1); }
+        if (!caches[m_id]) { caches[m_id] = std::make_unique< id_cache >(m_owner, m_cache_batch); }
+        return caches[m_id].get();
+    }
+
+    // Ids of the cache, which are not taken out of it by reserve(id), go back to the shared bitset
+    void return_cached(id_cache& cache) {
+        for (uint32_t i{0}; i < cache.m_count; ++i) {
+            if (m_cached_bits.try_release_bit(cache.m_ids[i])) { m_reserved_bits.reset_bit(cache.m_ids[i]); }
+        }
+        cache.m_count = 0;
+    }
+
+    uint32_t reserve_uncached() {
+        while (true) {
+            const uint64_t id{m_reserved_bits.try_claim_next_reset_bit(m_search_hint.load(std::memory_order_relaxed))};
+            if (id != ThreadSafeBitset::npos) {
+                m_search_hint.store(id + 1, std::memory_order_relaxed);
+                return static_cast< uint32_t >(id);
+            }
+            grow(m_reserved_bits.size() + 1);
+        }
+    }
+
+    void refill(id_cache& cache) {
+        uint64_t hint{m_search_hint.load(std::memory_order_relaxed)};
+        while (cache.m_count == 0) {
+            // Claim the whole batch in one go if there is a run of reset bits, else claim whatever is available
+            const BitBlock blk{m_reserved_bits.try_claim_next_reset_bits(hint, m_cache_batch)};
+            if (blk.start_bit != ThreadSafeBitset::npos) {
+                m_cached_bits.set_bits(blk.start_bit, blk.nbits);
+                for (uint64_t id{blk.start_bit}; id < blk.start_bit + blk.nbits; ++id) {
+                    cache.m_ids[cache.m_count++] = static_cast< uint32_t >(id);
+                }
+                hint = blk.start_bit + blk.nbits;
+                break;
+            }
+
+            while (cache.m_count < m_cache_batch) {
+                const uint64_t id{m_reserved_bits.try_claim_next_reset_bit(hint)};
+                if (id == ThreadSafeBitset::npos) { break; }
+                m_cached_bits.set_bit(id);
+                cache.m_ids[cache.m_count++] = static_cast< uint32_t >(id);
+                hint = id + 1;
+            }
+            if (cache.m_count == 0) { grow(m_reserved_bits.size() + 1); }
+        }
+        m_search_hint.store(hint, std::memory_order_relaxed);
+
+        // Ids are handed out from the end, so that the lowest one goes first
+        std::reverse(cache.m_ids.begin(), std::next(cache.m_ids.begin(), cache.m_count));
+    }
+
+    void grow(uint64_t atleast_count) {
+        std::scoped_lock lg(m_grow_mutex);
+        const uint64_t cur_size{m_reserved_bits.size()};
+        if (cur_size >= atleast_count) { return; }
+
+        // Resize the cached bits first, since it is set only after the id is claimed in the reserved bits
+        const uint64_t new_size{std::max(cur_size * 2, atleast_count)};
+        m_cached_bits.resize(new_size);
+        m_reserved_bits.resize(new_size);
+        m_search_hint.store(cur_size, std::memory_order_relaxed);
+    }
+
+    bool find_next_reserved_id(uint64_t start, uint32_t& found_id) const {
+        uint64_t nbit{m_reserved_bits.get_next_set_bit(start)};
+        while ((nbit != ThreadSafeBitset::npos) && m_cached_bits.get_bitval(nbit)) {
+            nbit = m_reserved_bits.get_next_set_bit(nbit + 1);
+        }
+        if (nbit == ThreadSafeBitset::npos) { return false; }
+        found_id = static_cast< uint32_t >(nbit);
+        return true;
+    }
+
+private:
+    sisl::ThreadSafeBitset m_reserved_bits;
+
+    // Ids which are reserved in m_reserved_bits, but are in a thread cache to be handed out
+    sisl::ThreadSafeBitset m_cached_bits;
+
+    uint32_t m_cache_batch;
+    std::atomic< uint64_t > m_search_hint{0};
+    std::mutex m_grow_mutex;
+
+    std::shared_ptr< cache_owner > m_owner{std::make_shared< cache_owner >(this)};
+    size_t m_id{acquire_reserver_id()};
+
+    static thread_local thread_caches t_caches;
+
+    // Set once the caches of this thread are destroyed
+    static inline thread_local bool t_caches_destroyed{false};
+
+    // Bumped when a reserver is destroyed, so the threads drop their caches of it on their next call
+    static inline std::atomic< uint64_t > s_retire_epoch{0};
+};
+
+inline thread_local ConcurrentIDReserver::thread_caches ConcurrentIDReserver::t_caches;
 } // namespace sisl
@@ -0,0 +1,487 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+#include <sisl/metrics/metrics_group_impl.hpp>
+#include <sisl/metrics/metrics.hpp>
+#include <sisl/utility/urcu_helper.hpp>
+
+#include "fixed_bitset.hpp"
+#include "stream_tracker.hpp"
+
+//
+// Variant of StreamTracker for many concurrent producers. Slots are held in fixed size chunks, which are never moved
+// once allocated, and found through a directory of chunks published with rcu. create/update/complete only take the rcu
+// read lock and set the bits atomically within the chunk, so they never wait for truncate. Truncate moves the cursor
+// and retires the chunks fully behind it with call_rcu. The only lock on the write path is taken once per chunk, when
+// it is allocated (or the directory is grown).
+//
+// NOTE: All the threads using the tracker need to be registered with rcu (sisl::urcu_ctl::register_rcu()).
+//
+
+namespace sisl {
+template < typename T, bool AutoTruncate = false, size_t ChunkSlots = 1024 >
+class SegmentedStreamTracker {
+public:
+    static constexpr auto null_processor = []([[maybe_unused]] const auto&... x) -> bool { return true; };
+    static constexpr size_t initial_dir_chunks = 16;
+
+    static_assert(std::is_trivially_copyable< T >::value, "Cannot use StreamTracker for non-trivally copyable classes");
+    static_assert((ChunkSlots > 0) && ((ChunkSlots % 64) == 0), "ChunkSlots must be a multiple of 64");
+
+    // Initialize the stream with start index
+    SegmentedStreamTracker(const char* name = "StreamTracker", int64_t start_idx = -1) :
+            m_base_idx{start_idx + 1},
+            m_slot_ref_idx{start_idx + 1},
+            m_dir{new chunk_dir{initial_dir_chunks}},
+            m_metrics{name} {}
+
+    SegmentedStreamTracker(const SegmentedStreamTracker&) = delete;
+    SegmentedStreamTracker& operator=(const SegmentedStreamTracker&) = delete;
+    SegmentedStreamTracker(SegmentedStreamTracker&&) noexcept = delete;
+    SegmentedStreamTracker& operator=(SegmentedStreamTracker&&) noexcept = delete;
+
+    ~SegmentedStreamTracker() {
+        GAUGE_UPDATE(m_metrics, stream_tracker_mem_size, 0);
+        for (auto& entry : m_dir->m_chunks) {
+            delete entry.load(std::memory_order_relaxed);
+        }
+        delete m_dir;
+    }
+
+    template < class... Args >
+    int64_t create_and_complete(int64_t idx, Args&&... args) {
+        return do_update(idx, null_processor, true /* replace */, std::forward< Args >(args)...);
+    }
+
+    template < class... Args >
+    int64_t create(int64_t idx, Args&&... args) {
+        return do_update(
+            idx, []([[maybe_unused]] T& data) { return false; }, true /* replace */, std::forward< Args >(args)...);
+    }
+
+    template < class... Args >
+    int64_t update(int64_t idx, const auto& processor, Args&&... args) {
+        return do_update(idx, processor, false /* replace */, std::forward< Args >(args)...);
+    }
+
+    void complete(int64_t start_idx, int64_t end_idx) {
+        bool need_truncate{false};
+        {
+            rcu_read_guard guard;
+            int64_t idx{std::max(start_idx, m_slot_ref_idx.load(std::memory_order_acquire))};
+            size_t ncompleted{0};
+            while (idx <= end_idx) {
+                const uint64_t pos{slot_pos(idx)};
+                const uint64_t slot{pos % ChunkSlots};
+                const uint64_t count{std::min< uint64_t >(ChunkSlots - slot, end_idx - idx + 1)};
+                chunk* const c{get_or_create_chunk(pos / ChunkSlots)};
+                if (c) {
+                    c->m_comp_bits.set_bits(slot, count);
+                    ncompleted += count;
+                }
+                idx += count;
+            }
+            need_truncate = account_completions(ncompleted);
+        }
+
+        if (need_truncate) { auto_truncate(); }
+    }
+
+    void rollback(int64_t new_end_idx) {
+        rcu_read_guard guard;
+        if (new_end_idx < m_slot_ref_idx.load(std::memory_order_acquire)) {
+            throw std::out_of_range("Slot idx is not in range");
+        }
+
+        const uint64_t pos{slot_pos(new_end_idx)};
+        const uint64_t end_cn{pos / ChunkSlots};
+        const uint64_t slot{pos % ChunkSlots};
+        for (auto& entry : rcu_dereference(m_dir)->m_chunks) {
+            chunk* const c{entry.load(std::memory_order_acquire)};
+            if (!c || (c->m_cn < end_cn)) { continue; }
+            if (c->m_cn > end_cn) {
+                c->m_active_bits.reset_all();
+                c->m_comp_bits.reset_all();
+            } else if (slot + 1 < ChunkSlots) {
+                c->m_active_bits.reset_bits(slot + 1, ChunkSlots - slot - 1);
+                c->m_comp_bits.reset_bits(slot + 1, ChunkSlots - slot - 1);
+            }
+        }
+    }
+
+    // NOTE: The reference is valid only until the idx is truncated
+    T& at(int64_t idx) const {
+        rcu_read_guard guard;
+        if (idx < m_slot_ref_idx.load(std::memory_order_acquire)) {
+            throw std::out_of_range("Slot idx is not in range");
+        }
+
+        const uint64_t pos{slot_pos(idx)};
+        chunk* const c{find_chunk(pos / ChunkSlots)};
+        if (!c || !c->m_active_bits.get_bitval(pos % ChunkSlots)) {
+            throw std::out_of_range("Slot idx is not in range");
+        }
+        return *c->slot_data(pos % ChunkSlots);
+    }
+
+    /* Returns an anonymous structure which has 4 fields
+     * is_out_of_range: Is the entry out_of_range of whats been tracked
+     * is_hole: Is the entry is in_range but no data has been created or completed.
+     * is_active: Is the entry valid and current active
+     * is_completed: Is the entry valid and completed
+     */
+    auto status(int64_t idx) const {
+        struct {
+            bool is_out_of_range = false;
+            bool is_hole = false;
+            bool is_active = false;
+            bool is_completed = false;
+        } ret;
+
+        rcu_read_guard guard;
+        if (idx < m_slot_ref_idx.load(std::memory_order_acquire)) {
+            ret.is_out_of_range = true;
+        } else {
+            const uint64_t pos{slot_pos(idx)};
+            const chunk* const c{find_chunk(pos / ChunkSlots)};
+            if (c && c->m_comp_bits.get_bitval(pos % ChunkSlots)) {
+                ret.is_completed = true;
+            } else if (c && c->m_active_bits.get_bitval(pos % ChunkSlots)) {
+                ret.is_active = true;
+            } else {
+                ret.is_hole = true;
+            }
+        }
+        return ret;
+    }
+
+    int64_t truncate(int64_t idx) {
+        std::scoped_lock< std::mutex > lock{m_truncate_mutex};
+        return do_truncate(idx + 1);
+    }
+
+    int64_t truncate() {
+        if (AutoTruncate && (m_cmpltd_count_since_last_truncate.load(std::memory_order_acquire) == 0)) {
+            return m_slot_ref_idx.load(std::memory_order_acquire) - 1;
+        }
+
+        std::scoped_lock< std::mutex > lock{m_truncate_mutex};
+        return do_truncate(completed_upto() + 1);
+    }
+
+    void foreach_contiguous_completed(int64_t start_idx, const auto& cb) { _foreach_contiguous(start_idx, true, cb); }
+    void foreach_contiguous_active(int64_t start_idx, const auto& cb) { _foreach_contiguous(start_idx, false, cb); }
+    void foreach_all_completed(int64_t start_idx, const auto& cb) { _foreach_all(start_idx, true, cb); }
+    void foreach_all_active(int64_t start_idx, const auto& cb) { _foreach_all(start_idx, false, cb); }
+
+    int64_t completed_upto(int64_t search_hint_idx = 0) const {
+        rcu_read_guard guard;
+        return _upto(true /* completed */, search_hint_idx);
+    }
+
+    int64_t active_upto(int64_t search_hint_idx = 0) const {
+        rcu_read_guard guard;
+        return _upto(false /* completed */, search_hint_idx);
+    }
+
+    nlohmann::json get_status(const int verbosity) const {
+        nlohmann::json js;
+        js["start"] = m_slot_ref_idx.load(std::memory_order_relaxed);
+        js["completed_upto"] = completed_upto();
+        js["active_upto"] = active_upto();
+
+        if (verbosity == 2) {
+            js["alloced_count"] = m_nchunks.load(std::memory_order_relaxed) * ChunkSlots;
+            if (AutoTruncate) {
+                js["completed_since_last_truncate"] =
+                    m_cmpltd_count_since_last_truncate.load(std::memory_order_relaxed);
+            }
+            js["truncate_frequency"] = m_truncate_on_count;
+        }
+        return js;
+    }
+
+private:
+    struct rcu_read_guard {
+        rcu_read_guard() { rcu_read_lock(); }
+        rcu_read_guard(const rcu_read_guard&) = delete;
+        rcu_read_guard& operator=(const rcu_read_guard&) = delete;
+        ~rcu_read_guard() { rcu_read_unlock(); }
+    };
+
+    // ChunkSlots of slots starting from m_base_idx + m_cn * ChunkSlots, with their active and completed bits.
+    struct chunk {
+        explicit chunk(const uint64_t cn) : m_cn{cn} {}
+        static void free(struct rcu_head* const rh) { delete reinterpret_cast< chunk* >(rh); }
+
+        T* slot_data(const uint64_t slot) { return reinterpret_cast< T* >(&m_slot_data[slot * sizeof(T)]); }
+
+        rcu_head m_rcu_head; // Has to be the first member
+        const uint64_t m_cn;
+        FixedBitset< ChunkSlots, Bitword< safe_bits< uint64_t > > > m_active_bits;
+        FixedBitset< ChunkSlots, Bitword< safe_bits< uint64_t > > > m_comp_bits;
+        alignas(T) std::byte m_slot_data[ChunkSlots * sizeof(T)];
+    };
+
+    // Ring of the chunks, where chunk n is at n % size. It is grown (and replaced) when a new chunk would overlap an
+    // older chunk which is not truncated yet.
+    struct chunk_dir {
+        explicit chunk_dir(const size_t nchunks) : m_chunks(nchunks) {}
+        static void free(struct rcu_head* const rh) { delete reinterpret_cast< chunk_dir* >(rh); }
+
+        rcu_head m_rcu_head; // Has to be the first member
+        std::vector< std::atomic< chunk* > > m_chunks;
+    };
+
+    template < class... Args >
+    int64_t do_update(int64_t idx, const auto& processor, bool replace, Args&&... args) {
+        bool need_truncate{false};
+        int64_t ret;
+        {
+            rcu_read_guard guard;
+
+            // In case we got an update for older idx which was already swept, return right away
+            ret = m_slot_ref_idx.load(std::memory_order_acquire) - 1;
+            if (idx <= ret) { return ret; }
+
+            const uint64_t pos{slot_pos(idx)};
+            chunk* const c{get_or_create_chunk(pos / ChunkSlots)};
+            if (!c) { return m_slot_ref_idx.load(std::memory_order_acquire) - 1; }
+
+            const uint64_t slot{pos % ChunkSlots};
+            T* data;
+            if (replace || !c->m_active_bits.get_bitval(slot)) {
+                // First time being updated, so use placement new to use the slot to build data
+                data = new (static_cast< void* >(c->slot_data(slot))) T(std::forward< Args >(args)...);
+                c->m_active_bits.set_bit(slot);
+            } else {
+                data = c->slot_data(slot);
+            }
+
+            // Check with processor to update any fields and return if they are completed
+            if (processor(*data)) {
+                c->m_comp_bits.set_bit(slot);
+                need_truncate = account_completions(1);
+            }
+            ret = m_slot_ref_idx.load(std::memory_order_acquire) - 1;
+        }
+
+        if (need_truncate) { ret = auto_truncate().value_or(ret); }
+        return ret;
+    }
+
+    // Returns if it is time to auto truncate after these completions
+    bool account_completions(size_t ncompleted) {
+        if (ncompleted == 0) { return false; }
+        COUNTER_INCREMENT(m_metrics, stream_tracker_unsweeped_completions, ncompleted);
+        return AutoTruncate &&
+            ((m_cmpltd_count_since_last_truncate.fetch_add(ncompleted, std::memory_order_acq_rel) + ncompleted) >
+             m_truncate_on_count);
+    }
+
+    // Returns the truncated idx, or nullopt if some other completing thread is already truncating (no need to wait
+    // for it)
+    std::optional< int64_t > auto_truncate() {
+        std::unique_lock< std::mutex > lock{m_truncate_mutex, std::try_to_lock};
+        if (!lock.owns_lock()) { return std::nullopt; }
+        return do_truncate(completed_upto() + 1);
+    }
+
+    // NOTE: must be called with m_truncate_mutex locked
+    int64_t do_truncate(const int64_t new_ref_idx) {
+        const int64_t ref_idx{m_slot_ref_idx.load(std::memory_order_acquire)};
+        if (new_ref_idx <= ref_idx) { return ref_idx - 1; }
+
+        m_cmpltd_count_since_last_truncate.store(0, std::memory_order_release);
+        m_slot_ref_idx.store(new_ref_idx, std::memory_order_release);
+        COUNTER_DECREMENT(m_metrics, stream_tracker_unsweeped_completions, new_ref_idx - ref_idx);
+
+        // Retire all the chunks which are fully behind the new cursor. The updates still using them (which started
+        // before the cursor moved) are done before the chunks are freed.
+        const uint64_t ref_cn{slot_pos(new_ref_idx) / ChunkSlots};
+        std::vector< chunk* > retired;
+        {
+            std::scoped_lock< std::mutex > lock{m_dir_mutex};
+            for (auto& entry : m_dir->m_chunks) {
+                chunk* const c{entry.load(std::memory_order_relaxed)};
+                if (c && (c->m_cn < ref_cn)) {
+                    entry.store(nullptr, std::memory_order_release);
+                    retired.push_back(c);
+                }
+            }
+        }
+        for (chunk* const c : retired) {
+            call_rcu(&c->m_rcu_head, chunk::free);
+        }
+        GAUGE_UPDATE(m_metrics, stream_tracker_mem_size,
+                     (m_nchunks.fetch_sub(retired.size(), std::memory_order_relaxed) - retired.size()) *
+                         sizeof(chunk));
+        return new_ref_idx - 1;
+    }
+
+    uint64_t slot_pos(const int64_t idx) const { return static_cast< uint64_t >(idx - m_base_idx); }
+
+    // NOTE: must be called under rcu read lock
+    chunk* find_chunk(const uint64_t cn) const {
+        const chunk_dir* const dir{rcu_dereference(m_dir)};
+        chunk* const c{dir->m_chunks[cn & (dir->m_chunks.size() - 1)].load(std::memory_order_acquire)};
+        return (c && (c->m_cn == cn)) ? c : nullptr;
+    }
+
+    // NOTE: must be called under rcu read lock. Returns nullptr if the chunk is already truncated.
+    chunk* get_or_create_chunk(const uint64_t cn) {
+        chunk* c{find_chunk(cn)};
+        if (c) { return c; }
+
+        std::scoped_lock< std::mutex > lock{m_dir_mutex};
+        if (cn < (slot_pos(m_slot_ref_idx.load(std::memory_order_acquire)) / ChunkSlots)) { return nullptr; }
+        c = find_chunk(cn);
+        if (c) { return c; }
+
+        chunk_dir* dir{m_dir};
+        if (dir->m_chunks[cn & (dir->m_chunks.size() - 1)].load(std::memory_order_relaxed) != nullptr) {
+            dir = grow_dir(cn);
+        }
+        c = new chunk{cn};
+        dir->m_chunks[cn & (dir->m_chunks.size() - 1)].store(c, std::memory_order_release);
+        GAUGE_UPDATE(m_metrics, stream_tracker_mem_size,
+                     (m_nchunks.fetch_add(1, std::memory_order_relaxed) + 1) * sizeof(chunk));
+        return c;
+    }
+
+    // NOTE: must be called with m_dir_mutex locked
+    chunk_dir* grow_dir(const uint64_t cn) {
+        chunk_dir* const old_dir{m_dir};
+        uint64_t first_cn{cn};
+        uint64_t last_cn{cn};
+        for (auto& entry : old_dir->m_chunks) {
+            const chunk* const c{entry.load(std::memory_order_relaxed)};
+            if (c) {
+                first_cn = std::min(first_cn, c->m_cn);
+                last_cn = std::max(last_cn, c->m_cn);
+            }
+        }
+
+        // All the chunks from the oldest one to the newest one need to be in different entries
+        size_t nchunks{old_dir->m_chunks.size()};
+        while (nchunks <= (last_cn - first_cn)) {
+            nchunks *= 2;
+        }
+        chunk_dir* const new_dir{new chunk_dir{nchunks}};
+        for (auto& entry : old_dir->m_chunks) {
+            chunk* const c{entry.load(std::memory_order_relaxed)};
+            if (c) { new_dir->m_chunks[c->m_cn & (nchunks - 1)].store(c, std::memory_order_relaxed); }
+        }
+        rcu_assign_pointer(m_dir, new_dir);
+        call_rcu(&old_dir->m_rcu_head, chunk_dir::free);
+        return new_dir;
+    }
+
+    // NOTE: must be called under rcu read lock
+    int64_t _upto(bool completed, int64_t search_hint_idx) const {
+        int64_t idx{std::max(search_hint_idx, m_slot_ref_idx.load(std::memory_order_acquire))};
+        while (true) {
+            const uint64_t pos{slot_pos(idx)};
+            const chunk* const c{find_chunk(pos / ChunkSlots)};
+            if (!c) { return idx - 1; }
+            const uint64_t slot{pos % ChunkSlots};
+            const uint64_t first_incomplete_slot{completed ? c->m_comp_bits.get_next_reset_bit(slot)
+                                                           : c->m_active_bits.get_next_reset_bit(slot)};
+            if (first_incomplete_slot != FixedBitset< ChunkSlots >::npos) {
+                return idx + static_cast< int64_t >(first_incomplete_slot - slot) - 1;
+            }
+            idx += static_cast< int64_t >(ChunkSlots - slot);
+        }
+    }
+
+    void _foreach_contiguous(int64_t start_idx, bool completed_only, const auto& cb) {
+        rcu_read_guard guard;
+        auto upto = _upto(completed_only, start_idx);
+        for (auto idx = std::max(start_idx, m_slot_ref_idx.load(std::memory_order_acquire)); idx <= upto; ++idx) {
+            const uint64_t pos{slot_pos(idx)};
+            chunk* const c{find_chunk(pos / ChunkSlots)};
+            if (!c) { break; }
+            auto proceed = cb(idx, upto, *(c->slot_data(pos % ChunkSlots)));
+            if (!proceed) break;
+        }
+    }
+
+    void _foreach_all(int64_t start_idx, bool completed_only, const auto& cb) {
+        rcu_read_guard guard;
+        const chunk_dir* const dir{rcu_dereference(m_dir)};
+        uint64_t last_cn{0};
+        for (auto& entry : dir->m_chunks) {
+            const chunk* const c{entry.load(std::memory_order_acquire)};
+            if (c) { last_cn = std::max(last_cn, c->m_cn); }
+        }
+
+        const int64_t first_idx{std::max(start_idx, m_slot_ref_idx.load(std::memory_order_acquire))};
+        uint64_t slot{slot_pos(first_idx) % ChunkSlots};
+        for (uint64_t cn{slot_pos(first_idx) / ChunkSlots}; cn <= last_cn; ++cn, slot = 0) {
+            chunk* const c{find_chunk(cn)};
+            if (!c) { continue; }
+            while (true) {
+                slot = completed_only ? c->m_comp_bits.get_next_set_bit(slot) : c->m_active_bits.get_next_set_bit(slot);
+                if (slot == FixedBitset< ChunkSlots >::npos) { break; }
+                if (!cb(m_base_idx + static_cast< int64_t >(cn * ChunkSlots + slot), *(c->slot_data(slot)))) {
+                    return;
+                }
+                if (++slot == ChunkSlots) { break; }
+            }
+        }
+    }
+
+private:
+    // Idx of the first slot of the first chunk
+    const int64_t m_base_idx;
+
+    // Reference idx of the stream. This is the cursor idx which it is tracking
+    std::atomic< int64_t > m_slot_ref_idx;
+
+    // Directory of the chunks, replaced under rcu when it is grown
+    chunk_dir* m_dir;
+
+    // Serializes the chunk allocation, directory growth and retiring of the chunks; not taken on the update path
+    // unless a new chunk is needed
+    std::mutex m_dir_mutex;
+
+    // Only one truncate at a time; auto truncate skips it when another truncate is in progress
+    std::mutex m_truncate_mutex;
+
+    // Total number of chunks allocated
+    std::atomic< size_t > m_nchunks{0};
+
+    // Total number of entries completely acked (for all txns) since last truncate
+    std::atomic< size_t > m_cmpltd_count_since_last_truncate{0};
+
+    // How frequent (on count) truncate needs to happen
+    uint32_t m_truncate_on_count{1000};
+
+    StreamTrackerMetrics m_metrics;
+};
+} // namespace sisl
@@ -16,7 +16,25 @@
  *********************************************************************************/
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #include <folly/SharedMutex.h>
+#include <folly/futures/Future.h>
 #include <sisl/metrics/metrics_group_impl.hpp>
 #include <sisl/metrics/metrics.hpp>
 
@@ -37,34 +55,172 @@ public:
     ~StreamTrackerMetrics() { deregister_me_from_farm(); }
 };
 
-template < typename T, bool AutoTruncate = false >
+#pragma pack(1)
+// Header of StreamTracker::serialize() output. It is followed by the compressed completion and active bitsets and
+// then the data of the active entries, in the order of their idx.
+struct stream_tracker_serialized {
+    static constexpr uint32_t s_magic{0x53545254};
+    static constexpr uint32_t s_version{1};
+
+    uint32_t m_magic{s_magic};
+    uint32_t m_version{s_version};
+    int64_t m_slot_ref_idx;
+    uint64_t m_nentries;
+    uint32_t m_entry_size;
+    uint32_t m_comp_bits_size;
+    uint32_t m_active_bits_size;
+};
+#pragma pack()
+
+// Slot storage of the StreamTracker, as one contiguous array which is reallocated on resize and compacted after
+// truncates. Hence only for trivially copyable classes.
+template < typename T >
+class StreamTrackerFlatStorage {
+public:
+    static constexpr size_t compaction_threshold = 5000;
+    static_assert(std::is_trivially_copyable< T >::value, "Cannot use StreamTracker for non-trivally copyable classes");
+
+    explicit StreamTrackerFlatStorage(size_t nslots) : m_alloced_slots{nslots} {
+        m_slot_data = (T*)std::calloc(nslots, sizeof(T));
+        if (m_slot_data == nullptr) { throw std::bad_alloc(); }
+    }
+    StreamTrackerFlatStorage(const StreamTrackerFlatStorage&) = delete;
+    StreamTrackerFlatStorage& operator=(const StreamTrackerFlatStorage&) = delete;
+    ~StreamTrackerFlatStorage() { free(m_slot_data); }
+
+    T* at(size_t slot) const { return &(m_slot_data[slot + m_data_skip_count]); }
+
+    void resize(size_t new_count) {
+        auto new_slot_data = (T*)std::calloc(new_count, sizeof(T));
+        if (new_slot_data == nullptr) { throw std::bad_alloc(); }
+
+        std::memmove((void*)&new_slot_data[0], (void*)&m_slot_data[m_data_skip_count], (sizeof(T) * m_alloced_slots));
+        free(m_slot_data);
+        m_slot_data = new_slot_data;
+        m_alloced_slots = new_count;
+        m_data_skip_count = 0;
+    }
+
+    void truncate(size_t nslots) {
+        // Instead of memmoving every truncate which could also be frequent, we simply mark to skip that much data and
+        // then when we are really needed we compact them.
+        m_data_skip_count += nslots;
+        m_alloced_slots -= nslots;
+        if (m_data_skip_count > compaction_threshold) {
+            std::memmove((void*)&m_slot_data[0], (void*)&m_slot_data[m_data_skip_count], (sizeof(T) * m_alloced_slots));
+            m_data_skip_count = 0;
+        }
+    }
+
+    size_t mem_size() const { return (m_alloced_slots + m_data_skip_count) * sizeof(T); }
+    size_t garbage_count() const { return m_data_skip_count; }
+
+private:
+    // The array of cursors which are being processed right now. We purposefully didn't want to use std::vector
+    // because, completion bits truncates everything at one shot and we don't want iterating one after other under
+    // lock.
+    T* m_slot_data{nullptr};
+
+    // Amount of data to skip before m_slot_data[0] index starts. This is done to avoid memmove entire data set
+    // everytime it is truncated. Instead it leaves the buffer as is and then shrinks fewer a between
+    size_t m_data_skip_count{0};
+
+    // Total number of slots allocated, excluding the skipped ones
+    size_t m_alloced_slots{0};
+};
+
+// Slot storage of the StreamTracker in fixed size slabs, which are added on resize and dropped once all their slots
+// are truncated. Objects are never moved, so any class (including move only ones) can be stored in place.
+template < typename T, size_t SlabSlots = 1024 >
+class StreamTrackerSlabStorage {
+public:
+    explicit StreamTrackerSlabStorage(size_t nslots) { resize(nslots); }
+    StreamTrackerSlabStorage(const StreamTrackerSlabStorage&) = delete;
+    StreamTrackerSlabStorage& operator=(const StreamTrackerSlabStorage&) = delete;
+    ~StreamTrackerSlabStorage() = default;
+
+    T* at(size_t slot) const {
+        slot += m_head_skip;
+        return m_slabs[slot / SlabSlots]->at(slot % SlabSlots);
+    }
+
+    void resize(size_t new_count) {
+        while ((m_slabs.size() * SlabSlots - m_head_skip) < new_count) {
+            m_slabs.push_back(std::make_unique< slab >());
+        }
+    }
+
+    void truncate(size_t nslots) {
+        m_head_skip += nslots;
+        while (m_head_skip >= SlabSlots) {
+            m_slabs.pop_front();
+            m_head_skip -= SlabSlots;
+        }
+    }
+
+    size_t mem_size() const { return m_slabs.size() * sizeof(slab); }
+    size_t garbage_count() const { return m_head_skip; }
+
+private:
+    struct slab {
+        T* at(size_t slot) { return reinterpret_cast< T* >(&m_data[slot * sizeof(T)]); }
+        alignas(T) std::byte m_data[SlabSlots * sizeof(T)];
+    };
+
+    std::deque< std::unique_ptr< slab > > m_slabs;
+
+    // Slots of the first slab which are already truncated
+    size_t m_head_skip{0};
+};
+
+/**
+ * @brief StreamTracker
+ *
+ * @tparam T Type of the entry tracked on each idx
+ * @tparam AutoTruncate Truncate upto the completed entries, on every so many completions
+ * @tparam Storage Slot storage. Trivially copyable entries are kept in one array, others in slabs which never move.
+ */
+template < typename T, bool AutoTruncate = false,
+           typename Storage = std::conditional_t< std::is_trivially_copyable_v< T >, StreamTrackerFlatStorage< T >,
+                                                  StreamTrackerSlabStorage< T > > >
 class StreamTracker {
     // using data_processing_t = std::function< bool(T&) >;
 
 public:
     static constexpr size_t alloc_blk_size = 10000;
-    static constexpr size_t compaction_threshold = alloc_blk_size / 2;
-    static constexpr auto null_processor = []([[maybe_unused]] auto... x) -> bool { return true; };
+    static constexpr auto null_processor = []([[maybe_unused]] const auto&... x) -> bool { return true; };
 
-    static_assert(std::is_trivially_copyable< T >::value, "Cannot use StreamTracker for non-trivally copyable classes");
+    // Called with the completed_upto idx which satisfied the waiter
+    typedef std::function< void(int64_t) > completion_cb_t;
 
     // Initialize the stream vector with start index
     StreamTracker(const char* name = "StreamTracker", int64_t start_idx = -1) :
-            m_comp_slot_bits(alloc_blk_size), m_active_slot_bits(alloc_blk_size), m_metrics(name) {
+            m_comp_slot_bits(alloc_blk_size),
+            m_active_slot_bits(alloc_blk_size),
+            m_slot_data(alloc_blk_size),
+            m_metrics(name) {
         m_slot_ref_idx = start_idx + 1;
+        m_waiter_watermark.store(start_idx, std::memory_order_release);
 
-        // Allocate the data for that size.
-        m_slot_data = (T*)std::calloc(alloc_blk_size, sizeof(T));
         m_alloced_slots = alloc_blk_size;
-        GAUGE_UPDATE(m_metrics, stream_tracker_mem_size, (m_alloced_slots * sizeof(T)));
+        GAUGE_UPDATE(m_metrics, stream_tracker_mem_size, m_slot_data.mem_size());
     }
 
+    /**
+     * @brief Construct the tracker from the buffer created by serialize(). Throws std::out_of_range if the buffer is
+     * not a serialized tracker of this entry type.
+     */
+    StreamTracker(const char* name, const sisl::byte_array& b) : StreamTracker(name, b, read_serialized_header(b)) {}
+
     ~StreamTracker() {
         GAUGE_UPDATE(m_metrics, stream_tracker_mem_size, 0);
-        free(m_slot_data);
+        destroy_slots(0, m_alloced_slots);
     }
 
-    void reinit(int64_t start_idx) { m_slot_ref_idx = start_idx; }
+    void reinit(int64_t start_idx) {
+        m_slot_ref_idx = start_idx;
+        m_waiter_watermark.store(start_idx - 1, std::memory_order_release);
+    }
 
     template < class... Args >
     int64_t create_and_complete(int64_t idx, Args&&... args) {
@@ -82,22 +238,76 @@ public:
         return do_update(idx, processor, false /* replace */, std::forward< Args >(args)...);
     }
 
+    // Create the batch of entries under one lock acquisition. Entries can be in any order, but consecutive idx in the
+    // batch are marked together. The values are moved out of the entries, except for those already truncated. Returns
+    // the idx upto which the stream is truncated.
+    int64_t create_batch(std::span< std::pair< int64_t, T > > entries) {
+        return do_batch_update(entries, false /* complete */);
+    }
+
+    int64_t create_and_complete_batch(std::span< std::pair< int64_t, T > > entries) {
+        return do_batch_update(entries, true /* complete */);
+    }
+
     void complete(int64_t start_idx, int64_t end_idx) {
-        folly::SharedMutexWritePriority::ReadHolder holder(m_lock);
-        auto start_bit = start_idx - m_slot_ref_idx;
-        m_comp_slot_bits.set_bits(start_bit, end_idx - start_idx + 1);
+        bool need_truncate{false};
+        lock_shared_upto(end_idx);
+
+        // Part of the range could already be swept
+        start_idx = std::max(start_idx, m_slot_ref_idx);
+        if (start_idx <= end_idx) {
+            const size_t nbits = end_idx - start_idx + 1;
+            m_comp_slot_bits.set_bits(start_idx - m_slot_ref_idx, nbits);
+            need_truncate = account_completions(nbits);
+        }
+        m_lock.unlock_shared();
+
+        notify_waiters();
+        if (need_truncate) { truncate(); }
     }
 
     void rollback(int64_t new_end_idx) {
-        folly::SharedMutexWritePriority::ReadHolder holder(m_lock);
+        // Non trivial entries are destroyed here, which must not race with the updates (or another rollback) of them
+        using holder_t = std::conditional_t< std::is_trivially_destructible_v< T >,
+                                             folly::SharedMutexWritePriority::ReadHolder,
+                                             folly::SharedMutexWritePriority::WriteHolder >;
+        holder_t holder(m_lock);
         if ((new_end_idx < m_slot_ref_idx) ||
             (new_end_idx >= (m_slot_ref_idx + int64_cast(m_active_slot_bits.size())))) {
             throw std::out_of_range("Slot idx is not in range");
         }
 
         auto new_end_bit = new_end_idx - m_slot_ref_idx;
+        destroy_slots(new_end_bit + 1, m_alloced_slots);
         m_active_slot_bits.reset_bits(new_end_bit + 1, m_active_slot_bits.size() - new_end_bit - 1);
         m_comp_slot_bits.reset_bits(new_end_bit + 1, m_comp_slot_bits.size() - new_end_bit - 1);
+
+        // Completions beyond the new end are gone, so the waiters need to search from there
+        int64_t watermark{m_waiter_watermark.load(std::memory_order_acquire)};
+        while ((watermark > new_end_idx) &&
+               !m_waiter_watermark.compare_exchange_weak(watermark, new_end_idx, std::memory_order_acq_rel)) {}
+    }
+
+    /**
+     * @brief Call the cb once completed_upto() >= idx. The cb is called from the thread which completes the entries
+     * upto idx (or truncates past it), or right away on this thread if it is already completed. So the cb should not
+     * block for long.
+     */
+    void on_completed_upto(int64_t idx, completion_cb_t cb) {
+        {
+            std::scoped_lock< std::mutex > lock{m_waiters_mutex};
+            m_waiters.emplace(idx, std::move(cb));
+            m_min_waiter_idx.store(m_waiters.begin()->first, std::memory_order_release);
+        }
+        notify_waiters();
+    }
+
+    // Future which is fulfilled with the completed_upto idx, once completed_upto() >= idx
+    folly::SemiFuture< int64_t > completed_upto_future(int64_t idx) {
+        auto promise = std::make_shared< folly::Promise< int64_t > >();
+        auto fut = promise->getSemiFuture();
+        on_completed_upto(idx, [promise](int64_t upto) { promise->setValue(upto); });
+        return fut;
     }
 
     T& at(int64_t idx) const {
@@ -140,11 +350,18 @@ public:
     }
 
     size_t truncate(int64_t idx) {
-        folly::SharedMutexWritePriority::WriteHolder holder(m_lock);
+        size_t ret;
+        {
+            folly::SharedMutexWritePriority::WriteHolder holder(m_lock);
 
-        auto upto_bit = idx - m_slot_ref_idx + 1;
-        if (upto_bit <= 0) { return m_slot_ref_idx - 1; }
-        return do_truncate(upto_bit);
+            auto upto_bit = idx - m_slot_ref_idx + 1;
+            if (upto_bit <= 0) { return m_slot_ref_idx - 1; }
+            ret = do_truncate(upto_bit);
+        }
+
+        // Truncating past the incomplete entries moves the completed_upto as well
+        notify_waiters();
+        return ret;
     }
 
     size_t truncate() {
@@ -166,17 +383,13 @@ public:
 
     size_t do_truncate(int64_t upto_bit) {
         // Move all the bits upto the first incomplete bit
+        destroy_slots(0, upto_bit);
         m_comp_slot_bits.shrink_head(upto_bit);
         m_active_slot_bits.shrink_head(upto_bit);
 
-        // Shrink the data as well upto first_incomplete_bit. Instead of memmoving every truncate which could also
-        // be frequent, we simply mark to skip that much data and then when we are really needed we compact them.
-        m_data_skip_count += upto_bit;
+        // Shrink the data as well upto first_incomplete_bit
+        m_slot_data.truncate(upto_bit);
         m_alloced_slots -= upto_bit;
-        if (m_data_skip_count > compaction_threshold) {
-            std::memmove((void*)&m_slot_data[0], (void*)&m_slot_data[m_data_skip_count], (sizeof(T) * m_alloced_slots));
-            m_data_skip_count = 0;
-        }
 
         // auto prev_ref_idx = m_slot_ref_idx;
         m_slot_ref_idx += upto_bit;
@@ -188,6 +401,44 @@ public:
         return m_slot_ref_idx - 1;
     }
 
+    /**
+     * @brief Serialize the cursor, completion/active bits and the data of the active entries into a buffer, which can
+     * be loaded with StreamTracker(name, buf). The tracker is locked exclusively while it is serialized.
+     */
+    sisl::byte_array serialize() const {
+        static_assert(std::is_trivially_copyable< T >::value, "Only trivially copyable entries can be serialized");
+        folly::SharedMutexWritePriority::WriteHolder holder(m_lock);
+
+        const auto comp_buf{m_comp_slot_bits.serialize_compressed()};
+        const auto active_buf{m_active_slot_bits.serialize_compressed()};
+        stream_tracker_serialized hdr;
+        hdr.m_slot_ref_idx = m_slot_ref_idx;
+        hdr.m_nentries = m_active_slot_bits.get_set_count();
+        hdr.m_entry_size = sizeof(T);
+        hdr.m_comp_bits_size = comp_buf->size;
+        hdr.m_active_bits_size = active_buf->size;
+
+        const uint64_t total_bytes{sizeof(stream_tracker_serialized) + comp_buf->size + active_buf->size +
+                                   hdr.m_nentries * sizeof(T)};
+        if (total_bytes > std::numeric_limits< uint32_t >::max()) {
+            throw std::out_of_range("Stream tracker is too large to serialize");
+        }
+        auto buf{make_byte_array(static_cast< uint32_t >(total_bytes))};
+        uint8_t* cur{buf->bytes};
+        std::memcpy(static_cast< void* >(cur), &hdr, sizeof(stream_tracker_serialized));
+        cur += sizeof(stream_tracker_serialized);
+        std::memcpy(cur, comp_buf->bytes, comp_buf->size);
+        cur += comp_buf->size;
+        std::memcpy(cur, active_buf->bytes, active_buf->size);
+        cur += active_buf->size;
+        for (auto bit = m_active_slot_bits.get_next_set_bit(0); bit != AtomicBitset::npos;
+             bit = m_active_slot_bits.get_next_set_bit(bit + 1)) {
+            std::memcpy(cur, (const void*)get_slot_data(bit), sizeof(T));
+            cur += sizeof(T);
+        }
+        return buf;
+    }
+
     void foreach_contiguous_completed(int64_t start_idx, const auto& cb) { _foreach_contiguous(start_idx, true, cb); }
     void foreach_contiguous_active(int64_t start_idx, const auto& cb) { _foreach_contiguous(start_idx, false, cb); }
     void foreach_all_completed(int64_t start_idx, const auto& cb) { _foreach_all(start_idx, true, cb); }
@@ -216,12 +467,47 @@ public:
                     m_cmpltd_count_since_last_truncate.load(std::memory_order_relaxed);
             }
             js["truncate_frequency"] = m_truncate_on_count;
-            js["garbage_count"] = m_data_skip_count;
+            js["garbage_count"] = m_slot_data.garbage_count();
         }
         return js;
     }
 
 private:
+    // Loads the tracker from the buffer, with its header already validated by read_serialized_header()
+    StreamTracker(const char* name, const sisl::byte_array& b, const stream_tracker_serialized& hdr) :
+            m_comp_slot_bits(AtomicBitset::compressed, serialized_section(b, 0, hdr.m_comp_bits_size)),
+            m_active_slot_bits(AtomicBitset::compressed,
+                               serialized_section(b, hdr.m_comp_bits_size, hdr.m_active_bits_size)),
+            m_slot_data(m_active_slot_bits.size()),
+            m_metrics(name) {
+        static_assert(std::is_trivially_copyable< T >::value, "Only trivially copyable entries can be deserialized");
+        if (m_comp_slot_bits.size() != m_active_slot_bits.size()) {
+            throw std::out_of_range("Serialized stream tracker bitsets do not match");
+        }
+
+        const uint64_t data_offset{sizeof(stream_tracker_serialized) + hdr.m_comp_bits_size + hdr.m_active_bits_size};
+        if (((b->size - data_offset) / sizeof(T)) < hdr.m_nentries) {
+            throw std::out_of_range("Serialized stream tracker buffer is truncated");
+        }
+        m_slot_ref_idx = hdr.m_slot_ref_idx;
+        m_alloced_slots = m_active_slot_bits.size();
+        m_waiter_watermark.store(m_slot_ref_idx - 1, std::memory_order_release);
+
+        // Active entries are matched against the data while it is copied, without a separate pass to count them
+        const uint8_t* cur{b->bytes + data_offset};
+        uint64_t nentries{0};
+        for (auto bit = m_active_slot_bits.get_next_set_bit(0); bit != AtomicBitset::npos;
+             bit = m_active_slot_bits.get_next_set_bit(bit + 1)) {
+            if (nentries++ == hdr.m_nentries) { break; }
+            std::memcpy((void*)get_slot_data(bit), cur, sizeof(T));
+            cur += sizeof(T);
+        }
+        if (nentries != hdr.m_nentries) {
+            throw std::out_of_range("Serialized stream tracker active entries do not match its data");
+        }
+        GAUGE_UPDATE(m_metrics, stream_tracker_mem_size, m_slot_data.mem_size());
+    }
+
     template < class... Args >
     int64_t do_update(int64_t idx, const auto& processor, bool replace, Args&&... args) {
         bool need_truncate = false;
@@ -250,6 +536,7 @@ private:
         T* data;
         if (replace || !m_active_slot_bits.get_bitval(nbit)) {
             // First time being updated, so use placement new to use the slot to build data
+            if (replace) { destroy_slots(nbit, nbit + 1); }
             data = new ((void*)get_slot_data(nbit)) T(std::forward< Args >(args)...);
             m_active_slot_bits.set_bit(nbit);
         } else {
@@ -257,23 +544,111 @@ private:
         }
 
         // Check with processor to update any fields and return if they are completed
-        if (processor(*data)) {
+        const bool completed{processor(*data)};
+        if (completed) {
             // All actions on this idx is completed, truncate if needbe
             m_comp_slot_bits.set_bit(nbit);
-            if (AutoTruncate) {
-                if (m_cmpltd_count_since_last_truncate.fetch_add(1, std::memory_order_acq_rel) >= m_truncate_on_count) {
-                    need_truncate = true;
-                }
-            }
-            COUNTER_INCREMENT(m_metrics, stream_tracker_unsweeped_completions, 1);
+            need_truncate = account_completions(1);
         }
         ret = m_slot_ref_idx - 1;
         m_lock.unlock_shared();
 
+        if (completed) { notify_waiters(); }
         if (need_truncate) { ret = truncate(); }
         return ret;
     }
 
+    int64_t do_batch_update(std::span< std::pair< int64_t, T > > entries, bool complete) {
+        int64_t max_idx{std::numeric_limits< int64_t >::min()};
+        for (const auto& [idx, data] : entries) {
+            max_idx = std::max(max_idx, idx);
+        }
+        lock_shared_upto(max_idx);
+
+        size_t ncompleted{0};
+        size_t i{0};
+        while (i < entries.size()) {
+            // Skip the older idx which are already swept
+            if (entries[i].first < m_slot_ref_idx) {
+                ++i;
+                continue;
+            }
+
+            // Build the run of consecutive idx, so its bits are set a word at a time
+            const size_t start_bit = entries[i].first - m_slot_ref_idx;
+            size_t nbits{0};
+            do {
+                destroy_slots(start_bit + nbits, start_bit + nbits + 1);
+                new ((void*)get_slot_data(start_bit + nbits)) T(std::move(entries[i].second));
+                ++nbits;
+                ++i;
+            } while ((i < entries.size()) && (entries[i].first == entries[i - 1].first + 1));
+
+            m_active_slot_bits.set_bits(start_bit, nbits);
+            if (complete) {
+                m_comp_slot_bits.set_bits(start_bit, nbits);
+                ncompleted += nbits;
+            }
+        }
+
+        const bool need_truncate{account_completions(ncompleted)};
+        int64_t ret = m_slot_ref_idx - 1;
+        m_lock.unlock_shared();
+
+        if (ncompleted > 0) { notify_waiters(); }
+        if (need_truncate) { ret = truncate(); }
+        return ret;
+    }
+
+    // Calls the waiters which are satisfied by the current completed_upto. Completing threads check the waiters after
+    // setting their bits and the waiters recheck after registering, so whichever is later sees both.
+    void notify_waiters() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_min_waiter_idx.load(std::memory_order_acquire) == no_waiter_idx) { return; }
+
+        // All the entries upto the watermark were seen completed, so there is no need to search from the start
+        const int64_t upto{completed_upto(m_waiter_watermark.load(std::memory_order_acquire) + 1)};
+        int64_t watermark{m_waiter_watermark.load(std::memory_order_acquire)};
+        while ((watermark < upto) &&
+               !m_waiter_watermark.compare_exchange_weak(watermark, upto, std::memory_order_acq_rel)) {}
+        if (upto < m_min_waiter_idx.load(std::memory_order_acquire)) { return; }
+
+        std::vector< completion_cb_t > ready_cbs;
+        {
+            std::scoped_lock< std::mutex > lock{m_waiters_mutex};
+            const auto end_it{m_waiters.upper_bound(upto)};
+            for (auto it{m_waiters.begin()}; it != end_it; ++it) {
+                ready_cbs.push_back(std::move(it->second));
+            }
+            m_waiters.erase(m_waiters.begin(), end_it);
+            m_min_waiter_idx.store(m_waiters.empty() ? no_waiter_idx : m_waiters.begin()->first,
+                                   std::memory_order_release);
+        }
+
+        for (auto& cb : ready_cbs) {
+            cb(upto);
+        }
+    }
+
+    // Takes the shared lock, after making sure the slots are allocated upto the idx
+    void lock_shared_upto(int64_t idx) {
+        do {
+            m_lock.lock_shared();
+            if ((idx < m_slot_ref_idx) || (size_t(idx - m_slot_ref_idx) < m_alloced_slots)) { return; }
+            m_lock.unlock_shared();
+            do_resize(idx - m_slot_ref_idx + 1);
+        } while (true);
+    }
+
+    // Returns if it is time to auto truncate after these completions
+    bool account_completions(size_t ncompleted) {
+        if (ncompleted == 0) { return false; }
+        COUNTER_INCREMENT(m_metrics, stream_tracker_unsweeped_completions, ncompleted);
+        return AutoTruncate &&
+            ((m_cmpltd_count_since_last_truncate.fetch_add(ncompleted, std::memory_order_acq_rel) + ncompleted) >
+             m_truncate_on_count);
+    }
+
     void do_resize(size_t atleast_count) {
         folly::SharedMutexWritePriority::WriteHolder holder(m_lock);
 
@@ -281,19 +656,24 @@ private:
         if (atleast_count < m_alloced_slots) { return; }
 
         auto new_count = std::max((m_alloced_slots * 2), atleast_count);
-        auto new_slot_data = (T*)std::calloc(new_count, sizeof(T));
-        if (new_slot_data == nullptr) { throw std::bad_alloc(); }
-
-        std::memmove((void*)&new_slot_data[0], (void*)&m_slot_data[m_data_skip_count], (sizeof(T) * m_alloced_slots));
-        free(m_slot_data);
-        m_slot_data = new_slot_data;
+        m_slot_data.resize(new_count);
         m_alloced_slots = new_count;
-        m_data_skip_count = 0;
 
         m_active_slot_bits.resize(new_count);
         m_comp_slot_bits.resize(new_count);
 
-        GAUGE_UPDATE(m_metrics, stream_tracker_mem_size, (m_alloced_slots * sizeof(T)));
+        GAUGE_UPDATE(m_metrics, stream_tracker_mem_size, m_slot_data.mem_size());
+    }
+
+    // Destroy the entries which are active in the slots [start_bit, end_bit)
+    void destroy_slots(size_t start_bit, size_t end_bit) {
+        if constexpr (!std::is_trivially_destructible_v< T >) {
+            auto bit = m_active_slot_bits.get_next_set_bit(start_bit);
+            while ((bit != AtomicBitset::npos) && (bit < end_bit)) {
+                get_slot_data(bit)->~T();
+                bit = m_active_slot_bits.get_next_set_bit(bit + 1);
+            }
+        }
     }
 
     int64_t _upto(bool completed, int64_t search_hint_idx) const {
@@ -319,17 +699,41 @@ private:
 
     void _foreach_all(int64_t start_idx, bool completed_only, const auto& cb) {
         folly::SharedMutexWritePriority::ReadHolder holder(m_lock);
-        auto search_bit = std::max(0l, (start_idx - m_slot_ref_idx));
+        uint64_t search_bit = std::max(0l, (start_idx - m_slot_ref_idx));
         do {
             search_bit = completed_only ? m_comp_slot_bits.get_next_set_bit(search_bit)
                                         : m_active_slot_bits.get_next_set_bit(search_bit);
             if (search_bit == AtomicBitset::npos) { break; }
-            if (!cb(search_bit + m_slot_ref_idx, *(get_slot_data(search_bit)))) { break; }
+            if (!cb(int64_cast(search_bit) + m_slot_ref_idx, *(get_slot_data(search_bit)))) { break; }
             ++search_bit;
         } while (true);
     }
 
-    T* get_slot_data(int64_t nbit) const { return &(m_slot_data[nbit + m_data_skip_count]); }
+    T* get_slot_data(int64_t nbit) const { return m_slot_data.at(nbit); }
+
+    static stream_tracker_serialized read_serialized_header(const sisl::byte_array& b) {
+        if (b->size < sizeof(stream_tracker_serialized)) {
+            throw std::out_of_range("Serialized stream tracker buffer is truncated");
+        }
+        stream_tracker_serialized hdr;
+        std::memcpy(static_cast< void* >(&hdr), b->bytes, sizeof(stream_tracker_serialized));
+        if ((hdr.m_magic != stream_tracker_serialized::s_magic) ||
+            (hdr.m_version != stream_tracker_serialized::s_version) || (hdr.m_entry_size != sizeof(T))) {
+            throw std::out_of_range("Buffer is not a serialized stream tracker of this type");
+        }
+        if ((b->size - sizeof(stream_tracker_serialized)) <
+            (uint64_t{hdr.m_comp_bits_size} + uint64_t{hdr.m_active_bits_size})) {
+            throw std::out_of_range("Serialized stream tracker buffer is truncated");
+        }
+        return hdr;
+    }
+
+    // Copy of the section at the offset (from the end of the header), to be loaded as a bitset
+    static sisl::byte_array serialized_section(const sisl::byte_array& b, uint32_t offset, uint32_t size) {
+        auto section{make_byte_array(size)};
+        std::memcpy(section->bytes, b->bytes + sizeof(stream_tracker_serialized) + offset, size);
+        return section;
+    }
 
 private:
     // Mutex to protect the completion of last commit info
@@ -341,14 +745,8 @@ private:
     // A bitset that tracks which are active or completed.
     sisl::AtomicBitset m_active_slot_bits;
 
-    // The array of cursors which are being processed right now. We purposefully didn't want to use std::vector
-    // because, completion bits truncates everything at one shot and we don't want iterating one after other under
-    // lock.
-    T* m_slot_data{nullptr};
-
-    // Amount of data to skip before m_slot_data[0] index starts. This is done to avoid memmove entire data set
-    // everytime it is truncated. Instead it leaves the buffer as is and then shrinks fewer a between
-    size_t m_data_skip_count{0};
+    // The cursors which are being processed right now
+    Storage m_slot_data;
 
     // Total number of slots allocated
     size_t m_alloced_slots{0};
@@ -362,6 +760,15 @@ private:
     // How frequent (on count) truncate needs to happen
     uint32_t m_truncate_on_count{1000};
 
+    // Callbacks waiting for completed_upto to reach the idx, with the lowest of those idx to check without the lock
+    static constexpr int64_t no_waiter_idx{std::numeric_limits< int64_t >::max()};
+    std::mutex m_waiters_mutex;
+    std::multimap< int64_t, completion_cb_t > m_waiters;
+    std::atomic< int64_t > m_min_waiter_idx{no_waiter_idx};
+
+    // completed_upto as last seen by the waiters, where the next search can start from
+    std::atomic< int64_t > m_waiter_watermark{-1};
+
     StreamTrackerMetrics m_metrics;
 };
 } // namespace sisl
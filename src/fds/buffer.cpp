@@ -14,31 +14,677 @@
  * specific language governing permissions and limitations under the License.
  *
  *********************************************************************************/
+#include <atomic>
 #include <cstring>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <unordered_map>
+
+#include <execinfo.h>
+#include <sys/mman.h>
+
+#include "sisl/fds/bitset.hpp"
 #include "sisl/fds/buffer.hpp"
 
 namespace sisl {
+struct AlignedAllocatorMetrics::sampler {
+    static constexpr size_t nshards{16};
+    static constexpr int max_frames{24};
+
+    struct sample {
+        buftag tag;
+        size_t size;
+        uint64_t stack_id;
+        std::chrono::steady_clock::time_point alloc_time;
+    };
+
+    // Samples are spread across the shards by the buffer address, so that the frees don't serialize on a single lock
+    struct shard {
+        std::mutex mtx;
+        std::unordered_map< const uint8_t*, sample > samples;
+    };
+
+    shard& shard_of(const uint8_t* const buf) {
+        const auto addr{r_cast< uintptr_t >(buf)};
+        return shards[((addr >> 6) ^ (addr >> 20)) % nshards];
+    }
+
+    template < typename CB >
+    void foreach_long_lived(const CB& cb) {
+        const auto now{std::chrono::steady_clock::now()};
+        const auto min_age{std::chrono::milliseconds{long_lived_ms.load(std::memory_order_relaxed)}};
+        for (auto& sh : shards) {
+            std::scoped_lock lg{sh.mtx};
+            for (const auto& [buf, smpl] : sh.samples) {
+                if ((now - smpl.alloc_time) >= min_age) { cb(smpl, now - smpl.alloc_time); }
+            }
+        }
+    }
+
+    std::array< shard, nshards > shards;
+    std::atomic< int64_t > long_lived_ms{0};
+
+    // Allocation stacks of the samples, each one is dropped when its last sample is freed
+    struct stack_info {
+        std::vector< void* > frames;
+        uint64_t nsamples{0};
+    };
+
+    void release_stack(const uint64_t stack_id) {
+        std::scoped_lock lg{stacks_mtx};
+        const auto it{stacks.find(stack_id)};
+        if ((it != stacks.end()) && (--it->second.nsamples == 0)) { stacks.erase(it); }
+    }
+
+    std::mutex stacks_mtx;
+    std::unordered_map< uint64_t, stack_info > stacks;
+};
+
+namespace {
+// Allocations of this thread since it last sampled
+thread_local uint32_t t_unsampled_allocs{0};
+} // namespace
+
+AlignedAllocatorMetrics::AlignedAllocatorMetrics() :
+        MetricsGroup("AlignedAllocation", "Singleton"), m_sampler{std::make_unique< sampler >()} {
+    for (auto t{(uint8_t)buftag::common}; t < (uint8_t)buftag::sentinel; ++t) {
+        const std::string name = "buftag_" + enum_name((buftag)t);
+        m_tag_idx[t] = m_impl_ptr->register_counter(name, name, _publish_as::publish_as_gauge);
+        m_tag_alloc_idx[t] = m_impl_ptr->register_counter(name + "_alloc_count", "Number of allocations of " + name,
+                                                          _publish_as::publish_as_counter);
+        m_tag_size_hist_idx[t] = m_impl_ptr->register_histogram(
+            name + "_alloc_size", "Allocation sizes of " + name, HistogramBucketsType(ExponentialOfTwoBuckets));
+        m_tag_hwm_idx[t] = m_impl_ptr->register_gauge(name + "_high_watermark", "Max live bytes of " + name);
+        m_tag_long_lived_idx[t] =
+            m_impl_ptr->register_gauge(name + "_long_lived_bytes", "Sampled long lived bytes of " + name);
+    }
+    m_pool_hit_idx = m_impl_ptr->register_counter("pool_hit_count", "Allocations served from the buffer pool",
+                                                  _publish_as::publish_as_counter);
+    m_pool_miss_idx = m_impl_ptr->register_counter("pool_miss_count", "Allocations not found in the buffer pool",
+                                                   _publish_as::publish_as_counter);
+    register_me_to_farm();
+    attach_gather_cb(std::bind(&AlignedAllocatorMetrics::on_gather, this));
+}
+
+AlignedAllocatorMetrics::~AlignedAllocatorMetrics() = default;
+
+void AlignedAllocatorMetrics::reset_high_watermarks() {
+    for (auto& stats : m_tag_stats) {
+        stats.high_watermark.store(stats.live_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+void AlignedAllocatorMetrics::enable_sampling(const uint32_t one_in, const std::chrono::milliseconds long_lived) {
+    assert(one_in != 0);
+    m_sampler->long_lived_ms.store(long_lived.count(), std::memory_order_relaxed);
+    m_sample_one_in.store(one_in, std::memory_order_relaxed);
+}
+
+void AlignedAllocatorMetrics::disable_sampling() {
+    m_sample_one_in.store(0, std::memory_order_relaxed);
+    for (auto& sh : m_sampler->shards) {
+        std::scoped_lock lg{sh.mtx};
+        m_nsampled.fetch_sub(sh.samples.size(), std::memory_order_relaxed);
+        sh.samples.clear();
+    }
+    std::scoped_lock lg{m_sampler->stacks_mtx};
+    m_sampler->stacks.clear();
+}
+
+void AlignedAllocatorMetrics::sample(const buftag tag, const size_t size, const uint8_t* const buf) {
+    const uint32_t one_in{m_sample_one_in.load(std::memory_order_relaxed)};
+    if ((one_in == 0) || (++t_unsampled_allocs < one_in)) { return; }
+    t_unsampled_allocs = 0;
+
+    std::array< void*, sampler::max_frames > frames;
+    const int nframes{::backtrace(frames.data(), sampler::max_frames)};
+
+    // FNV-1a of the return addresses, skipping this frame
+    uint64_t stack_id{14695981039346656037ULL};
+    for (int i{1}; i < nframes; ++i) {
+        stack_id = (stack_id ^ r_cast< uintptr_t >(frames[i])) * 1099511628211ULL;
+    }
+    {
+        std::scoped_lock lg{m_sampler->stacks_mtx};
+        auto [it, inserted] = m_sampler->stacks.try_emplace(stack_id);
+        if (inserted) { it->second.frames.assign(frames.begin() + 1, frames.begin() + nframes); }
+        ++it->second.nsamples;
+    }
+
+    // Sample of the same buffer whose free was not seen is replaced
+    std::optional< uint64_t > replaced_stack_id;
+    {
+        auto& sh{m_sampler->shard_of(buf)};
+        std::scoped_lock lg{sh.mtx};
+        const sampler::sample smpl{tag, size, stack_id, std::chrono::steady_clock::now()};
+        if (auto it{sh.samples.find(buf)}; it != sh.samples.end()) {
+            replaced_stack_id = it->second.stack_id;
+            it->second = smpl;
+        } else {
+            sh.samples.emplace(buf, smpl);
+            m_nsampled.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (replaced_stack_id) { m_sampler->release_stack(*replaced_stack_id); }
+}
+
+void AlignedAllocatorMetrics::drop_sample(const uint8_t* const buf) {
+    uint64_t stack_id{0};
+    {
+        auto& sh{m_sampler->shard_of(buf)};
+        std::scoped_lock lg{sh.mtx};
+        const auto it{sh.samples.find(buf)};
+        if (it == sh.samples.end()) { return; }
+        stack_id = it->second.stack_id;
+        sh.samples.erase(it);
+        m_nsampled.fetch_sub(1, std::memory_order_relaxed);
+    }
+    m_sampler->release_stack(stack_id);
+}
+
+size_t AlignedAllocatorMetrics::sampled_stack_count() const {
+    std::scoped_lock lg{m_sampler->stacks_mtx};
+    return m_sampler->stacks.size();
+}
+
+void AlignedAllocatorMetrics::on_gather() {
+    std::array< int64_t, (size_t)buftag::sentinel > long_lived_bytes{};
+    if (m_nsampled.load(std::memory_order_relaxed) != 0) {
+        m_sampler->foreach_long_lived([&long_lived_bytes](const sampler::sample& smpl, const auto&) {
+            long_lived_bytes[(size_t)smpl.tag] += smpl.size;
+        });
+    }
+    for (size_t t{0}; t < (size_t)buftag::sentinel; ++t) {
+        m_impl_ptr->gauge_update(m_tag_hwm_idx[t], m_tag_stats[t].high_watermark.load(std::memory_order_relaxed));
+        m_impl_ptr->gauge_update(m_tag_long_lived_idx[t], long_lived_bytes[t]);
+    }
+}
+
+nlohmann::json AlignedAllocatorMetrics::dump_json() const {
+    nlohmann::json j;
+    for (auto t{(uint8_t)buftag::common}; t < (uint8_t)buftag::sentinel; ++t) {
+        j["buftags"][enum_name((buftag)t)] = {{"live_bytes", live_bytes((buftag)t)},
+                                              {"high_watermark", high_watermark((buftag)t)},
+                                              {"alloc_count", alloc_count((buftag)t)}};
+    }
+    j["sampling"] = {{"one_in", m_sample_one_in.load(std::memory_order_relaxed)},
+                     {"long_lived_ms", m_sampler->long_lived_ms.load(std::memory_order_relaxed)},
+                     {"sampled_count", sampled_count()}};
+
+    // Long lived buffers grouped by the allocation stack and tag, the ones holding most bytes first
+    struct group {
+        uint64_t count{0};
+        uint64_t bytes{0};
+        int64_t oldest_ms{0};
+    };
+    std::map< std::pair< uint64_t, buftag >, group > groups;
+    m_sampler->foreach_long_lived([&groups](const sampler::sample& smpl, const auto& age) {
+        auto& grp{groups[{smpl.stack_id, smpl.tag}]};
+        ++grp.count;
+        grp.bytes += smpl.size;
+        grp.oldest_ms =
+            std::max< int64_t >(grp.oldest_ms, std::chrono::duration_cast< std::chrono::milliseconds >(age).count());
+    });
+
+    std::vector< std::pair< std::pair< uint64_t, buftag >, group > > sorted{groups.begin(), groups.end()};
+    std::sort(sorted.begin(), sorted.end(),
+              [](const auto& a, const auto& b) { return a.second.bytes > b.second.bytes; });
+
+    j["long_lived"] = nlohmann::json::array();
+    for (const auto& [key, grp] : sorted) {
+        nlohmann::json frames = nlohmann::json::array();
+        {
+            std::scoped_lock lg{m_sampler->stacks_mtx};
+            const auto stack_it{m_sampler->stacks.find(key.first)};
+            // Sampling was disabled (and the stacks dropped) after the samples were collected
+            if (stack_it == m_sampler->stacks.end()) { continue; }
+            const auto& stack{stack_it->second.frames};
+            char** const symbols{::backtrace_symbols(stack.data(), static_cast< int >(stack.size()))};
+            for (size_t i{0}; i < stack.size(); ++i) {
+                frames.push_back((symbols != nullptr) ? std::string{symbols[i]} : fmt::format("{}", stack[i]));
+            }
+            std::free(symbols);
+        }
+        j["long_lived"].push_back({{"stack_id", fmt::format("{:#x}", key.first)},
+                                   {"buftag", enum_name(key.second)},
+                                   {"count", grp.count},
+                                   {"bytes", grp.bytes},
+                                   {"oldest_age_ms", grp.oldest_ms},
+                                   {"stack", frames}});
+    }
+    return j;
+}
+
 uint8_t* AlignedAllocatorImpl::aligned_alloc(const size_t align, const size_t sz, const sisl::buftag tag) {
     auto* buf{static_cast< uint8_t* >(std::aligned_alloc(align, sisl::round_up(sz, align)))};
-    AlignedAllocator::metrics().increment(tag, buf_size(buf));
+    AlignedAllocator::metrics().increment(tag, buf_size(buf), buf);
     return buf;
 }
 
 void AlignedAllocatorImpl::aligned_free(uint8_t* const b, const sisl::buftag tag) {
-    AlignedAllocator::metrics().decrement(tag, buf_size(b));
+    AlignedAllocator::metrics().decrement(tag, buf_size(b), b);
     return std::free(b);
 }
 
 uint8_t* AlignedAllocatorImpl::aligned_realloc(uint8_t* const old_buf, const size_t align, const size_t new_sz,
-                                               const size_t old_sz) {
+                                               const size_t old_sz, const sisl::buftag tag) {
     // Glibc does not have an implementation of efficient realloc and hence we are using alloc/copy method here
     const size_t old_real_size{(old_sz == 0) ? ::malloc_usable_size(static_cast< void* >(old_buf)) : old_sz};
     if (old_real_size >= new_sz) return old_buf;
 
-    uint8_t* const new_buf{this->aligned_alloc(align, sisl::round_up(new_sz, align), buftag::common)};
+    uint8_t* const new_buf{this->aligned_alloc(align, sisl::round_up(new_sz, align), tag)};
     std::memcpy(static_cast< void* >(new_buf), static_cast< const void* >(old_buf), old_real_size);
 
-    aligned_free(old_buf, buftag::common);
+    aligned_free(old_buf, tag);
     return new_buf;
 }
+
+struct PooledAlignedAllocatorImpl::pool_depot {
+    struct size_class {
+        size_t size{0};
+        size_t thread_max{0}; // Max buffers in a thread cache, half of it is moved to/from the depot at once
+        size_t depot_max{0};
+        std::mutex mtx;
+        std::vector< uint8_t* > bufs;
+    };
+
+    pool_depot(const std::vector< size_t >& sizes, const size_t pool_align, const size_t thread_cache_bytes,
+               const size_t depot_bytes) :
+            align{pool_align}, classes(sizes.size()) {
+        for (size_t i{0}; i < sizes.size(); ++i) {
+            assert((i == 0) || (sizes[i] > sizes[i - 1]));
+            assert((sizes[i] % pool_align) == 0);
+            classes[i].size = sizes[i];
+            classes[i].thread_max = std::clamp< size_t >(thread_cache_bytes / sizes[i], 2, 64);
+            classes[i].depot_max = std::max< size_t >(depot_bytes / sizes[i], 1);
+        }
+    }
+
+    ~pool_depot() {
+        for (auto& cls : classes) {
+            for (auto* const buf : cls.bufs) {
+                std::free(buf);
+            }
+        }
+    }
+
+    // Move the buffers to the depot, the ones which are over the depot limit (or all, once retired) are freed
+    void put(const size_t c, uint8_t* const* const bufs, const size_t n) {
+        auto& cls{classes[c]};
+        size_t nput{0};
+        {
+            std::scoped_lock lg{cls.mtx};
+            if (!retired.load(std::memory_order_acquire)) {
+                nput = std::min(n, cls.depot_max - std::min(cls.depot_max, cls.bufs.size()));
+            }
+            cls.bufs.insert(cls.bufs.end(), bufs, bufs + nput);
+        }
+        for (size_t i{nput}; i < n; ++i) {
+            std::free(bufs[i]);
+        }
+    }
+
+    size_t take(const size_t c, std::vector< uint8_t* >& out, const size_t n) {
+        auto& cls{classes[c]};
+        std::scoped_lock lg{cls.mtx};
+        const size_t ntake{std::min(n, cls.bufs.size())};
+        out.insert(out.end(), cls.bufs.end() - ntake, cls.bufs.end());
+        cls.bufs.resize(cls.bufs.size() - ntake);
+        return ntake;
+    }
+
+    const size_t align;
+    std::vector< size_class > classes;
+
+    // Set when the allocator is destroyed, after which the buffers put by the thread caches still holding it are freed
+    std::atomic< bool > retired{false};
+};
+
+struct PooledAlignedAllocatorImpl::thread_cache {
+    explicit thread_cache(std::shared_ptr< pool_depot > d) : depot{std::move(d)}, bufs(depot->classes.size()) {}
+
+    // The depot outlives the allocator, if this thread exits after the allocator is gone
+    ~thread_cache() {
+        for (size_t c{0}; c < bufs.size(); ++c) {
+            depot->put(c, bufs[c].data(), bufs[c].size());
+        }
+    }
+
+    std::shared_ptr< pool_depot > depot;
+    std::vector< std::vector< uint8_t* > > bufs;
+};
+
+namespace {
+// Ids of the destroyed allocators are reused, so the caches of a thread don't grow with every allocator created
+struct pool_ids {
+    std::mutex mtx;
+    std::vector< size_t > free_ids;
+    size_t next_id{0};
+};
+
+pool_ids& pool_id_registry() {
+    static pool_ids s_ids;
+    return s_ids;
+}
+
+size_t acquire_pool_id() {
+    auto& ids{pool_id_registry()};
+    std::scoped_lock lg{ids.mtx};
+    if (ids.free_ids.empty()) { return ids.next_id++; }
+    const size_t id{ids.free_ids.back()};
+    ids.free_ids.pop_back();
+    return id;
+}
+
+void release_pool_id(const size_t id) {
+    auto& ids{pool_id_registry()};
+    std::scoped_lock lg{ids.mtx};
+    ids.free_ids.push_back(id);
+}
+
+// Bumped when a pooled allocator is destroyed, so the threads drop their caches of it on their next pool call
+std::atomic< uint64_t > s_retire_epoch{0};
+
+// Caches of this thread, indexed by the id of the pooled allocator
+struct thread_caches {
+    ~thread_caches();
+    std::vector< std::unique_ptr< PooledAlignedAllocatorImpl::thread_cache > > caches;
+    uint64_t retire_epoch{0};
+};
+thread_local thread_caches t_caches;
+
+// Set once the caches of this thread are destroyed, for the frees by the thread_local destructors which run after it
+thread_local bool t_caches_destroyed{false};
+
+thread_caches::~thread_caches() {
+    caches.clear();
+    t_caches_destroyed = true;
+}
+} // namespace
+
+PooledAlignedAllocatorImpl::PooledAlignedAllocatorImpl(std::vector< size_t > size_classes, const size_t pool_align,
+                                                       const size_t thread_cache_bytes, const size_t depot_bytes) :
+        m_depot{std::make_shared< pool_depot >(size_classes, pool_align, thread_cache_bytes, depot_bytes)},
+        m_id{acquire_pool_id()} {}
+
+PooledAlignedAllocatorImpl::~PooledAlignedAllocatorImpl() {
+    // Retire the depot before emptying it, so that the caches of the other threads are freed rather than put into it
+    m_depot->retired.store(true, std::memory_order_release);
+    release_cached();
+    if (!t_caches_destroyed && (t_caches.caches.size() > m_id)) { t_caches.caches[m_id].reset(); }
+    s_retire_epoch.fetch_add(1, std::memory_order_acq_rel);
+    release_pool_id(m_id);
+}
+
+size_t PooledAlignedAllocatorImpl::size_class_of(const size_t sz) const {
+    for (size_t c{0}; c < m_depot->classes.size(); ++c) {
+        const size_t cls_size{m_depot->classes[c].size};
+        if (sz <= cls_size) { return ((sz * 2) > cls_size) ? c : npos; }
+    }
+    return npos;
+}
+
+PooledAlignedAllocatorImpl::thread_cache* PooledAlignedAllocatorImpl::my_cache() {
+    if (t_caches_destroyed) { return nullptr; }
+    auto& caches{t_caches.caches};
+    if (const uint64_t epoch{s_retire_epoch.load(std::memory_order_acquire)}; t_caches.retire_epoch != epoch) {
+        // Some allocator was destroyed since, free the caches of this thread which belong to it. It also clears the
+        // slot of a reused id, before it is used for this allocator.
+        for (auto& cache : caches) {
+            if (cache && cache->depot->retired.load(std::memory_order_acquire)) { cache.reset(); }
+        }
+        t_caches.retire_epoch = epoch;
+    }
+    if (caches.size() <= m_id) { caches.resize(m_id + 1); }
+    if (!caches[m_id]) { caches[m_id] = std::make_unique< thread_cache >(m_depot); }
+    return caches[m_id].get();
+}
+
+uint8_t* PooledAlignedAllocatorImpl::aligned_pool_alloc(const size_t align, const size_t sz, const sisl::buftag tag) {
+    const size_t c{size_class_of(sz)};
+    if ((c == npos) || (align > m_depot->align) || ((m_depot->align % align) != 0)) {
+        return aligned_alloc(align, sz, tag);
+    }
+
+    uint8_t* buf{nullptr};
+    if (auto* const cache{my_cache()}; cache != nullptr) {
+        auto& bufs{cache->bufs[c]};
+        if (bufs.empty()) { m_depot->take(c, bufs, std::max< size_t >(m_depot->classes[c].thread_max / 2, 1)); }
+        if (!bufs.empty()) {
+            buf = bufs.back();
+            bufs.pop_back();
+        }
+    } else {
+        std::vector< uint8_t* > bufs;
+        if (m_depot->take(c, bufs, 1) == 1) { buf = bufs.back(); }
+    }
+
+    if (buf == nullptr) {
+        AlignedAllocator::metrics().pool_miss();
+        return aligned_alloc(m_depot->align, m_depot->classes[c].size, tag);
+    }
+    AlignedAllocator::metrics().pool_hit();
+    AlignedAllocator::metrics().increment(tag, buf_size(buf), buf);
+    return buf;
+}
+
+void PooledAlignedAllocatorImpl::aligned_pool_free(uint8_t* const b, const size_t sz, const sisl::buftag tag) {
+    // Take it only if it can serve any allocation of the size class, in case it was not allocated by the pool
+    const size_t c{size_class_of(sz)};
+    if ((c == npos) || ((reinterpret_cast< uintptr_t >(b) % m_depot->align) != 0) ||
+        (buf_size(b) < m_depot->classes[c].size)) {
+        aligned_free(b, tag);
+        return;
+    }
+
+    AlignedAllocator::metrics().decrement(tag, buf_size(b), b);
+    auto* const cache{my_cache()};
+    if (cache == nullptr) {
+        m_depot->put(c, &b, 1);
+        return;
+    }
+
+    auto& bufs{cache->bufs[c]};
+    bufs.push_back(b);
+    if (bufs.size() > m_depot->classes[c].thread_max) {
+        // Move the half which was freed earlier, the recently freed ones are more likely to be in the cpu cache
+        const size_t nmove{bufs.size() / 2};
+        m_depot->put(c, bufs.data(), nmove);
+        bufs.erase(bufs.begin(), bufs.begin() + nmove);
+    }
+}
+
+size_t PooledAlignedAllocatorImpl::depot_count() const {
+    size_t count{0};
+    for (auto& cls : m_depot->classes) {
+        std::scoped_lock lg{cls.mtx};
+        count += cls.bufs.size();
+    }
+    return count;
+}
+
+void PooledAlignedAllocatorImpl::release_cached() {
+    if (!t_caches_destroyed && (t_caches.caches.size() > m_id)) {
+        if (auto& cache{t_caches.caches[m_id]}; cache) {
+            for (auto& bufs : cache->bufs) {
+                for (auto* const buf : bufs) {
+                    std::free(buf);
+                }
+                bufs.clear();
+            }
+        }
+    }
+
+    for (auto& cls : m_depot->classes) {
+        std::vector< uint8_t* > bufs;
+        {
+            std::scoped_lock lg{cls.mtx};
+            bufs.swap(cls.bufs);
+        }
+        for (auto* const buf : bufs) {
+            std::free(buf);
+        }
+    }
+}
+
+struct HugePageArenaAllocatorImpl::arena_region {
+    explicit arena_region(const uint64_t nchunks) :
+            used_chunks{nchunks}, alloc_nchunks(nchunks, 0), alloc_tag(nchunks, buftag::common) {}
+
+    std::mutex mtx;
+    sisl::Bitset used_chunks;
+
+    // Number of chunks and the tag of the buffer which starts at each chunk
+    std::vector< uint32_t > alloc_nchunks;
+    std::vector< buftag > alloc_tag;
+    uint64_t hint{0};
+};
+
+HugePageArenaAllocatorImpl::HugePageArenaAllocatorImpl(const uint64_t region_size, const uint32_t nregions,
+                                                       const uint32_t chunk_size) :
+        m_region_size{region_size}, m_nregions{nregions}, m_chunk_size{chunk_size} {
+    assert(nregions > 0);
+    assert((region_size % hugepage_size) == 0);
+    assert((hugepage_size % chunk_size) == 0);
+    const uint64_t map_size{region_size * nregions};
+
+#ifdef MAP_HUGETLB
+    void* addr{::mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0)};
+    m_hugetlb = (addr != MAP_FAILED);
+#else
+    void* addr{MAP_FAILED};
+#endif
+    if (!m_hugetlb) {
+        // No hugepages reserved, map it aligned to the hugepage size so that it can be backed by transparent hugepages
+        addr = ::mmap(nullptr, map_size + hugepage_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "Unable to mmap buffer arena");
+        }
+        auto* const mapped{static_cast< uint8_t* >(addr)};
+        auto* const aligned{r_cast< uint8_t* >(sisl::round_up(r_cast< uintptr_t >(mapped), hugepage_size))};
+        if (aligned != mapped) { ::munmap(mapped, aligned - mapped); }
+        if (const auto tail{(mapped + map_size + hugepage_size) - (aligned + map_size)}; tail > 0) {
+            ::munmap(aligned + map_size, tail);
+        }
+        addr = aligned;
+#ifdef MADV_HUGEPAGE
+        // It is only a hint, transparent hugepages could be disabled
+        ::madvise(addr, map_size, MADV_HUGEPAGE);
+#endif
+    }
+    m_base = static_cast< uint8_t* >(addr);
+
+    m_regions.reserve(nregions);
+    for (uint32_t r{0}; r < nregions; ++r) {
+        m_regions.push_back(std::make_unique< arena_region >(region_size / chunk_size));
+    }
+}
+
+HugePageArenaAllocatorImpl::~HugePageArenaAllocatorImpl() { ::munmap(m_base, m_region_size * m_nregions); }
+
+uint8_t* HugePageArenaAllocatorImpl::arena_alloc(const uint32_t nchunks, const sisl::buftag tag) {
+    if (nchunks > (m_region_size / m_chunk_size)) { return nullptr; }
+
+    // Rotate the starting region, so that the threads allocating at the same time don't contend on the same region
+    const uint32_t start{m_next_region.fetch_add(1, std::memory_order_relaxed)};
+    for (uint32_t i{0}; i < m_nregions; ++i) {
+        const uint32_t r{(start + i) % m_nregions};
+        auto& region{*m_regions[r]};
+        std::scoped_lock lg{region.mtx};
+        auto blk{region.used_chunks.get_next_contiguous_n_reset_bits(region.hint, nchunks)};
+        if ((blk.start_bit == Bitset::npos) && (region.hint > 0)) {
+            blk = region.used_chunks.get_next_contiguous_n_reset_bits(0, nchunks);
+        }
+        if (blk.start_bit == Bitset::npos) { continue; }
+
+        region.used_chunks.set_bits(blk.start_bit, nchunks);
+        region.alloc_nchunks[blk.start_bit] = nchunks;
+        region.alloc_tag[blk.start_bit] = tag;
+        region.hint = blk.start_bit + nchunks;
+        return m_base + (r * m_region_size) + (blk.start_bit * m_chunk_size);
+    }
+    return nullptr;
+}
+
+uint8_t* HugePageArenaAllocatorImpl::aligned_alloc(const size_t align, const size_t sz, const sisl::buftag tag) {
+    if ((sz != 0) && (align <= m_chunk_size) && ((m_chunk_size % align) == 0)) {
+        const uint64_t nchunks{sisl::round_up(sz, m_chunk_size) / m_chunk_size};
+        if (auto* const buf{arena_alloc(static_cast< uint32_t >(nchunks), tag)}; buf != nullptr) {
+            m_tag_bytes[static_cast< size_t >(tag)].fetch_add(nchunks * m_chunk_size, std::memory_order_relaxed);
+            AlignedAllocator::metrics().increment(tag, nchunks * m_chunk_size, buf);
+            return buf;
+        }
+    }
+    m_fallback_count.fetch_add(1, std::memory_order_relaxed);
+    return AlignedAllocatorImpl::aligned_alloc(align, sz, tag);
+}
+
+void HugePageArenaAllocatorImpl::aligned_free(uint8_t* const b, const sisl::buftag tag) {
+    const uint32_t r{buffer_index(b)};
+    if (r == npos) {
+        AlignedAllocatorImpl::aligned_free(b, tag);
+        return;
+    }
+
+    // Bytes are uncharged from the tag the buffer was allocated with, which realloc does not pass on
+    auto& region{*m_regions[r]};
+    const uint64_t chunk{static_cast< uint64_t >(b - (m_base + (r * m_region_size))) / m_chunk_size};
+    uint64_t nchunks{0};
+    buftag alloc_tag{tag};
+    {
+        std::scoped_lock lg{region.mtx};
+        nchunks = region.alloc_nchunks[chunk];
+        assert(nchunks != 0);
+        alloc_tag = region.alloc_tag[chunk];
+        region.used_chunks.reset_bits(chunk, nchunks);
+        region.alloc_nchunks[chunk] = 0;
+    }
+    m_tag_bytes[static_cast< size_t >(alloc_tag)].fetch_sub(nchunks * m_chunk_size, std::memory_order_relaxed);
+    AlignedAllocator::metrics().decrement(alloc_tag, nchunks * m_chunk_size, b);
+}
+
+uint8_t* HugePageArenaAllocatorImpl::aligned_realloc(uint8_t* const old_buf, const size_t align, const size_t new_sz,
+                                                     const size_t old_sz, const sisl::buftag tag) {
+    const uint32_t r{buffer_index(old_buf)};
+    if (r == npos) { return AlignedAllocatorImpl::aligned_realloc(old_buf, align, new_sz, old_sz, tag); }
+
+    auto& region{*m_regions[r]};
+    const uint64_t chunk{static_cast< uint64_t >(old_buf - (m_base + (r * m_region_size))) / m_chunk_size};
+    size_t old_real_size{0};
+    buftag alloc_tag{tag};
+    {
+        std::scoped_lock lg{region.mtx};
+        old_real_size = region.alloc_nchunks[chunk] * m_chunk_size;
+        alloc_tag = region.alloc_tag[chunk];
+    }
+    if (old_real_size >= new_sz) { return old_buf; }
+
+    // New buffer keeps the tag of the old one
+    uint8_t* const new_buf{this->aligned_alloc(align, new_sz, alloc_tag)};
+    std::memcpy(static_cast< void* >(new_buf), static_cast< const void* >(old_buf),
+                (old_sz == 0) ? old_real_size : std::min(old_sz, old_real_size));
+    aligned_free(old_buf, alloc_tag);
+    return new_buf;
+}
+
+size_t HugePageArenaAllocatorImpl::buf_size(uint8_t* buf) const {
+    const uint32_t r{buffer_index(buf)};
+    if (r == npos) { return AlignedAllocatorImpl::buf_size(buf); }
+
+    auto& region{*m_regions[r]};
+    const uint64_t chunk{static_cast< uint64_t >(buf - (m_base + (r * m_region_size))) / m_chunk_size};
+    std::scoped_lock lg{region.mtx};
+    return region.alloc_nchunks[chunk] * m_chunk_size;
+}
+
+std::vector< iovec > HugePageArenaAllocatorImpl::registered_regions() const {
+    std::vector< iovec > iovs(m_nregions);
+    for (uint32_t r{0}; r < m_nregions; ++r) {
+        iovs[r].iov_base = m_base + (r * m_region_size);
+        iovs[r].iov_len = m_region_size;
+    }
+    return iovs;
+}
 } // namespace sisl
@@ -0,0 +1,258 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "sisl/logging/logging.h"
+#include "sisl/options/options.h"
+
+#include "sisl/fds/bitset.hpp"
+
+SISL_LOGGING_INIT(HOMESTORE_LOG_MODS)
+
+namespace {
+constexpr uint64_t TOTAL_BITS{1024 * 1024};
+constexpr size_t MAX_CLAIMS_PER_THREAD{16};
+
+std::mutex s_bset_mutex;
+std::unique_ptr< sisl::Bitset > s_bset;
+std::unique_ptr< sisl::AtomicBitset > s_atomic_bset;
+std::unique_ptr< sisl::Bitset > s_rank_bset;
+std::vector< uint64_t > s_rank_positions;
+
+// Each thread keeps a few claims outstanding before freeing them, so that the bitmap is partially filled and the
+// searches have to skip past other threads' claims, similar to an allocator.
+void mutex_bitset_claim(benchmark::State& state) {
+    const uint32_t nbits{static_cast< uint32_t >(state.range(0))};
+    std::array< uint64_t, MAX_CLAIMS_PER_THREAD > claims;
+    size_t nclaims{0};
+    uint64_t hint{(TOTAL_BITS / state.threads()) * state.thread_index()};
+
+    for ([[maybe_unused]] auto si : state) {
+        if (nclaims == claims.size()) {
+            std::scoped_lock< std::mutex > lock{s_bset_mutex};
+            for (const auto bit : claims) {
+                s_bset->reset_bits(bit, nbits);
+            }
+            nclaims = 0;
+        }
+
+        std::scoped_lock< std::mutex > lock{s_bset_mutex};
+        auto blk{s_bset->get_next_contiguous_n_reset_bits(hint, nbits)};
+        if (blk.start_bit == sisl::Bitset::npos) { blk = s_bset->get_next_contiguous_n_reset_bits(0, nbits); }
+        if (blk.start_bit != sisl::Bitset::npos) {
+            s_bset->set_bits(blk.start_bit, nbits);
+            claims[nclaims++] = blk.start_bit;
+            hint = blk.start_bit + nbits;
+        }
+    }
+
+    std::scoped_lock< std::mutex > lock{s_bset_mutex};
+    for (size_t i{0}; i < nclaims; ++i) {
+        s_bset->reset_bits(claims[i], nbits);
+    }
+}
+
+void atomic_bitset_try_claim(benchmark::State& state) {
+    const uint32_t nbits{static_cast< uint32_t >(state.range(0))};
+    std::array< uint64_t, MAX_CLAIMS_PER_THREAD > claims;
+    size_t nclaims{0};
+    uint64_t hint{(TOTAL_BITS / state.threads()) * state.thread_index()};
+
+    for ([[maybe_unused]] auto si : state) {
+        if (nclaims == claims.size()) {
+            for (const auto bit : claims) {
+                s_atomic_bset->reset_bits(bit, nbits);
+            }
+            nclaims = 0;
+        }
+
+        const auto blk{s_atomic_bset->try_claim_next_reset_bits(hint, nbits)};
+        if (blk.start_bit != sisl::AtomicBitset::npos) {
+            claims[nclaims++] = blk.start_bit;
+            hint = blk.start_bit + nbits;
+        }
+    }
+
+    for (size_t i{0}; i < nclaims; ++i) {
+        s_atomic_bset->reset_bits(claims[i], nbits);
+    }
+}
+
+void setup_rank_bitset() {
+    std::mt19937_64 re{12345};
+    s_rank_bset = std::make_unique< sisl::Bitset >(TOTAL_BITS);
+    for (uint64_t bit{0}; bit < TOTAL_BITS; ++bit) {
+        if ((re() % 3) == 0) { s_rank_bset->set_bit(bit); }
+    }
+    s_rank_positions.resize(1024);
+    for (auto& pos : s_rank_positions) {
+        pos = re() % TOTAL_BITS;
+    }
+}
+
+// Rank by counting from the beginning of the bitset as done before the rank index
+void rank_set_count(benchmark::State& state) {
+    size_t i{0};
+    for ([[maybe_unused]] auto si : state) {
+        const uint64_t pos{s_rank_positions[i++ % s_rank_positions.size()]};
+        benchmark::DoNotOptimize((pos == 0) ? 0 : s_rank_bset->get_set_count(0, pos - 1));
+    }
+}
+
+void rank_index(benchmark::State& state) {
+    size_t i{0};
+    for ([[maybe_unused]] auto si : state) {
+        benchmark::DoNotOptimize(s_rank_bset->rank(s_rank_positions[i++ % s_rank_positions.size()]));
+    }
+}
+
+// Select by a binary search over get_set_count as done before the rank index
+void select_set_count(benchmark::State& state) {
+    const uint64_t total_set{s_rank_bset->get_set_count()};
+    size_t i{0};
+    for ([[maybe_unused]] auto si : state) {
+        const uint64_t n{s_rank_positions[i++ % s_rank_positions.size()] % total_set};
+        uint64_t low{0};
+        uint64_t high{TOTAL_BITS - 1};
+        while (low < high) {
+            const uint64_t mid{low + (high - low) / 2};
+            if (s_rank_bset->get_set_count(0, mid) > n) {
+                high = mid;
+            } else {
+                low = mid + 1;
+            }
+        }
+        benchmark::DoNotOptimize(low);
+    }
+}
+
+void select_index(benchmark::State& state) {
+    const uint64_t total_set{s_rank_bset->get_set_count()};
+    size_t i{0};
+    for ([[maybe_unused]] auto si : state) {
+        benchmark::DoNotOptimize(s_rank_bset->select(s_rank_positions[i++ % s_rank_positions.size()] % total_set));
+    }
+}
+
+// Allocations of mixed sizes, with the random frees keeping the bitset around 95% full. First fit (arg 0) or best fit
+// (arg 1) search; failed counter has the allocations which could not be served due to the fragmentation.
+void mixed_size_claim(benchmark::State& state) {
+    const bool best_fit{state.range(0) == 1};
+    sisl::Bitset bset{TOTAL_BITS};
+    if (best_fit) { bset.enable_free_run_index(); }
+    std::mt19937_64 re{12345};
+    std::vector< sisl::BitBlock > claims;
+    uint64_t used_bits{0};
+    uint64_t failed{0};
+
+    for ([[maybe_unused]] auto si : state) {
+        const uint32_t nbits{((re() % 4) == 0) ? 256u : static_cast< uint32_t >(1 + re() % 16)};
+        const auto blk{best_fit ? bset.get_best_fit_contiguous_n_reset_bits(nbits)
+                                : bset.get_next_contiguous_n_reset_bits(0, nbits)};
+        if (blk.start_bit == sisl::Bitset::npos) {
+            ++failed;
+        } else {
+            bset.set_bits(blk.start_bit, nbits);
+            claims.push_back({blk.start_bit, nbits});
+            used_bits += nbits;
+        }
+
+        while (used_bits > (TOTAL_BITS * 19) / 20) {
+            const size_t i{re() % claims.size()};
+            bset.reset_bits(claims[i].start_bit, claims[i].nbits);
+            used_bits -= claims[i].nbits;
+            claims[i] = claims.back();
+            claims.pop_back();
+        }
+    }
+    state.counters["failed"] = static_cast< double >(failed);
+}
+
+// Same set/reset/search operations on each word width, over the same count of bits
+template < typename DataType >
+void word_width_ops(benchmark::State& state) {
+    constexpr uint8_t nbits{static_cast< uint8_t >(sizeof(DataType) * 8)};
+    std::vector< sisl::Bitword< sisl::unsafe_bits< DataType > > > words(TOTAL_BITS / nbits);
+    std::mt19937_64 re{12345};
+
+    for ([[maybe_unused]] auto si : state) {
+        for (auto& word : words) {
+            const uint8_t start{static_cast< uint8_t >(re() % nbits)};
+            word.set_bits(start, static_cast< uint8_t >(1 + re() % (nbits - start)));
+            uint8_t max_run{0};
+            word.get_max_contiguous_reset_bits(0, &max_run);
+            benchmark::DoNotOptimize(max_run + word.get_set_count());
+            word.reset_bits(start, static_cast< uint8_t >(nbits - start));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * TOTAL_BITS);
+}
+
+// Search for all the runs of 8 reset bits in a mostly filled bitset of each word width
+template < typename DataType >
+void bitset_word_width_search(benchmark::State& state) {
+    using bitset_t = sisl::BitsetImpl< sisl::Bitword< sisl::unsafe_bits< DataType > >, false >;
+    bitset_t bset{TOTAL_BITS};
+    std::mt19937_64 re{12345};
+    for (uint64_t bit{0}; bit < TOTAL_BITS; ++bit) {
+        if ((re() % 16) != 0) { bset.set_bit(bit); }
+    }
+
+    for ([[maybe_unused]] auto si : state) {
+        uint64_t nruns{0};
+        for (auto blk{bset.get_next_contiguous_n_reset_bits(0, 8)}; blk.start_bit != bitset_t::npos;
+             blk = bset.get_next_contiguous_n_reset_bits(blk.start_bit + blk.nbits, 8)) {
+            ++nruns;
+        }
+        benchmark::DoNotOptimize(nruns);
+    }
+    state.SetItemsProcessed(state.iterations() * TOTAL_BITS);
+}
+} // namespace
+
+BENCHMARK(mutex_bitset_claim)->Arg(1)->Arg(8)->Arg(64)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(atomic_bitset_try_claim)->Arg(1)->Arg(8)->Arg(64)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(rank_set_count);
+BENCHMARK(rank_index);
+BENCHMARK(select_set_count);
+BENCHMARK(select_index);
+BENCHMARK(mixed_size_claim)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(word_width_ops, uint8_t);
+BENCHMARK_TEMPLATE(word_width_ops, uint16_t);
+BENCHMARK_TEMPLATE(word_width_ops, uint32_t);
+BENCHMARK_TEMPLATE(word_width_ops, uint64_t);
+#ifdef __SIZEOF_INT128__
+BENCHMARK_TEMPLATE(word_width_ops, sisl::uint128_t);
+#endif
+BENCHMARK_TEMPLATE(bitset_word_width_search, uint32_t);
+BENCHMARK_TEMPLATE(bitset_word_width_search, uint64_t);
+#ifdef __SIZEOF_INT128__
+BENCHMARK_TEMPLATE(bitset_word_width_search, sisl::uint128_t);
+#endif
+
+SISL_OPTIONS_ENABLE(logging)
+int main(int argc, char** argv) {
+    SISL_OPTIONS_LOAD(argc, argv, logging)
+    s_bset = std::make_unique< sisl::Bitset >(TOTAL_BITS);
+    s_atomic_bset = std::make_unique< sisl::AtomicBitset >(TOTAL_BITS);
+    setup_rank_bitset();
+    ::benchmark::Initialize(&argc, argv);
+    ::benchmark::RunSpecifiedBenchmarks();
+}
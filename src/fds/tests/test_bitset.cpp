@@ -14,12 +14,18 @@
  * specific language governing permissions and limitations under the License.
  *
  *********************************************************************************/
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <memory>
 #include <random>
+#include <string>
 #include <thread>
 #include <vector>
 
+#include <unistd.h>
+
 #include <boost/dynamic_bitset.hpp>
 #include <sisl/logging/logging.h>
 #include <sisl/options/options.h>
@@ -527,6 +533,565 @@ TEST_F(BitsetTest, GetNextContiguousUptoNResetBits) {
     ASSERT_EQ(result13.nbits, static_cast< uint32_t >(32));
 }
 
+TEST_F(BitsetTest, SkipFullRegions) {
+    // large mostly full bitset with holes on either side of the vectorized block boundaries
+    constexpr uint64_t nbits{64 * 1024 + 37};
+    const std::vector< std::pair< uint64_t, uint32_t > > holes{
+        {0, 1}, {63, 2}, {509, 2}, {512, 64}, {4095, 1}, {4100, 130}, {40000, 7}, {nbits - 5, 5}};
+    for (const uint64_t shift : {uint64_t{0}, uint64_t{1}, uint64_t{33}, uint64_t{64}}) {
+        Bitset bset{nbits + shift};
+        bset.set_bits(0, nbits + shift);
+        if (shift > 0) { bset.shrink_head(shift); }
+        for (const auto& [start, count] : holes) {
+            bset.reset_bits(start, count);
+        }
+
+        uint64_t hole_start{0};
+        for (const auto& [start, count] : holes) {
+            ASSERT_EQ(bset.get_next_reset_bit(hole_start), start) << "shift=" << shift;
+            const auto result{bset.get_next_contiguous_n_reset_bits(hole_start, count)};
+            ASSERT_EQ(result.start_bit, start) << "shift=" << shift;
+            ASSERT_EQ(result.nbits, count) << "shift=" << shift;
+            hole_start = start + count;
+        }
+        ASSERT_EQ(bset.get_next_reset_bit(hole_start), Bitset::npos);
+
+        // no hole is big enough
+        const auto result{bset.get_next_contiguous_n_reset_bits(0, 200)};
+        ASSERT_EQ(result.start_bit, Bitset::npos);
+        ASSERT_EQ(result.nbits, static_cast< uint32_t >(0));
+    }
+}
+
+TEST_F(BitsetTest, SimdWordScan) {
+    std::vector< uint64_t > words(1031, ~static_cast< uint64_t >(0));
+    const auto validate{[&words](const uint64_t pattern, const uint64_t expected) {
+        for (uint64_t nwords{0}; nwords <= words.size(); nwords += 13) {
+            const uint64_t exp{std::min(expected, nwords)};
+            ASSERT_EQ(simd::find_first_word_not_equal_scalar(words.data(), nwords, pattern), exp);
+            ASSERT_EQ(simd::find_first_word_not_equal(words.data(), nwords, pattern), exp);
+#ifdef SISL_BITSET_SIMD_X86
+            if (simd::cpu_has_avx2()) {
+                ASSERT_EQ(simd::find_first_word_not_equal_avx2(words.data(), nwords, pattern), exp);
+            }
+            if (simd::cpu_has_avx512()) {
+                ASSERT_EQ(simd::find_first_word_not_equal_avx512(words.data(), nwords, pattern), exp);
+            }
+#endif
+        }
+    }};
+
+    validate(~static_cast< uint64_t >(0), words.size());
+    for (const uint64_t pos : {0, 1, 3, 4, 7, 8, 9, 500, 1024, 1030}) {
+        words[pos] = 0xFFFFFFFFFFFFFFF7;
+        validate(~static_cast< uint64_t >(0), pos);
+        words[pos] = ~static_cast< uint64_t >(0);
+    }
+}
+
+TEST_F(BitsetTest, SummarizedSearch) {
+    static thread_local std::random_device rd{};
+    static thread_local std::default_random_engine re{rd()};
+    const uint64_t nbits{64 * 64 * 10 + 37};
+
+    SummarizedBitset sbset{nbits};
+    Bitset bset{nbits};
+    sbset.set_bits(0, nbits);
+    bset.set_bits(0, nbits);
+
+    // Punch holes of random sizes so that only few blocks can satisfy a large request
+    std::uniform_int_distribution< uint64_t > bit_rand{0, nbits - 1};
+    std::uniform_int_distribution< uint64_t > len_rand{1, 300};
+    const auto validate{[&sbset, &bset, &nbits]() {
+        for (uint64_t start{0}; start < nbits; start += 997) {
+            ASSERT_EQ(sbset.get_next_reset_bit(start), bset.get_next_reset_bit(start)) << "start=" << start;
+            for (const uint32_t n : {1u, 7u, 64u, 100u, 200u, 300u}) {
+                const auto sb{sbset.get_next_contiguous_n_reset_bits(start, std::nullopt, n, 2 * n)};
+                const auto b{bset.get_next_contiguous_n_reset_bits(start, std::nullopt, n, 2 * n)};
+                ASSERT_EQ(sb.start_bit, b.start_bit) << "start=" << start << " n=" << n;
+                ASSERT_EQ(sb.nbits, b.nbits) << "start=" << start << " n=" << n;
+            }
+        }
+    }};
+
+    for (uint32_t iter{0}; iter < 50; ++iter) {
+        const uint64_t start{bit_rand(re)};
+        const uint64_t len{std::min(len_rand(re), nbits - start)};
+        if ((iter % 3) == 0) {
+            sbset.set_bits(start, len);
+            bset.set_bits(start, len);
+        } else {
+            sbset.reset_bits(start, len);
+            bset.reset_bits(start, len);
+        }
+        validate();
+    }
+
+    // Summary has to be valid after shift and resize as well
+    sbset.shrink_head(100);
+    bset.shrink_head(100);
+    validate();
+    sbset.resize(nbits + 5000);
+    bset.resize(nbits + 5000);
+    sbset.set_bits(nbits, 4000);
+    bset.set_bits(nbits, 4000);
+    validate();
+
+    SummarizedBitset copy_bset;
+    copy_bset.copy(sbset);
+    ASSERT_EQ(copy_bset.get_next_contiguous_n_reset_bits(0, std::nullopt, 200, 400).start_bit,
+              bset.get_next_contiguous_n_reset_bits(0, std::nullopt, 200, 400).start_bit);
+
+    // In place bitwise operations update the summary of only the bits they modify
+    SummarizedBitset sother{nbits / 2};
+    Bitset other{nbits / 2};
+    sother.set_bits(0, 1000);
+    other.set_bits(0, 1000);
+    sbset.or_with(sother);
+    bset.or_with(other);
+    validate();
+    sbset.andnot_with(sother);
+    bset.andnot_with(other);
+    validate();
+    sbset.and_with(sother);
+    bset.and_with(other);
+    validate();
+}
+
+TEST_F(BitsetTest, TryClaimWrapAround) {
+    AtomicBitset bset{1000};
+    bset.set_bits(0, 1000);
+    bset.reset_bits(10, 20);
+    bset.reset_bits(990, 10);
+
+    ASSERT_FALSE(bset.try_claim_bits(5, 10));
+    ASSERT_TRUE(bset.is_bits_reset(10, 20));
+    ASSERT_THROW(bset.try_claim_bits(995, 10), std::out_of_range);
+
+    // Search from 995 has to wrap around to find 20 bits
+    auto claimed{bset.try_claim_next_reset_bits(995, 20)};
+    ASSERT_EQ(claimed.start_bit, 10u);
+    ASSERT_EQ(claimed.nbits, 20u);
+    ASSERT_TRUE(bset.is_bits_set(10, 20));
+    ASSERT_EQ(bset.try_claim_next_reset_bits(995, 20).start_bit, AtomicBitset::npos);
+
+    // A claim failing in the last word should rollback the words claimed before
+    bset.reset_bits(40, 100);
+    bset.set_bit(139);
+    ASSERT_FALSE(bset.try_claim_bits(40, 100));
+    ASSERT_TRUE(bset.is_bits_reset(40, 99));
+    ASSERT_EQ(bset.try_claim_next_reset_bit(998), 998u);
+    ASSERT_EQ(bset.try_claim_next_reset_bit(999), 999u);
+    ASSERT_EQ(bset.try_claim_next_reset_bit(999), 40u);
+
+    // Released only once
+    ASSERT_TRUE(bset.try_release_bit(40));
+    ASSERT_FALSE(bset.try_release_bit(40));
+    ASSERT_FALSE(bset.get_bitval(40));
+    ASSERT_THROW(bset.try_release_bit(1000), std::out_of_range);
+}
+
+TEST_F(BitsetTest, ConcurrentTryClaim) {
+    const uint64_t nbits{64 * 1024 + 29};
+    AtomicBitset bset{nbits};
+    std::vector< std::vector< BitBlock > > thread_claims(g_num_threads);
+
+    std::vector< std::thread > threads;
+    for (uint32_t t{0}; t < g_num_threads; ++t) {
+        threads.emplace_back([&bset, &thread_claims, t, nbits]() {
+            static thread_local std::random_device rd{};
+            static thread_local std::default_random_engine re{rd()};
+            std::uniform_int_distribution< uint32_t > n_rand{1, 100};
+            uint64_t hint{(nbits / g_num_threads) * t};
+            while (true) {
+                const auto claimed{bset.try_claim_next_reset_bits(hint, n_rand(re))};
+                if (claimed.start_bit == AtomicBitset::npos) {
+                    // Try the smallest claim, before giving up
+                    const uint64_t bit{bset.try_claim_next_reset_bit(hint)};
+                    if (bit == AtomicBitset::npos) { break; }
+                    thread_claims[t].emplace_back(bit, 1);
+                } else {
+                    thread_claims[t].push_back(claimed);
+                    hint = claimed.start_bit + claimed.nbits;
+                }
+            }
+        });
+    }
+    for (auto& thr : threads) {
+        thr.join();
+    }
+
+    // Every bit should be claimed by exactly one thread
+    std::vector< uint8_t > owners(nbits, 0);
+    for (const auto& claims : thread_claims) {
+        for (const auto& claim : claims) {
+            for (uint64_t bit{claim.start_bit}; bit < claim.start_bit + claim.nbits; ++bit) {
+                ASSERT_EQ(owners[bit]++, 0) << "Bit " << bit << " claimed by more than one thread";
+            }
+        }
+    }
+    ASSERT_EQ(std::count(std::begin(owners), std::end(owners), 1), static_cast< int64_t >(nbits));
+    ASSERT_EQ(bset.get_set_count(), nbits);
+}
+
+TEST_F(BitsetTest, BitwiseOperations) {
+    static thread_local std::random_device rd{};
+    static thread_local std::default_random_engine re{rd()};
+
+    // Create bitset of given size and shift, filled with random bits and also its equivalent vector
+    const auto make_random{[](auto& bset, std::vector< bool >& expected, const uint64_t nbits, const uint64_t shift) {
+        std::uniform_int_distribution< uint8_t > rand{0, 3};
+        bset.resize(nbits + shift);
+        bset.shrink_head(shift);
+        expected.resize(nbits);
+        for (uint64_t bit{0}; bit < nbits; ++bit) {
+            // Have few fully set/reset regions, so that aligned words are exercised as well
+            expected[bit] = ((bit / 512) % 3 == 0) ? ((bit / 512) % 2 == 0) : (rand(re) == 0);
+            if (expected[bit]) {
+                bset.set_bit(bit);
+            } else {
+                bset.reset_bit(bit);
+            }
+        }
+    }};
+
+    const auto validate{[&make_random](auto lhs, auto rhs) {
+        for (const auto& [lhs_bits, rhs_bits, lhs_shift, rhs_shift] :
+             std::vector< std::array< uint64_t, 4 > >{{3000, 3000, 0, 0},
+                                                      {3000, 3000, 64, 0},
+                                                      {3000, 3000, 13, 13},
+                                                      {3000, 3000, 13, 77},
+                                                      {3001, 2500, 1, 0},
+                                                      {2500, 3001, 0, 65},
+                                                      {5, 3000, 3, 0}}) {
+            std::vector< bool > lhs_exp, rhs_exp;
+            make_random(lhs, lhs_exp, lhs_bits, lhs_shift);
+            make_random(rhs, rhs_exp, rhs_bits, rhs_shift);
+
+            for (const auto op :
+                 {bitwise_op::op_and, bitwise_op::op_or, bitwise_op::op_xor, bitwise_op::op_andnot}) {
+                std::vector< bool > result_exp(lhs_bits);
+                uint64_t expected_count{0};
+                for (uint64_t bit{0}; bit < lhs_bits; ++bit) {
+                    const bool r{(bit < rhs_bits) ? rhs_exp[bit] : false};
+                    result_exp[bit] = (op == bitwise_op::op_and) ? (lhs_exp[bit] && r)
+                        : (op == bitwise_op::op_or)              ? (lhs_exp[bit] || r)
+                        : (op == bitwise_op::op_xor)             ? (lhs_exp[bit] != r)
+                                                                 : (lhs_exp[bit] && !r);
+                    if (result_exp[bit]) { ++expected_count; }
+                }
+
+                ASSERT_EQ(lhs.get_set_count(rhs, op), expected_count) << "op=" << static_cast< int >(op);
+                const auto result{lhs.bitwise(rhs, op)};
+                ASSERT_EQ(result.size(), lhs_bits);
+                for (uint64_t bit{0}; bit < lhs_bits; ++bit) {
+                    ASSERT_EQ(result.get_bitval(bit), result_exp[bit])
+                        << "op=" << static_cast< int >(op) << " bit=" << bit << " lhs_shift=" << lhs_shift
+                        << " rhs_shift=" << rhs_shift;
+                }
+            }
+
+            // In place operations, applied one after the other
+            auto lhs_copy{lhs.bitwise(rhs, bitwise_op::op_or)};
+            lhs_copy ^= rhs;
+            ASSERT_EQ(lhs_copy.get_set_count(), lhs.get_set_count(rhs, bitwise_op::op_andnot));
+            lhs_copy &= rhs;
+            ASSERT_EQ(lhs_copy.get_set_count(), 0u);
+            lhs_copy.xor_with(lhs_copy);
+            ASSERT_EQ(lhs_copy.get_set_count(), 0u);
+        }
+    }};
+
+    validate(Bitset{}, Bitset{});
+    validate(AtomicBitset{}, AtomicBitset{});
+    using Bitset32 = BitsetImpl< Bitword< unsafe_bits< uint32_t > >, false >;
+    validate(Bitset32{}, Bitset32{});
+    validate(SummarizedBitset{}, SummarizedBitset{});
+#ifdef __SIZEOF_INT128__
+    using Bitset128 = BitsetImpl< Bitword< unsafe_bits< uint128_t > >, false >;
+    validate(Bitset128{}, Bitset128{});
+    validate(BitsetImpl< Bitword< unsafe_bits< uint128_t > >, false, true >{},
+             BitsetImpl< Bitword< unsafe_bits< uint128_t > >, false, true >{});
+#endif
+}
+
+TEST_F(BitsetTest, RankSelect) {
+    static thread_local std::random_device rd{};
+    static thread_local std::default_random_engine re{rd()};
+
+    const auto validate{[](const auto& bset, const std::vector< bool >& ref) {
+        uint64_t count{0};
+        for (uint64_t bit{0}; bit < ref.size(); ++bit) {
+            ASSERT_EQ(bset.rank(bit), count) << "bit=" << bit;
+            if (ref[bit]) {
+                ASSERT_EQ(bset.select(count), bit) << "n=" << count;
+                ++count;
+            }
+        }
+        ASSERT_EQ(bset.rank(ref.size()), count);
+        ASSERT_EQ(bset.rank(ref.size() + 1000), count);
+        ASSERT_EQ(bset.select(count), Bitset::npos);
+    }};
+
+    const auto test_bitset{[&validate](auto& bset) {
+        std::vector< bool > ref(bset.size(), false);
+        std::uniform_int_distribution< uint64_t > rand_bit{0, bset.size() - 1};
+        for (size_t i{0}; i < 400; ++i) {
+            const uint64_t start{rand_bit(re)};
+            const uint64_t nbits{std::min< uint64_t >(1 + rand_bit(re) % 700, bset.size() - start)};
+            bset.set_bits(start, nbits);
+            std::fill_n(ref.begin() + start, nbits, true);
+        }
+        validate(bset, ref);
+
+        // Writes update only the counts after the modified bit
+        for (size_t i{0}; i < 10; ++i) {
+            const uint64_t bit{rand_bit(re)};
+            bset.reset_bit(bit);
+            ref[bit] = false;
+            ASSERT_EQ(bset.rank(ref.size()), static_cast< uint64_t >(std::count(ref.cbegin(), ref.cend(), true)));
+        }
+        validate(bset, ref);
+
+        // Shift and resize rebuild the counts
+        bset.shrink_head(333);
+        ref.erase(ref.begin(), ref.begin() + 333);
+        validate(bset, ref);
+        bset.resize(ref.size() + 1000);
+        ref.resize(ref.size() + 1000, false);
+        bset.set_bits(ref.size() - 700, 700);
+        std::fill_n(ref.end() - 700, 700, true);
+        validate(bset, ref);
+
+        // Resize carries over the counts of the retained bits, while the shallow copy keeps the old counts
+        const std::remove_cvref_t< decltype(bset) > shared_bset{bset};
+        const std::vector< bool > shared_ref{ref};
+        bset.resize(ref.size() - 1500);
+        ref.resize(ref.size() - 1500);
+        validate(bset, ref);
+        validate(shared_bset, shared_ref);
+        bset.resize(ref.size() + 800);
+        bset.set_bits(ref.size(), 800);
+        ref.resize(ref.size() + 800, true);
+        validate(bset, ref);
+    }};
+
+    Bitset bset1{10000};
+    test_bitset(bset1);
+    AtomicBitset bset2{10000};
+    test_bitset(bset2);
+    BitsetImpl< Bitword< unsafe_bits< uint32_t > >, false > bset3{10000};
+    test_bitset(bset3);
+#ifdef __SIZEOF_INT128__
+    BitsetImpl< Bitword< unsafe_bits< uint128_t > >, false > bset4{10000};
+    test_bitset(bset4);
+#endif
+
+    Bitset empty_bset{0};
+    ASSERT_EQ(empty_bset.rank(10), 0u);
+    ASSERT_EQ(empty_bset.select(0), Bitset::npos);
+}
+
+TEST_F(BitsetTest, BestFitSearch) {
+    static thread_local std::random_device rd{};
+    static thread_local std::default_random_engine re{rd()};
+
+    // Brute force best fit on the reference for the range [start, end)
+    const auto expected_best_fit{[](const std::vector< bool >& ref, const uint64_t start, const uint64_t end,
+                                    const uint32_t min_needed) {
+        BitBlock best{Bitset::npos, std::numeric_limits< uint32_t >::max()};
+        uint64_t bit{start};
+        while (bit < end) {
+            if (ref[bit]) {
+                ++bit;
+                continue;
+            }
+            const uint64_t run_start{bit};
+            while ((bit < end) && !ref[bit]) {
+                ++bit;
+            }
+            const uint64_t nbits{bit - run_start};
+            if ((nbits >= min_needed) && (nbits < best.nbits)) { best = {run_start, static_cast< uint32_t >(nbits)}; }
+        }
+        return best;
+    }};
+
+    const auto validate{[&expected_best_fit](const auto& bset, const std::vector< bool >& ref) {
+        std::uniform_int_distribution< uint64_t > rand_bit{0, ref.size() - 1};
+        for (size_t i{0}; i < 50; ++i) {
+            const uint32_t min_needed{static_cast< uint32_t >(1 + rand_bit(re) % 100)};
+            const uint64_t start{(i % 2) ? rand_bit(re) : 0};
+            const uint64_t end{(i % 2) ? std::min< uint64_t >(start + rand_bit(re), ref.size()) : ref.size()};
+            const BitBlock exp{expected_best_fit(ref, start, end, min_needed)};
+            const BitBlock blk{(end > start) ? bset.get_best_fit_contiguous_n_reset_bits(start, end - 1, min_needed,
+                                                                                         min_needed + 10)
+                                             : BitBlock{Bitset::npos, 0}};
+            ASSERT_EQ(blk.start_bit, exp.start_bit) << "start=" << start << " end=" << end << " min=" << min_needed;
+            if (exp.start_bit != Bitset::npos) {
+                ASSERT_EQ(blk.nbits, std::min(exp.nbits, min_needed + 10));
+                ASSERT_TRUE(bset.is_bits_reset(blk.start_bit, blk.nbits));
+            }
+        }
+    }};
+
+    const auto test_bitset{[&validate](auto& bset) {
+        std::vector< bool > ref(bset.size(), false);
+        std::uniform_int_distribution< uint64_t > rand_bit{0, bset.size() - 1};
+        std::uniform_int_distribution< uint64_t > rand_nbits{1, 300};
+        const auto write{[&](const uint64_t start, const uint64_t nbits, const bool value) {
+            if (value) {
+                bset.set_bits(start, nbits);
+            } else {
+                bset.reset_bits(start, nbits);
+            }
+            std::fill_n(ref.begin() + start, nbits, value);
+        }};
+
+        for (size_t i{0}; i < 200; ++i) {
+            const uint64_t start{rand_bit(re)};
+            write(start, std::min(rand_nbits(re), bset.size() - start), true);
+        }
+        validate(bset, ref);
+
+        // Mixed allocation and free as done by an allocator, searched after each few of them
+        for (size_t i{0}; i < 100; ++i) {
+            const uint64_t start{rand_bit(re)};
+            write(start, std::min(rand_nbits(re), bset.size() - start), (i % 3) != 0);
+            const BitBlock blk{bset.get_best_fit_contiguous_n_reset_bits(static_cast< uint32_t >(1 + i % 20))};
+            if (blk.start_bit != Bitset::npos) { write(blk.start_bit, blk.nbits, true); }
+            if ((i % 10) == 0) { validate(bset, ref); }
+        }
+        validate(bset, ref);
+
+        // Writes through the shallow copy are seen too
+        auto copy{bset};
+        copy.set_bits(0, 1000);
+        std::fill_n(ref.begin(), 1000, true);
+        validate(bset, ref);
+
+        // Shift and resize rebuild the runs
+        bset.shrink_head(333);
+        ref.erase(ref.begin(), ref.begin() + 333);
+        validate(bset, ref);
+        bset.resize(ref.size() + 1000);
+        ref.resize(ref.size() + 1000, false);
+        validate(bset, ref);
+    }};
+
+    // Searches with and without the free run index
+    Bitset bset1{20000};
+    test_bitset(bset1);
+    Bitset bset1_indexed{20000};
+    bset1_indexed.enable_free_run_index();
+    ASSERT_TRUE(bset1_indexed.is_free_run_index_enabled());
+    test_bitset(bset1_indexed);
+    AtomicBitset bset2{20000};
+    bset2.enable_free_run_index();
+    test_bitset(bset2);
+    BitsetImpl< Bitword< unsafe_bits< uint32_t > >, false > bset3{20000};
+    bset3.enable_free_run_index();
+    test_bitset(bset3);
+#ifdef __SIZEOF_INT128__
+    BitsetImpl< Bitword< unsafe_bits< uint128_t > >, false > bset4{20000};
+    test_bitset(bset4);
+#endif
+
+    // Best fit picks the smallest hole which fits, where first fit picks the first one
+    Bitset bset5{1000};
+    bset5.set_bits(0, 1000);
+    bset5.reset_bits(10, 100);
+    bset5.reset_bits(200, 20);
+    bset5.reset_bits(300, 8);
+    ASSERT_EQ(bset5.get_next_contiguous_n_reset_bits(0, 16).start_bit, 10u);
+    ASSERT_EQ(bset5.get_best_fit_contiguous_n_reset_bits(16).start_bit, 200u);
+    ASSERT_EQ(bset5.get_best_fit_contiguous_n_reset_bits(8).start_bit, 300u);
+    ASSERT_EQ(bset5.get_best_fit_contiguous_n_reset_bits(50).start_bit, 10u);
+    ASSERT_EQ(bset5.get_best_fit_contiguous_n_reset_bits(101).start_bit, Bitset::npos);
+    ASSERT_EQ(bset5.get_best_fit_contiguous_n_reset_bits(250, std::nullopt, 16, 16).start_bit, Bitset::npos);
+
+    // Concurrent writers mark the blocks they modify without any lock and the next search sees all their writes
+    constexpr uint64_t nthreads{4};
+    constexpr uint64_t thread_bits{64 * 1024};
+    AtomicBitset bset6{nthreads * thread_bits};
+    bset6.enable_free_run_index();
+    ASSERT_EQ(bset6.get_best_fit_contiguous_n_reset_bits(16).start_bit, 0u);
+    std::vector< bool > ref6(bset6.size(), false);
+    {
+        std::vector< std::thread > threads;
+        for (uint64_t t{0}; t < nthreads; ++t) {
+            threads.emplace_back([&bset6, &ref6, t]() {
+                std::mt19937_64 thread_re{t};
+                for (size_t i{0}; i < 500; ++i) {
+                    const uint64_t start{t * thread_bits + thread_re() % (thread_bits - 100)};
+                    const uint64_t nbits{1 + thread_re() % 100};
+                    bset6.set_bits(start, nbits);
+                    // Each thread writes only its own part of the reference, which is a multiple of 64 bits
+                    std::fill_n(ref6.begin() + start, nbits, true);
+                }
+            });
+        }
+        for (auto& thr : threads) {
+            thr.join();
+        }
+    }
+    validate(bset6, ref6);
+}
+
+TEST_F(BitsetTest, ParallelScan) {
+    static thread_local std::random_device rd{};
+    static thread_local std::default_random_engine re{rd()};
+
+    const auto test_bitset{[](auto& bset) {
+        std::uniform_int_distribution< uint64_t > rand_bit{0, bset.size() - 1};
+        for (size_t i{0}; i < 2000; ++i) {
+            const uint64_t start{rand_bit(re)};
+            bset.set_bits(start, std::min< uint64_t >(1 + rand_bit(re) % 1000, bset.size() - start));
+        }
+        bset.shrink_head(13);
+
+        for (const uint32_t nthreads : {0u, 1u, 3u, 8u}) {
+            ASSERT_EQ(bset.get_set_count_parallel(0, Bitset::npos, nthreads), bset.get_set_count());
+            ASSERT_EQ(bset.get_set_count_parallel(12345, 3 * Bitset::min_parallel_bits + 7, nthreads),
+                      bset.get_set_count(12345, 3 * Bitset::min_parallel_bits + 7));
+            ASSERT_EQ(bset.to_string_parallel(nthreads), bset.to_string());
+
+            for (size_t i{0}; i < 10; ++i) {
+                const uint64_t start{rand_bit(re) % bset.size()};
+                ASSERT_EQ(bset.get_next_set_bit_parallel(start, nthreads), bset.get_next_set_bit(start));
+                ASSERT_EQ(bset.get_next_reset_bit_parallel(start, nthreads), bset.get_next_reset_bit(start));
+            }
+
+            std::remove_reference_t< decltype(bset) > copy_bset{1};
+            copy_bset.copy_unshifted(bset);
+            ASSERT_TRUE(bset.equals_parallel(copy_bset, nthreads));
+            copy_bset.set_bit(copy_bset.size() - 1);
+            copy_bset.reset_bit(copy_bset.size() - 1);
+            copy_bset.set_bit(copy_bset.size() - 2);
+            ASSERT_EQ(bset.equals_parallel(copy_bset, nthreads), bset == copy_bset);
+
+            // Deep copy keeps the same shift, so that the whole words are compared in bulk
+            std::remove_reference_t< decltype(bset) > aligned_bset{1};
+            aligned_bset.copy(bset);
+            ASSERT_TRUE(bset.equals_parallel(aligned_bset, nthreads));
+            aligned_bset.reset_bit(bset.get_next_set_bit(bset.size() / 2));
+            ASSERT_FALSE(bset.equals_parallel(aligned_bset, nthreads));
+        }
+
+        // Search into the sparse end of the bitset
+        bset.reset_bits(bset.size() - 3 * Bitset::min_parallel_bits, 3 * Bitset::min_parallel_bits);
+        bset.set_bit(bset.size() - 5);
+        ASSERT_EQ(bset.get_next_set_bit_parallel(bset.size() - 3 * Bitset::min_parallel_bits, 4), bset.size() - 5);
+        ASSERT_EQ(bset.get_next_set_bit_parallel(bset.size() - 4, 4), Bitset::npos);
+    }};
+
+    Bitset bset1{5 * Bitset::min_parallel_bits + 1001};
+    test_bitset(bset1);
+    AtomicBitset bset2{4 * Bitset::min_parallel_bits + 77};
+    test_bitset(bset2);
+    BitsetImpl< Bitword< unsafe_bits< uint32_t > >, false > bset3{4 * Bitset::min_parallel_bits + 5};
+    test_bitset(bset3);
+}
+
 TEST_F(BitsetTest, EqualityLogicCheck) {
     // flip random bits
     const auto flip_random_bits{[this](auto& tmp_bitset, const size_t num_bits, const size_t num_flips) {
@@ -912,6 +1477,280 @@ TEST_F(BitsetTest, SerializeDeserializeAtomicBitset) {
     EXPECT_EQ(bset1, bset2);
 }
 
+TEST_F(BitsetTest, SerializeApplyDelta) {
+    const uint64_t nbits{Bitset::default_dirty_page_bits * 10 + 100};
+    AtomicBitset bset{nbits};
+    bset.set_bits(1000, 50000);
+    AtomicBitset checkpoint{};
+    checkpoint.copy(bset);
+
+    // Only the modified pages should be part of delta
+    bset.enable_dirty_tracking();
+    ASSERT_EQ(bset.get_dirty_page_count(), 0u);
+    bset.set_bit(10);
+    bset.reset_bits(Bitset::default_dirty_page_bits * 3 - 5, 10);
+    bset.set_bits(nbits - 3, 3);
+    ASSERT_EQ(bset.get_dirty_page_count(), 4u);
+
+    const auto delta1{bset.serialize_delta()};
+    ASSERT_EQ(bset.get_dirty_page_count(), 0u);
+    ASSERT_LT(static_cast< uint64_t >(delta1->size), bset.serialized_size() / 2);
+    checkpoint.apply_delta(delta1);
+    ASSERT_EQ(checkpoint, bset);
+
+    // Concurrent modifications while taking the delta, should be part of either this or the next delta
+    std::vector< std::thread > threads;
+    for (uint32_t t{0}; t < 4; ++t) {
+        threads.emplace_back([&bset, t, nbits]() {
+            for (uint64_t bit{t}; bit < nbits; bit += 397) {
+                bset.set_bit(bit);
+            }
+        });
+    }
+    const auto delta2{bset.serialize_delta()};
+    for (auto& thr : threads) {
+        thr.join();
+    }
+    const auto delta3{bset.serialize_delta()};
+    checkpoint.apply_delta(delta2);
+    checkpoint.apply_delta(delta3);
+    ASSERT_EQ(checkpoint, bset);
+
+    // Shrink and resize makes the next delta to have the entire bitset
+    bset.shrink_head(3);
+    bset.resize(nbits + Bitset::default_dirty_page_bits * 2, true);
+    bset.reset_bit(nbits + 7);
+    ASSERT_EQ(bset.get_dirty_page_count(), 13u);
+    checkpoint.apply_delta(bset.serialize_delta());
+    ASSERT_EQ(checkpoint, bset);
+    ASSERT_EQ(bset.get_dirty_page_count(), 0u);
+
+    // Delta of the bitset without tracking is the entire bitset
+    Bitset bset2{1000};
+    bset2.set_bits(100, 200);
+    Bitset bset3{};
+    bset3.apply_delta(bset2.serialize_delta());
+    ASSERT_EQ(bset3, bset2);
+    ASSERT_THROW(bset3.apply_delta(bset2.serialize()), std::out_of_range);
+
+    // Corrupted delta is rejected without resizing or modifying any of the bits
+    const auto corrupt_delta{[&bset2](const size_t offset, const uint64_t value) {
+        const auto good{bset2.serialize_delta(0)};
+        auto bad{make_byte_array(good->size)};
+        std::memcpy(bad->bytes, good->bytes, good->size);
+        std::memcpy(bad->bytes + offset, &value, sizeof(value));
+        return bad;
+    }};
+    Bitset bset4{500};
+    bset4.set_bits(10, 20);
+    Bitset bset4_copy{500};
+    bset4_copy.set_bits(10, 20);
+    const size_t nbits_offset{2 * sizeof(uint32_t)};
+    const size_t page_bits_offset{nbits_offset + sizeof(uint64_t)};
+    const size_t npages_offset{page_bits_offset + sizeof(uint64_t)};
+    const size_t first_page_offset{npages_offset + sizeof(uint64_t) + sizeof(uint8_t)};
+    ASSERT_THROW(bset4.apply_delta(corrupt_delta(nbits_offset, ~uint64_t{0} - 63)), std::out_of_range);
+    ASSERT_THROW(bset4.apply_delta(corrupt_delta(page_bits_offset, 100)), std::out_of_range);
+    ASSERT_THROW(bset4.apply_delta(corrupt_delta(npages_offset, 2)), std::out_of_range);
+    ASSERT_THROW(bset4.apply_delta(corrupt_delta(first_page_offset, uint64_t{1} << 60)), std::out_of_range);
+    ASSERT_EQ(bset4.size(), 500u);
+    ASSERT_EQ(bset4, bset4_copy);
+}
+
+TEST_F(BitsetTest, SerializeDeserializeCompressed) {
+    static thread_local std::random_device rd{};
+    static thread_local std::default_random_engine re{rd()};
+
+    // Large bitset with mix of empty, full, few runs and random chunks
+    const uint64_t nbits{65536 * 6 + 1001};
+    Bitset bset{nbits, 100};
+    bset.set_bits(65536, 65536);
+    for (uint64_t bit{65536 * 2}; bit < 65536 * 3; bit += 1000) {
+        bset.set_bits(bit, 10);
+    }
+    std::uniform_int_distribution< uint8_t > rand{0, 1};
+    for (uint64_t bit{65536 * 3}; bit < 65536 * 4; ++bit) {
+        if (rand(re) == 1) { bset.set_bit(bit); }
+    }
+    bset.set_bits(65536 * 5 - 3, 65536 + 10);
+    bset.set_bit(nbits - 1);
+
+    const auto cb{bset.serialize_compressed()};
+    ASSERT_EQ(static_cast< uint64_t >(cb->size), bset.compressed_serialized_size());
+    ASSERT_LT(bset.compressed_serialized_size(), bset.serialized_size() / 3);
+
+    const Bitset bset1{Bitset::compressed, cb};
+    ASSERT_EQ(bset1.get_id(), 100u);
+    ASSERT_EQ(bset1, bset);
+
+    // Load it into a bitset of different word size
+    using Bitset32 = BitsetImpl< Bitword< safe_bits< uint32_t > >, false >;
+    const Bitset32 bset2{Bitset32::compressed, cb};
+    ASSERT_EQ(bset2.size(), nbits);
+    ASSERT_EQ(bset2.get_set_count(), bset.get_set_count());
+    for (uint64_t bit{0}; bit < nbits; bit += 7) {
+        ASSERT_EQ(bset2.get_bitval(bit), bset.get_bitval(bit)) << "bit=" << bit;
+    }
+#ifdef __SIZEOF_INT128__
+    using Bitset128 = BitsetImpl< Bitword< unsafe_bits< uint128_t > >, false >;
+    const Bitset128 bset128{Bitset128::compressed, cb};
+    ASSERT_EQ(bset128.size(), nbits);
+    ASSERT_EQ(bset128.get_set_count(), bset.get_set_count());
+    for (uint64_t bit{0}; bit < nbits; bit += 7) {
+        ASSERT_EQ(bset128.get_bitval(bit), bset.get_bitval(bit)) << "bit=" << bit;
+    }
+    const Bitset bset128_back{Bitset::compressed, bset128.serialize_compressed()};
+    ASSERT_EQ(bset128_back, bset);
+#endif
+
+    // Shifted bitset is serialized unshifted with the alignment padding
+    bset.shrink_head(77);
+    const auto cb2{bset.serialize_compressed(512)};
+    ASSERT_EQ(cb2->size % 512, 0u);
+    const Bitset bset3{Bitset::compressed, cb2};
+    ASSERT_EQ(bset3, bset);
+
+    // Empty bitset and corrupted buffers
+    const Bitset empty_bset{};
+    ASSERT_EQ(Bitset(Bitset::compressed, empty_bset.serialize_compressed()).size(), 0u);
+    ASSERT_THROW(Bitset(Bitset::compressed, bset.serialize()), std::out_of_range);
+    auto truncated{make_byte_array(static_cast< uint32_t >(cb->size / 2))};
+    std::memcpy(truncated->bytes, cb->bytes, truncated->size);
+    ASSERT_THROW(Bitset(Bitset::compressed, truncated), std::out_of_range);
+
+    // Size in the header beyond what the chunks of the buffer can hold is rejected before allocating it
+    auto oversized{make_byte_array(cb->size)};
+    std::memcpy(oversized->bytes, cb->bytes, cb->size);
+    const uint64_t huge_nbits{uint64_t{1} << 40};
+    std::memcpy(oversized->bytes + 2 * sizeof(uint32_t) + sizeof(uint64_t), &huge_nbits, sizeof(huge_nbits));
+    ASSERT_THROW(Bitset(Bitset::compressed, oversized), std::out_of_range);
+}
+
+TEST_F(BitsetTest, FileBackedBitset) {
+    const std::string path{(std::filesystem::temp_directory_path() /
+                            ("test_bitset_mapped_" + std::to_string(::getpid()) + ".bin"))
+                               .string()};
+    std::filesystem::remove(path);
+
+    const uint64_t nbits{100000};
+    {
+        AtomicBitset bset{AtomicBitset::mapped_file, path, nbits, 55};
+        ASSERT_TRUE(bset.is_file_backed());
+        ASSERT_EQ(bset.size(), nbits);
+        ASSERT_EQ(bset.get_set_count(), 0u);
+        bset.set_bits(10, 1000);
+        bset.set_bit(nbits - 1);
+        ASSERT_TRUE(bset.try_claim_bits(5000, 64));
+        bset.flush();
+        bset.advise(AtomicBitset::access_advice::dont_need);
+        ASSERT_EQ(bset.get_set_count(), 1065u);
+    }
+
+    {
+        // Reopen reuses the bits in the file, ignoring the passed in size
+        AtomicBitset bset{AtomicBitset::mapped_file, path, 10};
+        ASSERT_EQ(bset.size(), nbits);
+        ASSERT_EQ(bset.get_id(), 55u);
+        ASSERT_EQ(bset.get_set_count(), 1065u);
+        ASSERT_TRUE(bset.is_bits_set(10, 1000));
+        ASSERT_TRUE(bset.is_bits_set(5000, 64));
+        ASSERT_TRUE(bset.get_bitval(nbits - 1));
+
+        // Shrink head and expand compacts the words into the replacement file
+        bset.shrink_head(200);
+        bset.resize(nbits * 2);
+        ASSERT_TRUE(bset.is_file_backed());
+        ASSERT_EQ(bset.size(), nbits * 2);
+        ASSERT_TRUE(bset.is_bits_set(0, 810));
+        ASSERT_TRUE(bset.is_bits_set(4800, 64));
+        ASSERT_TRUE(bset.get_bitval(nbits - 201));
+        ASSERT_TRUE(bset.is_bits_reset(nbits - 200, nbits + 200));
+        ASSERT_EQ(bset.get_set_count(), 1065u - 190u);
+        bset.set_bits(nbits, nbits);
+        bset.advise(AtomicBitset::access_advice::sequential, 100, 5000);
+        bset.flush(false);
+
+        // Shallow copy shares the file and in memory copy of it is independent
+        AtomicBitset shared_bset{bset};
+        shared_bset.reset_bit(0);
+        ASSERT_FALSE(bset.get_bitval(0));
+        AtomicBitset mem_bset{1};
+        mem_bset.copy(bset);
+        ASSERT_FALSE(mem_bset.is_file_backed());
+        ASSERT_EQ(mem_bset, bset);
+    }
+
+    {
+        // serialize() of the file backed bitset is the file contents
+        Bitset bset{Bitset::mapped_file, path};
+        ASSERT_EQ(bset.size(), nbits * 2);
+        ASSERT_FALSE(bset.get_bitval(0));
+        const Bitset bset1{bset.serialize()};
+        ASSERT_FALSE(bset1.is_file_backed());
+        ASSERT_EQ(bset1, bset);
+
+        // Deep copy into the file backed bitset is written to the file
+        Bitset src{5000};
+        src.set_bits(100, 200);
+        bset.copy(src);
+        ASSERT_TRUE(bset.is_file_backed());
+        ASSERT_EQ(bset, src);
+    }
+
+    {
+        Bitset bset{Bitset::mapped_file, path};
+        ASSERT_EQ(bset.size(), 5000u);
+        ASSERT_EQ(bset.get_set_count(), 200u);
+
+        // Deep copy from a bitset backed by the same file detaches it from the file
+        const Bitset shared_bset{bset};
+        bset.copy(shared_bset);
+        ASSERT_FALSE(bset.is_file_backed());
+        ASSERT_TRUE(shared_bset.is_file_backed());
+        ASSERT_EQ(bset, shared_bset);
+        bset.reset_bit(100);
+        ASSERT_TRUE(shared_bset.get_bitval(100));
+    }
+
+    {
+        // Resize replaces the file, a live shallow copy keeps its old mapping and is detached from the file
+        Bitset bset{Bitset::mapped_file, path};
+        Bitset shared_bset{bset};
+        bset.resize(nbits);
+        ASSERT_TRUE(bset.is_file_backed());
+        ASSERT_FALSE(shared_bset.is_file_backed());
+        ASSERT_FALSE(std::filesystem::exists(path + ".resize"));
+        ASSERT_EQ(bset.size(), nbits);
+        ASSERT_EQ(shared_bset.size(), 5000u);
+        ASSERT_EQ(shared_bset.get_set_count(), 200u);
+        ASSERT_TRUE(shared_bset.is_bits_set(100, 200));
+        shared_bset.set_bit(4999);
+        ASSERT_FALSE(bset.get_bitval(4999));
+
+        // Resize of the detached shallow copy is held in memory and leaves the file alone
+        shared_bset.resize(2 * nbits);
+        ASSERT_FALSE(shared_bset.is_file_backed());
+        ASSERT_EQ(shared_bset.size(), 2 * nbits);
+        ASSERT_TRUE(shared_bset.get_bitval(4999));
+        bset.set_bit(nbits - 1);
+    }
+
+    {
+        Bitset bset{Bitset::mapped_file, path};
+        ASSERT_EQ(bset.size(), nbits);
+        ASSERT_EQ(bset.get_set_count(), 201u);
+        ASSERT_TRUE(bset.is_bits_set(100, 200));
+        ASSERT_TRUE(bset.get_bitval(nbits - 1));
+    }
+
+    {
+        // File of a different word size is rejected
+        using Bitset32 = BitsetImpl< Bitword< unsafe_bits< uint32_t > >, false >;
+        ASSERT_THROW((Bitset32{Bitset32::mapped_file, path}), std::out_of_range);
+    }
+    std::filesystem::remove(path);
+}
+
 SISL_OPTIONS_ENABLE(logging, test_bitset)
 
 SISL_OPTION_GROUP(test_bitset,
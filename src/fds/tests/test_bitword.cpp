@@ -14,11 +14,14 @@
  * specific language governing permissions and limitations under the License.
  *
  *********************************************************************************/
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <iostream>
 #include <limits>
+#include <random>
 #include <type_traits>
+#include <vector>
 
 #include <sisl/logging/logging.h>
 #include <sisl/options/options.h>
@@ -72,13 +75,74 @@ protected:
 
 template < typename DataType >
 void testLog2Base() {
-    static_assert(std::is_unsigned_v< DataType >, "DataType must be unsigned.");
+    static_assert(is_unsigned_word_v< DataType >, "DataType must be unsigned.");
     ASSERT_EQ(logBase2(static_cast< DataType >(0)), static_cast< uint8_t >(255));
     DataType v{1};
-    for (uint8_t bit{0}; bit < std::numeric_limits< DataType >::digits; ++bit, v <<= 1) {
+    for (uint8_t bit{0}; bit < sizeof(DataType) * 8; ++bit, v <<= 1) {
         ASSERT_EQ(logBase2(v), bit);
     }
 }
+
+template < typename DataType >
+DataType random_word(std::mt19937_64& re) {
+    if constexpr (sizeof(DataType) > sizeof(uint64_t)) {
+        return (static_cast< DataType >(re()) << 64) | static_cast< DataType >(re());
+    } else {
+        return static_cast< DataType >(re());
+    }
+}
+
+// Compare the bitword operations against bit by bit evaluation on random words
+template < typename DataType >
+void testWordOps() {
+    constexpr uint8_t nbits{static_cast< uint8_t >(sizeof(DataType) * 8)};
+    std::mt19937_64 re{static_cast< uint64_t >(nbits)};
+    for (uint32_t iter{0}; iter < 1000; ++iter) {
+        // Sparse values, so that there are runs of reset bits to search for
+        DataType val{random_word< DataType >(re)};
+        if (iter % 2) { val &= random_word< DataType >(re) & random_word< DataType >(re); }
+        Bitword< unsafe_bits< DataType > > word{val};
+
+        uint8_t exp_set_count{0};
+        for (uint8_t bit{0}; bit < nbits; ++bit) {
+            const bool bitval{((val >> bit) & 1) == 1};
+            ASSERT_EQ(word.get_bitval(bit), bitval);
+            if (bitval) { ++exp_set_count; }
+        }
+        ASSERT_EQ(word.get_set_count(), exp_set_count);
+        ASSERT_EQ(get_set_bit_count(val), exp_set_count);
+
+        const uint8_t start{static_cast< uint8_t >(re() % nbits)};
+        uint8_t exp_next_set{nbits};
+        for (uint8_t bit{start}; bit < nbits; ++bit) {
+            if ((val >> bit) & 1) {
+                exp_next_set = bit;
+                break;
+            }
+        }
+        uint8_t next_set{0};
+        ASSERT_EQ(word.get_next_set_bit(start, &next_set), exp_next_set < nbits);
+        if (exp_next_set < nbits) { ASSERT_EQ(next_set, exp_next_set); }
+
+        uint8_t exp_max_run{0};
+        uint8_t cur_run{0};
+        for (uint8_t bit{0}; bit < nbits; ++bit) {
+            cur_run = ((val >> bit) & 1) ? 0 : static_cast< uint8_t >(cur_run + 1);
+            exp_max_run = std::max(exp_max_run, cur_run);
+        }
+        uint8_t max_run{0};
+        word.get_max_contiguous_reset_bits(0, &max_run);
+        ASSERT_EQ(max_run, exp_max_run);
+
+        const uint8_t count{static_cast< uint8_t >(1 + re() % (nbits - start))};
+        word.set_bits(start, count);
+        ASSERT_TRUE(word.is_bits_set_reset(start, count, true));
+        word.reset_bits(start, count);
+        ASSERT_TRUE(word.is_bits_set_reset(start, count, false));
+        const DataType mask{static_cast< DataType >(word_consecutive_bitmask< DataType >(count) << start)};
+        ASSERT_EQ(word.to_integer(), static_cast< DataType >(val & ~mask));
+    }
+}
 } // namespace
 
 TEST_F(BitwordTest, TestLog2Base) {
@@ -92,6 +156,9 @@ TEST_F(BitwordTest, TestLog2Base) {
     testLog2Base< uint16_t >();
     testLog2Base< uint32_t >();
     testLog2Base< uint64_t >();
+#ifdef __SIZEOF_INT128__
+    testLog2Base< uint128_t >();
+#endif
 }
 
 TEST_F(BitwordTest, TestSetCount) {
@@ -358,6 +425,46 @@ TEST_F(BitwordTest, GetMaxContiguousResetBits) {
     ASSERT_EQ(pmax_count, static_cast< uint8_t >(12));
 }
 
+TEST_F(BitwordTest, WordOpsAllWidths) {
+    testWordOps< uint8_t >();
+    testWordOps< uint16_t >();
+    testWordOps< uint32_t >();
+    testWordOps< uint64_t >();
+#ifdef __SIZEOF_INT128__
+    testWordOps< uint128_t >();
+#endif
+}
+
+#ifdef __SIZEOF_INT128__
+TEST_F(BitwordTest, Wide128BitWord) {
+    const uint128_t high_bit{static_cast< uint128_t >(1) << 127};
+    ASSERT_EQ(get_trailing_zeros(high_bit), static_cast< uint8_t >(127));
+    ASSERT_EQ(get_leading_zeros(high_bit), static_cast< uint8_t >(0));
+    ASSERT_EQ(get_trailing_zeros(static_cast< uint128_t >(0)), static_cast< uint8_t >(128));
+    ASSERT_EQ(get_leading_zeros(static_cast< uint128_t >(1)), static_cast< uint8_t >(127));
+
+    Bitword< unsafe_bits< uint128_t > > word{0};
+    ASSERT_EQ(Bitword< unsafe_bits< uint128_t > >::bits(), 128);
+    word.set_bits(60, 10);
+    ASSERT_EQ(word.to_integer(), word_consecutive_bitmask< uint128_t >(10) << 60);
+    ASSERT_EQ(word.get_set_count(), 10);
+
+    uint8_t nbit{0};
+    ASSERT_TRUE(word.get_next_set_bit(0, &nbit));
+    ASSERT_EQ(nbit, 60);
+    ASSERT_TRUE(word.get_next_reset_bit(60, &nbit));
+    ASSERT_EQ(nbit, 70);
+
+    uint8_t max_count{0};
+    ASSERT_EQ(word.get_max_contiguous_reset_bits(0, &max_count), 0);
+    ASSERT_EQ(max_count, 60);
+
+    word.set_bits(0, 128);
+    ASSERT_EQ(word.to_integer(), static_cast< uint128_t >(~uint128_t{0}));
+    ASSERT_FALSE(word.get_next_reset_bit(0, &nbit));
+}
+#endif
+
 int main(int argc, char* argv[]) {
     SISL_OPTIONS_LOAD(argc, argv, logging)
     ::testing::InitGoogleTest(&argc, argv);
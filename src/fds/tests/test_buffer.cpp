@@ -0,0 +1,492 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <semaphore>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <sisl/logging/logging.h>
+#include <sisl/options/options.h>
+#include <gtest/gtest.h>
+
+#include "sisl/fds/buffer.hpp"
+
+using namespace sisl;
+
+SISL_LOGGING_INIT(test_buffer)
+SISL_OPTIONS_ENABLE(logging, test_buffer)
+SISL_OPTION_GROUP(test_buffer,
+                  (num_threads, "", "num_threads", "number of threads",
+                   ::cxxopts::value< uint32_t >()->default_value("8"), "number"),
+                  (num_iters, "", "num_iters", "number of allocations per thread",
+                   ::cxxopts::value< uint32_t >()->default_value("20000"), "number"))
+
+namespace {
+uint32_t g_num_threads;
+uint32_t g_num_iters;
+
+bool is_aligned(const uint8_t* const buf, const size_t align) {
+    return (reinterpret_cast< uintptr_t >(buf) % align) == 0;
+}
+} // namespace
+
+TEST(PooledAlignedAllocator, SizeClasses) {
+    PooledAlignedAllocatorImpl pool;
+    EXPECT_EQ(pool.size_class_of(4096), 0u);
+    EXPECT_EQ(pool.size_class_of(2049), 0u);
+    EXPECT_EQ(pool.size_class_of(5000), 1u);
+    EXPECT_EQ(pool.size_class_of(1024 * 1024), 3u);
+
+    // Too small for the class which fits it or larger than the largest class
+    EXPECT_EQ(pool.size_class_of(100), PooledAlignedAllocatorImpl::npos);
+    EXPECT_EQ(pool.size_class_of(9000), PooledAlignedAllocatorImpl::npos);
+    EXPECT_EQ(pool.size_class_of(1024 * 1024 + 1), PooledAlignedAllocatorImpl::npos);
+}
+
+TEST(PooledAlignedAllocator, ReusesFreedBuffers) {
+    PooledAlignedAllocatorImpl pool;
+    uint8_t* const buf1{pool.aligned_pool_alloc(512, 4096, buftag::common)};
+    ASSERT_TRUE(is_aligned(buf1, 4096));
+    EXPECT_GE(pool.buf_size(buf1), 4096u);
+    std::memset(buf1, 0xab, 4096);
+    pool.aligned_pool_free(buf1, 4096, buftag::common);
+
+    // Same class, so it is served by the buffer freed before
+    uint8_t* const buf2{pool.aligned_pool_alloc(4096, 3000, buftag::common)};
+    EXPECT_EQ(buf2, buf1);
+
+    // Different class and the sizes which are not pooled
+    uint8_t* const buf3{pool.aligned_pool_alloc(512, 8192, buftag::common)};
+    EXPECT_NE(buf3, buf1);
+    EXPECT_GE(pool.buf_size(buf3), 8192u);
+    uint8_t* const buf4{pool.aligned_pool_alloc(512, 100, buftag::common)};
+    EXPECT_TRUE(is_aligned(buf4, 512));
+    uint8_t* const buf5{pool.aligned_pool_alloc(8192, 4096, buftag::common)};
+    EXPECT_TRUE(is_aligned(buf5, 8192));
+
+    pool.aligned_pool_free(buf2, 3000, buftag::common);
+    pool.aligned_pool_free(buf3, 8192, buftag::common);
+    pool.aligned_pool_free(buf4, 100, buftag::common);
+    pool.aligned_pool_free(buf5, 4096, buftag::common);
+
+    // Regular free of a pooled buffer and pool free of a buffer which was not allocated by it
+    uint8_t* const buf6{pool.aligned_pool_alloc(512, 4096, buftag::common)};
+    pool.aligned_free(buf6, buftag::common);
+    uint8_t* const buf7{pool.aligned_alloc(512, 2560, buftag::common)};
+    pool.aligned_pool_free(buf7, 4096, buftag::common);
+}
+
+TEST(PooledAlignedAllocator, ConcurrentAllocFree) {
+    static constexpr std::array< size_t, 4 > sizes{4096, 8192, 64 * 1024, 1024 * 1024};
+    PooledAlignedAllocatorImpl pool;
+
+    std::vector< std::thread > threads;
+    for (uint32_t t{0}; t < g_num_threads; ++t) {
+        threads.emplace_back([&pool, t]() {
+            std::mt19937 re{t};
+            std::vector< std::pair< uint8_t*, size_t > > bufs;
+            for (uint32_t i{0}; i < g_num_iters; ++i) {
+                if (bufs.empty() || ((bufs.size() < 32) && ((re() % 2) == 0))) {
+                    const size_t sz{sizes[re() % sizes.size()]};
+                    uint8_t* const buf{pool.aligned_pool_alloc(512, sz, buftag::common)};
+                    ASSERT_TRUE(is_aligned(buf, 4096));
+                    std::memset(buf, static_cast< int >(t), sz);
+                    bufs.emplace_back(buf, sz);
+                } else {
+                    const size_t idx{re() % bufs.size()};
+                    const auto [buf, sz] = bufs[idx];
+
+                    // Nobody else wrote to the buffer while this thread had it
+                    ASSERT_EQ(buf[0], static_cast< uint8_t >(t));
+                    ASSERT_EQ(buf[sz - 1], static_cast< uint8_t >(t));
+                    pool.aligned_pool_free(buf, sz, buftag::common);
+                    bufs[idx] = bufs.back();
+                    bufs.pop_back();
+                }
+            }
+            for (const auto& [buf, sz] : bufs) {
+                pool.aligned_pool_free(buf, sz, buftag::common);
+            }
+        });
+    }
+    for (auto& thr : threads) {
+        thr.join();
+    }
+
+    // Caches of the exited threads are moved to the depot and served to the other threads
+    const size_t depot_count{pool.depot_count()};
+    EXPECT_GT(depot_count, 0u);
+    std::thread{[&pool]() {
+        uint8_t* const buf{pool.aligned_pool_alloc(4096, 4096, buftag::common)};
+        pool.aligned_pool_free(buf, 4096, buftag::common);
+    }}.join();
+    EXPECT_EQ(pool.depot_count(), depot_count);
+
+    pool.release_cached();
+    EXPECT_EQ(pool.depot_count(), 0u);
+}
+
+TEST(PooledAlignedAllocator, DestroyedWithCachedBuffers) {
+    std::unique_ptr< PooledAlignedAllocatorImpl > pool{new PooledAlignedAllocatorImpl{{4096}}};
+    std::binary_semaphore pool_ready{0};
+    std::binary_semaphore worker_done{0};
+
+    // The worker outlives the first allocator with a buffer in its cache
+    std::thread worker{[&pool, &pool_ready, &worker_done]() {
+        for (const size_t sz : {4096, 8192}) {
+            pool_ready.acquire();
+            uint8_t* const buf{pool->aligned_pool_alloc(4096, sz, buftag::common)};
+            EXPECT_GE(pool->buf_size(buf), sz);
+            pool->aligned_pool_free(buf, sz, buftag::common);
+            worker_done.release();
+        }
+    }};
+    pool_ready.release();
+    worker_done.acquire();
+
+    // The next allocator reuses the id of the destroyed one, but none of the cached buffers of the destroyed one
+    pool.reset();
+    pool.reset(new PooledAlignedAllocatorImpl{{8192}});
+    pool_ready.release();
+    worker_done.acquire();
+    worker.join();
+    pool.reset();
+}
+
+TEST(PooledAlignedAllocator, IoBlob) {
+    AlignedAllocator::instance().set_allocator(new PooledAlignedAllocatorImpl{});
+    io_blob blob1{4096, 512, buftag::logwrite};
+    blob1.buf_free(buftag::logwrite);
+    io_blob blob2{4096, 4096, buftag::logwrite};
+    EXPECT_EQ(blob2.bytes, blob1.bytes);
+
+    {
+        auto arr{make_byte_array(64 * 1024, 512)};
+        EXPECT_TRUE(is_aligned(arr->bytes, 4096));
+    }
+    blob2.buf_free(buftag::logwrite);
+
+    // Unaligned blob moves to an aligned buffer on realloc, which is charged to the tag of the blob
+    io_blob blob3{100, 0, buftag::logwrite};
+    std::memset(blob3.bytes, 0xcd, 100);
+    blob3.buf_realloc(8192, 512, buftag::logwrite);
+    EXPECT_TRUE(blob3.aligned);
+    EXPECT_TRUE(is_aligned(blob3.bytes, 512));
+    EXPECT_EQ(blob3.bytes[99], 0xcd);
+    blob3.buf_realloc(16384, 512, buftag::logwrite);
+    EXPECT_EQ(blob3.bytes[99], 0xcd);
+    blob3.buf_free(buftag::logwrite);
+    AlignedAllocator::instance().set_allocator(new AlignedAllocatorImpl{});
+}
+
+TEST(HugePageArenaAllocator, AllocFree) {
+    static constexpr uint64_t region_size{HugePageArenaAllocatorImpl::hugepage_size};
+    HugePageArenaAllocatorImpl arena{region_size, 2};
+    const auto regions{arena.registered_regions()};
+    ASSERT_EQ(regions.size(), 2u);
+    for (const auto& iov : regions) {
+        EXPECT_TRUE(is_aligned(static_cast< uint8_t* >(iov.iov_base), HugePageArenaAllocatorImpl::hugepage_size));
+        EXPECT_EQ(iov.iov_len, region_size);
+    }
+
+    uint8_t* const buf1{arena.aligned_alloc(512, 4096, buftag::logwrite)};
+    const auto idx1{arena.buffer_index(buf1)};
+    ASSERT_NE(idx1, HugePageArenaAllocatorImpl::npos);
+    EXPECT_GE(buf1, static_cast< uint8_t* >(regions[idx1].iov_base));
+    EXPECT_LT(buf1, static_cast< uint8_t* >(regions[idx1].iov_base) + region_size);
+    EXPECT_TRUE(is_aligned(buf1, 4096));
+    EXPECT_EQ(arena.buf_size(buf1), 4096u);
+    std::memset(buf1, 0xab, 4096);
+
+    // Rounded up to the chunks
+    uint8_t* const buf2{arena.aligned_alloc(4096, 10000, buftag::metablk)};
+    EXPECT_NE(arena.buffer_index(buf2), HugePageArenaAllocatorImpl::npos);
+    EXPECT_EQ(arena.buf_size(buf2), 3 * 4096u);
+    EXPECT_EQ(arena.arena_bytes(buftag::logwrite), 4096u);
+    EXPECT_EQ(arena.arena_bytes(buftag::metablk), 3 * 4096u);
+
+    // Larger alignment than the chunk and larger than the region are from the heap
+    uint8_t* const buf3{arena.aligned_alloc(8192, 4096, buftag::common)};
+    EXPECT_EQ(arena.buffer_index(buf3), HugePageArenaAllocatorImpl::npos);
+    EXPECT_TRUE(is_aligned(buf3, 8192));
+    uint8_t* const buf4{arena.aligned_alloc(512, region_size + 4096, buftag::common)};
+    EXPECT_EQ(arena.buffer_index(buf4), HugePageArenaAllocatorImpl::npos);
+    EXPECT_EQ(arena.heap_fallback_count(), 2u);
+
+    // Realloc keeps the data and the tag the buffer was allocated with
+    uint8_t* const buf5{arena.aligned_realloc(buf1, 512, 64 * 1024, 0, buftag::common)};
+    EXPECT_NE(arena.buffer_index(buf5), HugePageArenaAllocatorImpl::npos);
+    EXPECT_EQ(arena.buf_size(buf5), 64 * 1024u);
+    EXPECT_EQ(buf5[0], 0xab);
+    EXPECT_EQ(buf5[4095], 0xab);
+    EXPECT_EQ(arena.arena_bytes(buftag::logwrite), 64 * 1024u);
+    EXPECT_EQ(arena.arena_bytes(buftag::common), 0u);
+
+    arena.aligned_free(buf2, buftag::metablk);
+    arena.aligned_free(buf3, buftag::common);
+    arena.aligned_free(buf4, buftag::common);
+    arena.aligned_free(buf5, buftag::common);
+    EXPECT_EQ(arena.arena_bytes(buftag::metablk), 0u);
+    EXPECT_EQ(arena.arena_bytes(buftag::logwrite), 0u);
+    EXPECT_EQ(arena.arena_bytes(buftag::common), 0u);
+}
+
+TEST(HugePageArenaAllocator, FullArena) {
+    static constexpr uint64_t region_size{HugePageArenaAllocatorImpl::hugepage_size};
+    HugePageArenaAllocatorImpl arena{region_size, 2};
+
+    // Buffers don't span the regions, so each region fits only one 1.5M buffer
+    std::vector< uint8_t* > bufs;
+    std::set< uint32_t > indices;
+    for (uint32_t i{0}; i < 2; ++i) {
+        bufs.push_back(arena.aligned_alloc(4096, 1536 * 1024, buftag::common));
+        indices.insert(arena.buffer_index(bufs.back()));
+    }
+    EXPECT_EQ(indices, (std::set< uint32_t >{0, 1}));
+
+    uint8_t* const heap_buf{arena.aligned_alloc(4096, 1536 * 1024, buftag::common)};
+    EXPECT_EQ(arena.buffer_index(heap_buf), HugePageArenaAllocatorImpl::npos);
+    arena.aligned_free(heap_buf, buftag::common);
+
+    // Freed space is reused
+    arena.aligned_free(bufs[0], buftag::common);
+    uint8_t* const buf{arena.aligned_alloc(4096, 1536 * 1024, buftag::common)};
+    EXPECT_EQ(buf, bufs[0]);
+    arena.aligned_free(buf, buftag::common);
+    arena.aligned_free(bufs[1], buftag::common);
+}
+
+TEST(HugePageArenaAllocator, ConcurrentAllocFree) {
+    HugePageArenaAllocatorImpl arena{HugePageArenaAllocatorImpl::hugepage_size * 4, 4};
+
+    std::vector< std::thread > threads;
+    for (uint32_t t{0}; t < g_num_threads; ++t) {
+        threads.emplace_back([&arena, t]() {
+            std::mt19937 re{t};
+            std::vector< std::pair< uint8_t*, size_t > > bufs;
+            for (uint32_t i{0}; i < g_num_iters; ++i) {
+                if (bufs.empty() || ((bufs.size() < 32) && ((re() % 2) == 0))) {
+                    const size_t sz{512 * (1 + re() % 256)};
+                    uint8_t* const buf{arena.aligned_alloc(512, sz, buftag::common)};
+                    std::memset(buf, static_cast< int >(t), sz);
+                    bufs.emplace_back(buf, sz);
+                } else {
+                    const size_t idx{re() % bufs.size()};
+                    const auto [buf, sz] = bufs[idx];
+                    ASSERT_EQ(buf[0], static_cast< uint8_t >(t));
+                    ASSERT_EQ(buf[sz - 1], static_cast< uint8_t >(t));
+                    arena.aligned_free(buf, buftag::common);
+                    bufs[idx] = bufs.back();
+                    bufs.pop_back();
+                }
+            }
+            for (const auto& [buf, sz] : bufs) {
+                arena.aligned_free(buf, buftag::common);
+            }
+        });
+    }
+    for (auto& thr : threads) {
+        thr.join();
+    }
+    EXPECT_EQ(arena.arena_bytes(buftag::common), 0u);
+}
+
+TEST(HugePageArenaAllocator, IoBlob) {
+    auto* const arena{new HugePageArenaAllocatorImpl{HugePageArenaAllocatorImpl::hugepage_size, 1}};
+    AlignedAllocator::instance().set_allocator(arena);
+    {
+        io_blob blob{8192, 512, buftag::data_journal};
+        EXPECT_EQ(arena->buffer_index(blob.bytes), 0u);
+        EXPECT_EQ(arena->arena_bytes(buftag::data_journal), 8192u);
+        blob.buf_free(buftag::data_journal);
+
+        auto arr{make_byte_array(4096, 512, buftag::btree_node)};
+        EXPECT_EQ(arena->buffer_index(arr->bytes), 0u);
+    }
+    EXPECT_EQ(arena->arena_bytes(buftag::btree_node), 0u);
+    AlignedAllocator::instance().set_allocator(new AlignedAllocatorImpl{});
+}
+
+namespace {
+byte_view make_view(const std::string& str) {
+    byte_view v{uint32_cast(str.size())};
+    std::memcpy(v.bytes(), str.data(), str.size());
+    return v;
+}
+} // namespace
+
+TEST(ByteViewChain, AppendTrimSplit) {
+    byte_view_chain chain{make_view("hello ")};
+    chain.append(make_view("rope "));
+    chain.append(byte_view{});
+    chain.append(make_view("world"));
+    EXPECT_EQ(chain.nsegments(), 3u);
+    EXPECT_EQ(chain.size(), 16u);
+    EXPECT_EQ(chain.get_string(), "hello rope world");
+
+    chain.trim_front(2);
+    chain.trim_back(1);
+    EXPECT_EQ(chain.get_string(), "llo rope worl");
+    chain.trim_front(4);
+    EXPECT_EQ(chain.nsegments(), 2u);
+    EXPECT_EQ(chain.get_string(), "rope worl");
+
+    // Split in the middle of the segment shares the segment's buffer with both
+    auto head{chain.clone()};
+    auto tail{head.split_at(2)};
+    EXPECT_EQ(head.get_string(), "ro");
+    EXPECT_EQ(tail.get_string(), "pe worl");
+    EXPECT_EQ(tail.segment(0).bytes(), chain.segment(0).bytes() + 2);
+
+    // and at the segment boundary
+    auto tail2{chain.split_at(5)};
+    EXPECT_EQ(chain.nsegments(), 1u);
+    EXPECT_EQ(chain.get_string(), "rope ");
+    EXPECT_EQ(tail2.get_string(), "worl");
+    EXPECT_TRUE(chain.split_at(5).empty());
+
+    chain.prepend(make_view("a "));
+    chain.append(tail2);
+    EXPECT_EQ(chain.get_string(), "a rope worl");
+
+    // Appended to itself, even when it has to grow the segments
+    chain.append(chain);
+    EXPECT_EQ(chain.nsegments(), 6u);
+    EXPECT_EQ(chain.get_string(), "a rope worla rope worl");
+    chain.trim_back(chain.size());
+    EXPECT_TRUE(chain.empty());
+    EXPECT_EQ(chain.nsegments(), 0u);
+}
+
+TEST(ByteViewChain, CoalesceAndCopyOnWrite) {
+    const auto single{make_view("single")};
+    byte_view_chain chain{single};
+
+    // Single segment is not copied
+    EXPECT_EQ(chain.coalesce().bytes(), single.bytes());
+    EXPECT_EQ(chain.extract()->bytes, single.bytes());
+
+    chain.append(make_view(" and more"));
+    const auto coalesced{chain.coalesce(512)};
+    EXPECT_EQ(coalesced.get_string(), "single and more");
+    EXPECT_EQ(chain.nsegments(), 2u);
+
+    const auto sgl{chain.to_sg_list()};
+    EXPECT_EQ(sgl.size, chain.size());
+    EXPECT_EQ(sgl.iovs[0].iov_base, single.bytes());
+
+    // Writing to the shared segment copies it first
+    auto cloned{chain.clone()};
+    auto wblob{cloned.writable_segment(0)};
+    EXPECT_NE(wblob.bytes, single.bytes());
+    wblob.bytes[0] = 'S';
+    EXPECT_EQ(cloned.get_string(), "Single and more");
+    EXPECT_EQ(chain.get_string(), "single and more");
+
+    // Not shared any more, so modified in place
+    EXPECT_EQ(cloned.writable_segment(0).bytes, wblob.bytes);
+
+    chain.coalesce_in_place();
+    EXPECT_EQ(chain.nsegments(), 1u);
+    EXPECT_EQ(chain.get_string(), "single and more");
+}
+
+TEST(AlignedAllocatorMetrics, BuftagAccounting) {
+    auto& metrics{AlignedAllocator::metrics()};
+    AlignedAllocatorImpl allocator;
+    const auto live_before{metrics.live_bytes(buftag::compression)};
+    const auto count_before{metrics.alloc_count(buftag::compression)};
+
+    std::vector< uint8_t* > bufs;
+    for (uint32_t i{0}; i < 3; ++i) {
+        bufs.push_back(allocator.aligned_alloc(512, 4096, buftag::compression));
+    }
+    const auto live{metrics.live_bytes(buftag::compression)};
+    EXPECT_GE(live - live_before, 3 * 4096);
+    EXPECT_EQ(metrics.alloc_count(buftag::compression), count_before + 3);
+    EXPECT_GE(metrics.high_watermark(buftag::compression), live);
+
+    for (auto* const buf : bufs) {
+        allocator.aligned_free(buf, buftag::compression);
+    }
+    EXPECT_EQ(metrics.live_bytes(buftag::compression), live_before);
+    EXPECT_GE(metrics.high_watermark(buftag::compression), live);
+    metrics.reset_high_watermarks();
+    EXPECT_EQ(metrics.high_watermark(buftag::compression), live_before);
+}
+
+TEST(AlignedAllocatorMetrics, SampledLongLivedBuffers) {
+    auto& metrics{AlignedAllocator::metrics()};
+    AlignedAllocatorImpl allocator;
+    metrics.enable_sampling(1, std::chrono::milliseconds{0});
+
+    std::vector< uint8_t* > bufs;
+    for (uint32_t i{0}; i < 4; ++i) {
+        bufs.push_back(allocator.aligned_alloc(512, 8192, buftag::btree_journal));
+    }
+    EXPECT_EQ(metrics.sampled_count(), 4u);
+    EXPECT_EQ(metrics.sampled_stack_count(), 1u);
+    allocator.aligned_free(bufs.back(), buftag::btree_journal);
+    bufs.pop_back();
+    EXPECT_EQ(metrics.sampled_count(), 3u);
+
+    // All of them were allocated from the same stack
+    const auto j = metrics.dump_json();
+    EXPECT_EQ(j["sampling"]["one_in"], 1);
+    EXPECT_EQ(j["buftags"]["btree_journal"]["live_bytes"], metrics.live_bytes(buftag::btree_journal));
+    ASSERT_EQ(j["long_lived"].size(), 1u);
+    EXPECT_EQ(j["long_lived"][0]["buftag"], "btree_journal");
+    EXPECT_EQ(j["long_lived"][0]["count"], 3);
+    EXPECT_GE(j["long_lived"][0]["bytes"], 3 * 8192);
+    EXPECT_FALSE(j["long_lived"][0]["stack"].empty());
+
+    // Only 1 in 2 are sampled and the young ones are not reported
+    metrics.disable_sampling();
+    EXPECT_EQ(metrics.sampled_count(), 0u);
+    EXPECT_EQ(metrics.sampled_stack_count(), 0u);
+    metrics.enable_sampling(2, std::chrono::hours{1});
+    for (uint32_t i{0}; i < 4; ++i) {
+        bufs.push_back(allocator.aligned_alloc(512, 8192, buftag::btree_journal));
+    }
+    EXPECT_EQ(metrics.sampled_count(), 2u);
+    EXPECT_TRUE(metrics.dump_json()["long_lived"].empty());
+
+    for (auto* const buf : bufs) {
+        allocator.aligned_free(buf, buftag::btree_journal);
+    }
+    // Stacks are dropped with their last sample
+    EXPECT_EQ(metrics.sampled_count(), 0u);
+    EXPECT_EQ(metrics.sampled_stack_count(), 0u);
+    metrics.disable_sampling();
+}
+
+int main(int argc, char* argv[]) {
+    int parsed_argc{argc};
+    ::testing::InitGoogleTest(&parsed_argc, argv);
+    SISL_OPTIONS_LOAD(parsed_argc, argv, logging, test_buffer);
+    sisl::logging::SetLogger("test_buffer");
+    spdlog::set_pattern("[%D %T%z] [%^%l%$] [%n] [%t] %v");
+
+    g_num_threads = SISL_OPTIONS["num_threads"].as< uint32_t >();
+    g_num_iters = SISL_OPTIONS["num_iters"].as< uint32_t >();
+
+    const auto ret{RUN_ALL_TESTS()};
+    return ret;
+}
@@ -0,0 +1,175 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <sisl/logging/logging.h>
+#include <sisl/options/options.h>
+
+#include <gtest/gtest.h>
+
+#include "sisl/fds/fixed_bitset.hpp"
+
+using namespace sisl;
+
+SISL_LOGGING_INIT(test_fixed_bitset)
+SISL_OPTIONS_ENABLE(logging)
+
+namespace {
+constexpr FixedBitset< 200 > make_slot_map() {
+    FixedBitset< 200 > bset;
+    bset.set_bits(0, 10);
+    bset.set_bits(60, 10);
+    bset.set_bit(199);
+    return bset;
+}
+
+// Built and searched entirely at compile time
+constexpr auto s_slot_map{make_slot_map()};
+static_assert(s_slot_map.get_set_count() == 21);
+static_assert(s_slot_map.get_next_reset_bit(0) == 10);
+static_assert(s_slot_map.get_next_set_bit(10) == 60);
+static_assert(s_slot_map.get_next_contiguous_n_reset_bits(0, 50).start_bit == 10);
+static_assert(s_slot_map.get_next_contiguous_n_reset_bits(0, 51).start_bit == 70);
+static_assert(s_slot_map.get_max_contiguous_reset_bits().start_bit == 70);
+static_assert(s_slot_map.get_max_contiguous_reset_bits().nbits == 129);
+static_assert(sizeof(FixedBitset< 64 >) == sizeof(uint64_t));
+
+template < typename BitsetT >
+void validate(const BitsetT& bset, const std::vector< bool >& ref, std::default_random_engine& re) {
+    const uint64_t nbits{ref.size()};
+    ASSERT_EQ(bset.get_set_count(), static_cast< uint64_t >(std::count(ref.cbegin(), ref.cend(), true)));
+    for (uint64_t bit{0}; bit < nbits; ++bit) {
+        ASSERT_EQ(bset.get_bitval(bit), ref[bit]) << "bit=" << bit;
+
+        const auto set_itr{std::find(ref.cbegin() + bit, ref.cend(), true)};
+        ASSERT_EQ(bset.get_next_set_bit(bit),
+                  (set_itr == ref.cend()) ? BitsetT::npos : static_cast< uint64_t >(set_itr - ref.cbegin()));
+        const auto reset_itr{std::find(ref.cbegin() + bit, ref.cend(), false)};
+        ASSERT_EQ(bset.get_next_reset_bit(bit),
+                  (reset_itr == ref.cend()) ? BitsetT::npos : static_cast< uint64_t >(reset_itr - ref.cbegin()));
+    }
+
+    std::uniform_int_distribution< uint64_t > rand_bit{0, nbits - 1};
+    for (size_t i{0}; i < 100; ++i) {
+        const uint64_t start{rand_bit(re)};
+        const uint64_t end{std::max(start, rand_bit(re))};
+        const uint32_t n{static_cast< uint32_t >(1 + rand_bit(re) % 80)};
+
+        // First run of at least n and the max run in [start, end]
+        uint64_t exp_start{BitsetT::npos};
+        uint64_t max_start{BitsetT::npos};
+        uint32_t max_nbits{0};
+        uint64_t bit{start};
+        while (bit <= end) {
+            if (ref[bit]) {
+                ++bit;
+                continue;
+            }
+            uint64_t run_end{bit};
+            while ((run_end <= end) && !ref[run_end]) {
+                ++run_end;
+            }
+            const uint32_t run_nbits{static_cast< uint32_t >(run_end - bit)};
+            if ((exp_start == BitsetT::npos) && (run_nbits >= n)) { exp_start = bit; }
+            if (run_nbits > max_nbits) {
+                max_start = bit;
+                max_nbits = run_nbits;
+            }
+            bit = run_end;
+        }
+
+        const auto blk{bset.get_next_contiguous_n_reset_bits(start, end, n, n)};
+        ASSERT_EQ(blk.start_bit, exp_start) << "start=" << start << " end=" << end << " n=" << n;
+        if (exp_start != BitsetT::npos) { ASSERT_EQ(blk.nbits, n); }
+
+        const auto max_blk{bset.get_max_contiguous_reset_bits(start, end)};
+        ASSERT_EQ(max_blk.start_bit, max_start);
+        ASSERT_EQ(max_blk.nbits, max_nbits);
+    }
+}
+
+template < typename BitsetT >
+void test_random(std::default_random_engine& re) {
+    BitsetT bset;
+    std::vector< bool > ref(BitsetT::size(), false);
+    std::uniform_int_distribution< uint64_t > rand_bit{0, BitsetT::size() - 1};
+    for (size_t i{0}; i < 30; ++i) {
+        const uint64_t start{rand_bit(re)};
+        const uint64_t nbits{std::min< uint64_t >(1 + rand_bit(re) % 40, BitsetT::size() - start)};
+        const bool value{(i % 3) != 0};
+        if (value) {
+            bset.set_bits(start, nbits);
+        } else {
+            bset.reset_bits(start, nbits);
+        }
+        std::fill_n(ref.begin() + start, nbits, value);
+        ASSERT_EQ(value ? bset.is_bits_set(start, nbits) : bset.is_bits_reset(start, nbits), true);
+        validate(bset, ref, re);
+    }
+
+    BitsetT copy_bset{bset};
+    ASSERT_EQ(copy_bset, bset);
+    copy_bset.set_all();
+    ASSERT_EQ(copy_bset.get_reset_count(), 0u);
+    ASSERT_EQ(copy_bset.get_next_reset_bit(0), BitsetT::npos);
+    ASSERT_EQ(copy_bset.get_max_contiguous_reset_bits().start_bit, BitsetT::npos);
+    copy_bset.reset_all();
+    ASSERT_EQ(copy_bset.get_set_count(), 0u);
+    ASSERT_EQ(copy_bset.get_next_contiguous_n_reset_bits(0, BitsetT::size()).nbits, BitsetT::size());
+    ASSERT_EQ(copy_bset.to_string(), std::string(BitsetT::size(), '0'));
+}
+} // namespace
+
+class FixedBitsetTest : public testing::Test {
+protected:
+    std::default_random_engine m_re{std::random_device{}()};
+};
+
+TEST_F(FixedBitsetTest, CompileTime) {
+    ASSERT_EQ(s_slot_map.to_string().find_last_of('1'), 199u);
+    ASSERT_EQ(s_slot_map.to_string().find_first_of('1'), 0u);
+    ASSERT_TRUE(s_slot_map.is_bits_set(60, 10));
+}
+
+TEST_F(FixedBitsetTest, RandomSetReset) {
+    test_random< FixedBitset< 1 > >(m_re);
+    test_random< FixedBitset< 64 > >(m_re);
+    test_random< FixedBitset< 100 > >(m_re);
+    test_random< FixedBitset< 513 > >(m_re);
+    test_random< FixedBitset< 100, Bitword< unsafe_bits< uint32_t > > > >(m_re);
+    test_random< FixedBitset< 300, Bitword< safe_bits< uint64_t > > > >(m_re);
+}
+
+TEST_F(FixedBitsetTest, OutOfRange) {
+    FixedBitset< 100 > bset;
+    ASSERT_THROW(bset.set_bit(100), std::out_of_range);
+    ASSERT_THROW(bset.set_bits(90, 11), std::out_of_range);
+    ASSERT_THROW(bset.get_bitval(100), std::out_of_range);
+    ASSERT_EQ(bset.get_next_reset_bit(100), FixedBitset< 100 >::npos);
+    ASSERT_EQ(bset.get_next_contiguous_n_reset_bits(100, 1).start_bit, FixedBitset< 100 >::npos);
+}
+
+int main(int argc, char* argv[]) {
+    SISL_OPTIONS_LOAD(argc, argv, logging)
+    ::testing::InitGoogleTest(&argc, argv);
+    sisl::logging::SetLogger("test_fixed_bitset");
+    spdlog::set_pattern("[%D %T%z] [%^%l%$] [%n] [%t] %v");
+
+    return RUN_ALL_TESTS();
+}
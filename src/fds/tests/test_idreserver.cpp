@@ -14,7 +14,14 @@
  * specific language governing permissions and limitations under the License.
  *
  *********************************************************************************/
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <thread>
 #include <vector>
 
@@ -27,62 +34,339 @@
 
 using namespace sisl;
 
-SISL_LOGGING_INIT(test_bitset);
+SISL_LOGGING_INIT(test_id_reserver)
 
 SISL_OPTIONS_ENABLE(logging, test_id_reserver)
 
 SISL_OPTION_GROUP(test_id_reserver,
-                 (num_threads, "", "num_threads", "number of threads",
-                  ::cxxopts::value< uint32_t >()->default_value("8"), "number"),
-                 (max_ids, "", "max_ids", "maximum number of ids",
-                  ::cxxopts::value< uint32_t >()->default_value("1000"), "number"),
+                  (num_threads, "", "num_threads", "number of threads",
+                   ::cxxopts::value< uint32_t >()->default_value("8"), "number"),
+                  (max_ids, "", "max_ids", "maximum number of ids",
+                   ::cxxopts::value< uint32_t >()->default_value("100000"), "number"))
 
 namespace {
-    uint32_t g_max_ids;
-    uint32_t g_num_threads;
+uint32_t g_max_ids;
+uint32_t g_num_threads;
 
-    void run_parallel(uint32_t nthreads, const std::function< void(uint32_t) >& thr_fn) {
-        std::vector< std::thread > threads;
-        auto n_per_thread = std::ceil((double)g_max_ids / nthreads);
-        int32_t remain_ids = (int32_t)g_max_ids;
+void run_parallel(uint32_t nthreads, const std::function< void(uint32_t) >& thr_fn) {
+    std::vector< std::thread > threads;
+    const auto n_per_thread{static_cast< uint32_t >(std::ceil(static_cast< double >(g_max_ids) / nthreads))};
+    uint32_t remain_ids{g_max_ids};
 
-        while (remain_ids > 0) {
-            threads.emplace_back(thr_fn, std::min(remain_ids, (int32_t)n_per_thread));
-            remain_ids -= n_per_thread;
+    while (remain_ids > 0) {
+        threads.emplace_back(thr_fn, std::min(remain_ids, n_per_thread));
+        remain_ids -= std::min(remain_ids, n_per_thread);
+    }
+    for (auto& t : threads) {
+        if (t.joinable()) t.join();
+    }
+}
+
+struct IDReserverTest : public testing::Test {
+public:
+    IDReserverTest() = default;
+    IDReserverTest(const IDReserverTest&) = delete;
+    IDReserverTest(IDReserverTest&&) noexcept = delete;
+    IDReserverTest& operator=(const IDReserverTest&) = delete;
+    IDReserverTest& operator=(IDReserverTest&&) noexcept = delete;
+    virtual ~IDReserverTest() override = default;
+
+protected:
+    IDReserver m_reserver;
+
+    void SetUp() override {}
+    void TearDown() override {}
+};
+
+struct ConcurrentIDReserverTest : public testing::Test {
+public:
+    ConcurrentIDReserverTest() = default;
+    ConcurrentIDReserverTest(const ConcurrentIDReserverTest&) = delete;
+    ConcurrentIDReserverTest(ConcurrentIDReserverTest&&) noexcept = delete;
+    ConcurrentIDReserverTest& operator=(const ConcurrentIDReserverTest&) = delete;
+    ConcurrentIDReserverTest& operator=(ConcurrentIDReserverTest&&) noexcept = delete;
+    virtual ~ConcurrentIDReserverTest() override = default;
+
+protected:
+    ConcurrentIDReserver m_reserver;
+
+    void SetUp() override {}
+    void TearDown() override {}
+};
+} // namespace
+
+TEST_F(IDReserverTest, ReserveUnreserve) {
+    std::mutex ids_mutex;
+    std::set< uint32_t > ids;
+    run_parallel(g_num_threads, [&](uint32_t n_ids_this_thread) {
+        for (uint32_t i{0}; i < n_ids_this_thread; ++i) {
+            const auto id{m_reserver.reserve()};
+            std::scoped_lock lg{ids_mutex};
+            ASSERT_TRUE(ids.insert(id).second);
         }
-        for (auto t : threads) {
-            if (t.joinable()) t.join();
+    });
+    EXPECT_EQ(m_reserver.reserved_count(), g_max_ids);
+
+    for (uint32_t id{0}; id < g_max_ids; id += 2) {
+        m_reserver.unreserve(id);
+    }
+    EXPECT_EQ(m_reserver.reserved_count(), g_max_ids / 2);
+    EXPECT_EQ(m_reserver.reserve(), 0u);
+
+    IDReserver loaded{m_reserver.serialize()};
+    uint32_t id{0};
+    ASSERT_TRUE(loaded.first_reserved_id(id));
+    EXPECT_EQ(id, 0u);
+    ASSERT_TRUE(loaded.next_reserved_id(id));
+    EXPECT_EQ(id, 1u);
+    ASSERT_TRUE(loaded.next_reserved_id(id));
+    EXPECT_EQ(id, 3u);
+}
+
+TEST_F(ConcurrentIDReserverTest, ReserveUnreserve) {
+    std::mutex ids_mutex;
+    std::set< uint32_t > ids;
+    run_parallel(g_num_threads, [&](uint32_t n_ids_this_thread) {
+        std::vector< uint32_t > my_ids;
+        for (uint32_t i{0}; i < n_ids_this_thread; ++i) {
+            my_ids.push_back(m_reserver.reserve());
         }
+
+        // Give back half and reserve again, which should reuse them from the thread cache
+        for (uint32_t i{0}; i < my_ids.size(); i += 2) {
+            m_reserver.unreserve(my_ids[i]);
+        }
+        for (uint32_t i{0}; i < my_ids.size(); i += 2) {
+            my_ids[i] = m_reserver.reserve();
+        }
+
+        std::scoped_lock lg{ids_mutex};
+        for (const auto id : my_ids) {
+            ASSERT_TRUE(ids.insert(id).second) << "id " << id << " is reserved twice";
+        }
+    });
+
+    // Ids left in the caches of the exited threads are returned
+    EXPECT_EQ(ids.size(), g_max_ids);
+    EXPECT_EQ(m_reserver.reserved_count(), g_max_ids);
+    for (const auto id : ids) {
+        ASSERT_TRUE(m_reserver.is_reserved(id));
     }
 
-    struct IDReserverTest : public testing::Test {
-    public:
-        IDReserverTest(const IDReserverTest&) = delete;
-        IDReserverTest(IDReserverTest&&) noexcept = delete;
-        IDReserverTest& operator=(const IDReserverTest&) = delete;
-        IDReserverTest& operator=(IDReserverTest&&) noexcept = delete;
-        virtual ~IDReserverTest() override = default;
+    // Serialized ids does not include the cached ids of this thread
+    const auto id{m_reserver.reserve()};
+    m_reserver.unreserve(id);
+    IDReserver loaded{m_reserver.serialize()};
+    EXPECT_EQ(loaded.reserved_count(), g_max_ids);
+    ConcurrentIDReserver concurrent_loaded{m_reserver.serialize()};
+    EXPECT_EQ(concurrent_loaded.reserved_count(), g_max_ids);
 
-    protected:
-        IDReserver m_reserver;
+    uint32_t found_id{0};
+    uint64_t count{0};
+    for (bool found{m_reserver.first_reserved_id(found_id)}; found; found = m_reserver.next_reserved_id(found_id)) {
+        EXPECT_TRUE(ids.count(found_id) == 1);
+        ++count;
+    }
+    EXPECT_EQ(count, g_max_ids);
+}
+
+TEST_F(ConcurrentIDReserverTest, ReserveSpecific) {
+    EXPECT_TRUE(m_reserver.reserve(5));
+    EXPECT_TRUE(m_reserver.reserve(5000));
+    EXPECT_FALSE(m_reserver.reserve(5));
+    EXPECT_TRUE(m_reserver.is_reserved(5));
+    EXPECT_TRUE(m_reserver.is_reserved(5000));
+
+    std::set< uint32_t > ids;
+    for (uint32_t i{0}; i < 6000; ++i) {
+        const auto id{m_reserver.reserve()};
+        EXPECT_NE(id, 5u);
+        EXPECT_NE(id, 5000u);
+        ASSERT_TRUE(ids.insert(id).second);
+    }
+    EXPECT_EQ(m_reserver.reserved_count(), 6002u);
 
-        void SetUp() override {}
-        void TearDown() override {}
-    };
+    // Ids in the thread cache are taken out of it and are not handed out again by reserve()
+    const auto cached_id{m_reserver.reserve()};
+    m_reserver.unreserve(cached_id);
+    EXPECT_FALSE(m_reserver.is_reserved(cached_id));
+    EXPECT_TRUE(m_reserver.reserve(cached_id));
+    EXPECT_TRUE(m_reserver.is_reserved(cached_id));
+    EXPECT_NE(m_reserver.reserve(), cached_id);
+    EXPECT_EQ(m_reserver.reserved_count(), 6004u);
+
+    // From the cache of another thread, which skips it and does not return it to the bitset on exit
+    uint32_t other_cached_id{0};
+    std::thread{[this, &other_cached_id]() {
+        other_cached_id = m_reserver.reserve();
+        m_reserver.unreserve(other_cached_id);
+        EXPECT_TRUE(m_reserver.reserve(other_cached_id));
+        EXPECT_NE(m_reserver.reserve(), other_cached_id);
+    }}.join();
+    EXPECT_TRUE(m_reserver.is_reserved(other_cached_id));
+    EXPECT_EQ(m_reserver.reserved_count(), 6006u);
 }
 
-TEST_F(IDReserverTest, RandomIDSet) {
-    run_parallel(g_num_threads, [&](int32_t n_ids_this_thread) {
-        LOGINFO("INFO: Setting alternate bits (set even and reset odd) in range[{} - {}]", start, start + count - 1);
-        for (auto i = 0; i < n_ids_this_thread; ++i) {
-            if (i % 2 == 0) { reserve(); }
+TEST(ConcurrentIDReserverCaches, ReserverDestroyedBeforeThread) {
+    auto reserver{std::make_unique< ConcurrentIDReserver >(1024)};
+    std::promise< void > cached;
+    std::promise< void > replaced;
+    std::thread thr{[&reserver, &cached, replaced_future = replaced.get_future()]() mutable {
+        const auto id{reserver->reserve()};
+        reserver->unreserve(id);
+        cached.set_value();
+
+        // Cache of the destroyed reserver is dropped, the new one (which could reuse its id) starts with its own
+        replaced_future.wait();
+        EXPECT_EQ(reserver->reserve(), 0u);
+        EXPECT_EQ(reserver->reserve(), 1u);
+        reserver->unreserve(0);
+    }};
+    cached.get_future().wait();
+    reserver.reset();
+    reserver = std::make_unique< ConcurrentIDReserver >(1024);
+    replaced.set_value();
+    thr.join();
+
+    // Ids cached by the exited thread are returned to the new reserver only
+    EXPECT_EQ(reserver->reserved_count(), 1u);
+    EXPECT_TRUE(reserver->is_reserved(1));
+    EXPECT_FALSE(reserver->is_reserved(0));
+}
+
+TEST_F(IDReserverTest, ReserveRange) {
+    const auto first{m_reserver.reserve_range(100)};
+    EXPECT_EQ(first, 0u);
+    EXPECT_EQ(m_reserver.reserve(), 100u);
+    m_reserver.unreserve_range(10, 20);
+    EXPECT_EQ(m_reserver.reserved_count(), 81u);
+
+    // Fits in the hole, the larger one does not and is placed after the existing ids
+    EXPECT_EQ(m_reserver.reserve_range(20), 10u);
+    EXPECT_EQ(m_reserver.reserve_range(30), 101u);
+
+    // Beyond the current size, which grows the reserver
+    const auto big{m_reserver.reserve_range(5000)};
+    EXPECT_EQ(big, 131u);
+    for (uint32_t id{big}; id < big + 5000; ++id) {
+        ASSERT_TRUE(m_reserver.is_reserved(id));
+    }
+    m_reserver.reserve_range(10000, 10);
+    EXPECT_TRUE(m_reserver.is_reserved(10009));
+    EXPECT_EQ(m_reserver.reserved_count(), 5141u);
+}
+
+TEST_F(ConcurrentIDReserverTest, ReserveRange) {
+    std::mutex ids_mutex;
+    std::set< uint32_t > ids;
+    run_parallel(g_num_threads, [&](uint32_t n_ids_this_thread) {
+        std::vector< std::pair< uint32_t, uint32_t > > ranges;
+        for (uint32_t count{1}; n_ids_this_thread > 0; count = (count % 64) + 1) {
+            const auto n{std::min(count, n_ids_this_thread)};
+            ranges.emplace_back(m_reserver.reserve_range(n), n);
+            n_ids_this_thread -= n;
+        }
+
+        // Release every other range and reserve the same sizes again
+        for (size_t i{0}; i < ranges.size(); i += 2) {
+            m_reserver.unreserve_range(ranges[i].first, ranges[i].second);
+        }
+        for (size_t i{0}; i < ranges.size(); i += 2) {
+            ranges[i].first = m_reserver.reserve_range(ranges[i].second);
+        }
+
+        std::scoped_lock lg{ids_mutex};
+        for (const auto& [start, count] : ranges) {
+            for (uint32_t id{start}; id < start + count; ++id) {
+                ASSERT_TRUE(ids.insert(id).second) << "id " << id << " is reserved twice";
+            }
         }
     });
+    EXPECT_EQ(m_reserver.reserved_count(), g_max_ids);
+
+    // Single ids and ranges don't overlap
+    const auto id{m_reserver.reserve()};
+    const auto start{m_reserver.reserve_range(64)};
+    EXPECT_TRUE((id < start) || (id >= start + 64));
+    EXPECT_EQ(ids.count(id), 0u);
+    EXPECT_EQ(ids.count(start), 0u);
+}
+
+TEST(IDReserverGenerations, TaggedIds) {
+    IDReserver reserver{64, id_reserver_options{.generation_tagged = true}};
+    const auto tid1{reserver.reserve_tagged()};
+    EXPECT_EQ(IDReserver::tagged_id_index(tid1), 0u);
+    EXPECT_EQ(IDReserver::tagged_id_generation(tid1), 0u);
+    EXPECT_TRUE(reserver.is_valid(tid1));
+
+    // Same id reused after unreserve, but the stale tagged id doesn't match it
+    EXPECT_TRUE(reserver.unreserve_tagged(tid1));
+    EXPECT_FALSE(reserver.is_valid(tid1));
+    EXPECT_FALSE(reserver.unreserve_tagged(tid1));
+    const auto tid2{reserver.reserve_tagged()};
+    EXPECT_EQ(IDReserver::tagged_id_index(tid2), 0u);
+    EXPECT_EQ(IDReserver::tagged_id_generation(tid2), 1u);
+    EXPECT_FALSE(reserver.is_valid(tid1));
+    EXPECT_TRUE(reserver.is_valid(tid2));
+
+    // Stale tagged id does not free the id reserved again
+    EXPECT_FALSE(reserver.unreserve_tagged(tid1));
+    EXPECT_TRUE(reserver.is_valid(tid2));
+    EXPECT_TRUE(reserver.is_reserved(0));
+
+    // Untagged unreserve of the id also moves the generation
+    reserver.unreserve(0);
+    EXPECT_FALSE(reserver.is_valid(tid2));
+    EXPECT_EQ(reserver.reserve_tagged(), IDReserver::make_tagged_id(0, 2));
+}
+
+TEST(IDReserverGenerations, AutoShrink) {
+    IDReserver reserver{64, id_reserver_options{.generation_tagged = true, .auto_shrink = true}};
+    std::vector< uint64_t > tids;
+    for (uint32_t i{0}; i < 1000; ++i) {
+        tids.push_back(reserver.reserve_tagged());
+    }
+    EXPECT_EQ(reserver.capacity(), 1024u);
+
+    // Free the tail, but the ones below 1/4th keep it from shrinking to less than half of it
+    for (uint32_t i{1000}; i > 100; --i) {
+        reserver.unreserve_tagged(tids[i - 1]);
+    }
+    EXPECT_EQ(reserver.capacity(), 256u);
+    EXPECT_EQ(reserver.reserved_count(), 100u);
+    for (uint32_t i{100}; i > 0; --i) {
+        reserver.unreserve_tagged(tids[i - 1]);
+    }
+    EXPECT_EQ(reserver.capacity(), 64u);
+    EXPECT_EQ(reserver.reserved_count(), 0u);
+    EXPECT_FALSE(reserver.is_reserved(500));
+
+    // Ids which were dropped by shrinking and come back by growing don't match their earlier tagged ids
+    for (uint32_t i{0}; i < 1000; ++i) {
+        const auto tid{reserver.reserve_tagged()};
+        EXPECT_EQ(IDReserver::tagged_id_index(tid), i);
+        EXPECT_FALSE(reserver.is_valid(tids[i]));
+        EXPECT_NE(tid, tids[i]);
+    }
+    EXPECT_EQ(reserver.capacity(), 1024u);
+
+    // Never shrinks below the estimated ids
+    const auto start{reserver.reserve_range(2000)};
+    reserver.unreserve_range(0, start + 2000);
+    EXPECT_EQ(reserver.capacity(), 64u);
+
+    // An id reserved in the upper 3/4th keeps it from shrinking, until it is unreserved
+    reserver.reserve_range(200, 1);
+    reserver.reserve(10);
+    reserver.unreserve(10);
+    EXPECT_EQ(reserver.capacity(), 201u);
+    reserver.unreserve(200);
+    EXPECT_EQ(reserver.capacity(), 64u);
 }
 
 int main(int argc, char* argv[]) {
-    SISL_OPTIONS_LOAD(argc, argv, logging, test_id_reserver);
     ::testing::InitGoogleTest(&argc, argv);
+    SISL_OPTIONS_LOAD(argc, argv, logging, test_id_reserver);
     sisl::logging::SetLogger("test_id_reserver");
     spdlog::set_pattern("[%D %T%z] [%^%l%$] [%n] [%t] %v");
 
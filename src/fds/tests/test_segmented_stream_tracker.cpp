@@ -0,0 +1,247 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+#include <gtest/gtest.h>
+
+#include "sisl/fds/segmented_stream_tracker.hpp"
+
+using namespace sisl;
+
+SISL_LOGGING_INIT(test_segmented_stream_tracker)
+RCU_REGISTER_INIT
+
+namespace {
+struct TestData {
+    TestData(int val) : m_value(val) {}
+    int m_value = 0;
+
+    bool operator==(const TestData& other) const { return (m_value == other.m_value); }
+};
+
+// Small chunks, so that the tests cross the chunk boundaries and grow the chunk directory
+static constexpr size_t TEST_CHUNK_SLOTS{64};
+
+struct SegmentedStreamTrackerTest : public testing::Test {
+public:
+    SegmentedStreamTrackerTest(const SegmentedStreamTrackerTest&) = delete;
+    SegmentedStreamTrackerTest(SegmentedStreamTrackerTest&&) noexcept = delete;
+    SegmentedStreamTrackerTest& operator=(const SegmentedStreamTrackerTest&) = delete;
+    SegmentedStreamTrackerTest& operator=(SegmentedStreamTrackerTest&&) noexcept = delete;
+    virtual ~SegmentedStreamTrackerTest() override = default;
+
+protected:
+    SegmentedStreamTracker< TestData, false, TEST_CHUNK_SLOTS > m_tracker;
+
+    void SetUp() override {}
+    void TearDown() override {}
+
+public:
+    SegmentedStreamTrackerTest() {}
+};
+} // namespace
+
+TEST_F(SegmentedStreamTrackerTest, SimpleCompletions) {
+    static std::random_device s_rd{};
+    static std::default_random_engine s_engine{s_rd()};
+    std::uniform_int_distribution< int > gen{0, 999};
+
+    for (auto i = 0; i < 100; ++i) {
+        m_tracker.create_and_complete(i, gen(s_engine));
+    }
+    EXPECT_EQ(m_tracker.completed_upto(), 99);
+    m_tracker.truncate();
+    EXPECT_EQ(m_tracker.completed_upto(), 99);
+
+    // Do it in reverse
+    for (auto i = 150; i >= 100; --i) {
+        EXPECT_EQ(m_tracker.completed_upto(), 99);
+        m_tracker.create_and_complete(i, gen(s_engine));
+    }
+    EXPECT_EQ(m_tracker.completed_upto(), 150);
+
+    // Do it in alternate fashion
+    auto start_idx = 151;
+    auto end_idx = 200;
+    bool front = true;
+    while (start_idx < end_idx) {
+        if (front) {
+            m_tracker.create_and_complete(start_idx++, gen(s_engine));
+        } else {
+            m_tracker.create_and_complete(end_idx--, gen(s_engine));
+        }
+        EXPECT_EQ(m_tracker.completed_upto(), start_idx - 1);
+        front = !front;
+    }
+    m_tracker.create_and_complete(start_idx, gen(s_engine));
+    EXPECT_EQ(m_tracker.completed_upto(), 200);
+}
+
+TEST_F(SegmentedStreamTrackerTest, FarIdx) {
+    // Far idx needs the directory to grow, but nothing before it is completed
+    const int64_t far_idx{static_cast< int64_t >(TEST_CHUNK_SLOTS) * 40 + 5};
+    m_tracker.create_and_complete(far_idx, 1);
+    EXPECT_EQ(m_tracker.completed_upto(), -1);
+    EXPECT_TRUE(m_tracker.status(far_idx).is_completed);
+    EXPECT_TRUE(m_tracker.status(far_idx - 1).is_hole);
+
+    for (int64_t i = 0; i < far_idx; ++i) {
+        m_tracker.create_and_complete(i, static_cast< int >(i));
+    }
+    EXPECT_EQ(m_tracker.completed_upto(), far_idx);
+    EXPECT_EQ(m_tracker.at(far_idx - 1), TestData{static_cast< int >(far_idx - 1)});
+
+    int64_t count{0};
+    m_tracker.foreach_all_completed(0, [&count](int64_t, TestData&) {
+        ++count;
+        return true;
+    });
+    EXPECT_EQ(count, far_idx + 1);
+
+    EXPECT_EQ(m_tracker.truncate(), far_idx);
+    EXPECT_TRUE(m_tracker.status(far_idx).is_out_of_range);
+    EXPECT_THROW(m_tracker.at(far_idx), std::out_of_range);
+
+    // Updates to the truncated idx are ignored
+    EXPECT_EQ(m_tracker.create_and_complete(10, 1), far_idx);
+    EXPECT_TRUE(m_tracker.status(10).is_out_of_range);
+}
+
+TEST_F(SegmentedStreamTrackerTest, Rollback) {
+    static std::random_device s_rd{};
+    static std::default_random_engine s_engine{s_rd()};
+    std::uniform_int_distribution< int > gen{0, 999};
+
+    for (auto i = 0; i < 200; ++i) {
+        m_tracker.create(i, gen(s_engine));
+    }
+    EXPECT_EQ(m_tracker.active_upto(), 199);
+    EXPECT_EQ(m_tracker.completed_upto(), -1);
+    m_tracker.complete(0, 99);
+    EXPECT_EQ(m_tracker.active_upto(), 199);
+    EXPECT_EQ(m_tracker.completed_upto(), 99);
+
+    m_tracker.rollback(169);
+    EXPECT_EQ(m_tracker.active_upto(), 169);
+    EXPECT_EQ(m_tracker.completed_upto(), 99);
+
+    m_tracker.complete(100, 169);
+    EXPECT_EQ(m_tracker.active_upto(), 169);
+    EXPECT_EQ(m_tracker.completed_upto(), 169);
+
+    auto new_val1 = gen(s_engine);
+    auto new_val2 = gen(s_engine);
+    m_tracker.create(170, new_val1);
+    m_tracker.create(172, new_val2);
+    EXPECT_EQ(m_tracker.active_upto(), 170);
+    EXPECT_EQ(m_tracker.completed_upto(), 169);
+    m_tracker.complete(170, 170);
+    EXPECT_EQ(m_tracker.completed_upto(), 170);
+    m_tracker.create_and_complete(171, new_val2);
+    m_tracker.complete(172, 172);
+
+    EXPECT_EQ(m_tracker.completed_upto(), 172);
+    EXPECT_EQ(m_tracker.at(170), TestData{new_val1});
+    EXPECT_EQ(m_tracker.at(171), TestData{new_val2});
+    EXPECT_EQ(m_tracker.at(172), TestData{new_val2});
+
+    m_tracker.truncate(80);
+    EXPECT_THROW(m_tracker.rollback(1), std::out_of_range);
+    m_tracker.truncate(173);
+    EXPECT_THROW(m_tracker.rollback(1), std::out_of_range);
+}
+
+TEST_F(SegmentedStreamTrackerTest, ConcurrentCompletionsAndTruncate) {
+    static constexpr size_t nthreads{8};
+    static constexpr int64_t entries_per_thread{20000};
+    static constexpr int64_t total_entries{nthreads * entries_per_thread};
+
+    std::atomic< bool > done{false};
+    std::thread truncate_thread{[this, &done]() {
+        urcu_ctl::register_rcu();
+        int64_t last{-1};
+        while (!done.load(std::memory_order_acquire)) {
+            const auto upto{m_tracker.truncate()};
+            EXPECT_GE(upto, last);
+            last = upto;
+            std::this_thread::yield();
+        }
+        urcu_ctl::unregister_rcu();
+    }};
+
+    // Threads complete interleaved idx, so the cursor can move only when all of them progress
+    std::vector< std::thread > threads;
+    for (size_t t{0}; t < nthreads; ++t) {
+        threads.emplace_back([this, t]() {
+            urcu_ctl::register_rcu();
+            for (int64_t i{static_cast< int64_t >(t)}; i < total_entries; i += nthreads) {
+                m_tracker.create(i, static_cast< int >(i));
+                m_tracker.update(
+                    i, [i](TestData& data) { return data.m_value == static_cast< int >(i); }, static_cast< int >(i));
+            }
+            urcu_ctl::unregister_rcu();
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    done.store(true, std::memory_order_release);
+    truncate_thread.join();
+
+    EXPECT_EQ(m_tracker.completed_upto(), total_entries - 1);
+    EXPECT_EQ(m_tracker.truncate(), total_entries - 1);
+}
+
+TEST(SegmentedStreamTrackerAutoTruncate, AutoTruncate) {
+    SegmentedStreamTracker< TestData, true, TEST_CHUNK_SLOTS > tracker{"AutoTruncateTracker"};
+    for (auto i = 0; i < 5000; ++i) {
+        tracker.create_and_complete(i, i);
+    }
+    EXPECT_EQ(tracker.completed_upto(), 4999);
+
+    // Atleast the first 1000 would have been truncated by now
+    EXPECT_TRUE(tracker.status(999).is_out_of_range);
+    EXPECT_EQ(tracker.truncate(), 4999);
+    EXPECT_TRUE(tracker.status(4999).is_out_of_range);
+}
+
+TEST(SegmentedStreamTrackerAutoTruncate, RangedComplete) {
+    SegmentedStreamTracker< TestData, true, TEST_CHUNK_SLOTS > tracker{"AutoTruncateTracker"};
+
+    // Completions only through complete() are counted for truncate
+    tracker.complete(0, 99);
+    EXPECT_EQ(tracker.completed_upto(), 99);
+    EXPECT_EQ(tracker.truncate(), 99);
+    EXPECT_TRUE(tracker.status(99).is_out_of_range);
+    EXPECT_EQ(tracker.get_status(2)["completed_since_last_truncate"], 0);
+
+    // And trigger the auto truncate once there are enough of them
+    tracker.complete(100, 2099);
+    EXPECT_TRUE(tracker.status(2099).is_out_of_range);
+    EXPECT_EQ(tracker.truncate(), 2099);
+}
+
+int main(int argc, char* argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    urcu_ctl::register_rcu();
+    auto ret = RUN_ALL_TESTS();
+    urcu_ctl::unregister_rcu();
+    return ret;
+}
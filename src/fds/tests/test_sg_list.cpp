@@ -12,8 +12,17 @@
  * specific language governing permissions and limitations under the License.
  *
  *********************************************************************************/
+#include <array>
+#include <cstdint>
+#include <vector>
 
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <sisl/logging/logging.h>
+#include <sisl/options/options.h>
 #include <gtest/gtest.h>
+
 #include "sisl/fds/buffer.hpp"
 
 SISL_LOGGING_INIT(test_sg_list)
@@ -22,11 +31,153 @@ SISL_OPTION_GROUP(test_sg_list,
                   (num_threads, "", "num_threads", "number of threads",
                    ::cxxopts::value< uint32_t >()->default_value("8"), "number"))
 
-struct SgListTest : public testing::Test {};
+struct SgListTest : public testing::Test {
+protected:
+    // Buffers of 100, 200 and 300 bytes, filled with the offset of the byte in the list
+    void SetUp() override {
+        uint8_t val{0};
+        for (auto& buf : m_bufs) {
+            for (auto& b : buf) {
+                b = val++;
+            }
+        }
+        m_sg.append(m_bufs[0].data(), m_bufs[0].size());
+        m_sg.append(m_bufs[1].data(), m_bufs[1].size());
+        m_sg.append(m_bufs[2].data(), m_bufs[2].size());
+    }
+
+    static void validate(const sisl::sg_list& sg, const uint64_t offset) {
+        const auto arr{sg.gather()};
+        ASSERT_EQ(arr->size, sg.size);
+        for (uint32_t i{0}; i < arr->size; ++i) {
+            ASSERT_EQ(arr->bytes[i], static_cast< uint8_t >(offset + i)) << "at " << i;
+        }
+    }
+
+    std::array< std::vector< uint8_t >, 3 > m_bufs{std::vector< uint8_t >(100), std::vector< uint8_t >(200),
+                                                   std::vector< uint8_t >(300)};
+    sisl::sg_list m_sg;
+};
 
 // a test case that make sure iterator works as expected;
 TEST_F(SgListTest, TestIterator) {
-    // TO Be Implemented;
+    sisl::sg_iterator itr{m_sg.iovs};
+    auto iovs{itr.next_iovs(50)};
+    ASSERT_EQ(iovs.size(), 1u);
+    EXPECT_EQ(iovs[0].iov_len, 50u);
+
+    // Crosses the first and second buffer
+    const auto sg{itr.next_sg(100)};
+    ASSERT_EQ(sg.iovs.size(), 2u);
+    EXPECT_EQ(sg.size, 100u);
+    EXPECT_EQ(sg.iovs[0].iov_len, 50u);
+    validate(sg, 50);
+
+    EXPECT_EQ(itr.skip(400), 400u);
+    EXPECT_TRUE(itr.has_more());
+    const auto last{itr.next_sg(1000)};
+    EXPECT_EQ(last.size, 50u);
+    validate(last, 550);
+    EXPECT_FALSE(itr.has_more());
+    EXPECT_TRUE(itr.next_iovs(10).empty());
+}
+
+TEST_F(SgListTest, SliceAndSplit) {
+    const auto slice{m_sg.slice(150, 300)};
+    EXPECT_EQ(slice.size, 300u);
+    ASSERT_EQ(slice.iovs.size(), 2u);
+    EXPECT_EQ(slice.iovs[0].iov_base, m_bufs[1].data() + 50);
+    validate(slice, 150);
+    EXPECT_EQ(m_sg.slice(0, 100).iovs.size(), 1u);
+    EXPECT_EQ(m_sg.slice(600, 0).size, 0u);
+
+    auto head{m_sg};
+    auto tail{head.split_at(250)};
+    EXPECT_EQ(head.size, 250u);
+    EXPECT_EQ(head.iovs.size(), 2u);
+    EXPECT_EQ(tail.size, 350u);
+    EXPECT_EQ(tail.iovs.size(), 2u);
+    validate(head, 0);
+    validate(tail, 250);
+
+    // Split at the iov boundary doesn't leave an empty iov
+    auto head2{m_sg};
+    auto tail2{head2.split_at(100)};
+    EXPECT_EQ(head2.iovs.size(), 1u);
+    EXPECT_EQ(tail2.iovs.size(), 2u);
+}
+
+TEST_F(SgListTest, AppendPrependConcat) {
+    auto sg{m_sg.slice(100, 500)};
+    sg.prepend(m_bufs[0].data(), m_bufs[0].size());
+    EXPECT_EQ(sg.size, 600u);
+    validate(sg, 0);
+
+    const auto front{m_sg.slice(0, 300)};
+    const auto back{m_sg.slice(300, 300)};
+    const auto joined{sisl::sg_list::concat(front, back)};
+    EXPECT_EQ(joined.size, 600u);
+    validate(joined, 0);
+
+    sisl::sg_list empty;
+    empty.append(m_bufs[0].data(), 0);
+    EXPECT_TRUE(empty.iovs.empty());
+    empty.prepend(back);
+    empty.prepend(front);
+    validate(empty, 0);
+
+    // Appended and prepended to itself
+    auto twice{m_sg};
+    twice.append(twice);
+    EXPECT_EQ(twice.size, 1200u);
+    EXPECT_EQ(twice.iovs.size(), 6u);
+    twice.prepend(twice);
+    EXPECT_EQ(twice.size, 2400u);
+    EXPECT_EQ(twice.iovs.size(), 12u);
+    for (size_t i{0}; i < twice.iovs.size(); ++i) {
+        EXPECT_EQ(twice.iovs[i].iov_base, m_sg.iovs[i % 3].iov_base);
+    }
+}
+
+TEST_F(SgListTest, GatherScatter) {
+    // Contiguous one is not copied
+    sisl::byte_array holder;
+    const auto single{m_sg.slice(110, 50).flatten(holder)};
+    EXPECT_EQ(single.bytes, m_bufs[1].data() + 10);
+    EXPECT_EQ(holder, nullptr);
+    const auto multi{m_sg.flatten(holder)};
+    ASSERT_NE(holder, nullptr);
+    EXPECT_EQ(multi.bytes, holder->bytes);
+    EXPECT_EQ(multi.size, 600u);
+
+    std::vector< uint8_t > dst(200);
+    EXPECT_EQ(m_sg.copy_to(dst.data(), 50, 200), 200u);
+    EXPECT_EQ(dst[0], 50);
+    EXPECT_EQ(dst[199], static_cast< uint8_t >(249));
+    EXPECT_EQ(m_sg.copy_to(dst.data(), 500, 200), 100u);
+
+    std::vector< uint8_t > src(600, 0xff);
+    EXPECT_EQ(m_sg.scatter(sisl::blob{src.data(), 600}), 600u);
+    EXPECT_EQ(m_bufs[0][0], 0xff);
+    EXPECT_EQ(m_bufs[2][299], 0xff);
+}
+
+TEST_F(SgListTest, ReadvWritev) {
+    char path[] = "/tmp/test_sg_list_XXXXXX";
+    const int fd{::mkstemp(path)};
+    ASSERT_GE(fd, 0);
+    ::unlink(path);
+
+    const auto sg{m_sg.slice(50, 500)};
+    ASSERT_EQ(::writev(fd, sg.iov_data(), sg.iov_count()), 500);
+
+    std::array< std::vector< uint8_t >, 2 > rbufs{std::vector< uint8_t >(200), std::vector< uint8_t >(300)};
+    sisl::sg_list rsg;
+    rsg.append(rbufs[0].data(), 200);
+    rsg.append(rbufs[1].data(), 300);
+    ASSERT_EQ(::preadv(fd, rsg.iov_data(), rsg.iov_count(), 0), 500);
+    validate(rsg, 50);
+    ::close(fd);
 }
 
 int main(int argc, char* argv[]) {
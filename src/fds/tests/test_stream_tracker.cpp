@@ -14,9 +14,15 @@
  * specific language governing permissions and limitations under the License.
  *
  *********************************************************************************/
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <random>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 #include <gtest/gtest.h>
@@ -166,6 +172,248 @@ TEST_F(StreamTrackerTest, Rollback) {
     EXPECT_EQ(exception_hit, true);
 }
 
+TEST_F(StreamTrackerTest, BatchCreateComplete) {
+    // Batch with a gap and out of order runs
+    std::vector< std::pair< int64_t, TestData > > batch;
+    for (int64_t i = 64; i < 128; ++i) {
+        batch.emplace_back(i, TestData{static_cast< int >(i)});
+    }
+    for (int64_t i = 0; i < 50; ++i) {
+        batch.emplace_back(i, TestData{static_cast< int >(i)});
+    }
+    m_tracker.create_batch(batch);
+    EXPECT_EQ(m_tracker.active_upto(), 49);
+    EXPECT_EQ(m_tracker.completed_upto(), -1);
+    EXPECT_TRUE(m_tracker.status(50).is_hole);
+    EXPECT_TRUE(m_tracker.status(64).is_active);
+    EXPECT_EQ(m_tracker.at(100), TestData{100});
+
+    m_tracker.complete(0, 49);
+    EXPECT_EQ(m_tracker.completed_upto(), 49);
+
+    batch.clear();
+    for (int64_t i = 50; i < 64; ++i) {
+        batch.emplace_back(i, TestData{static_cast< int >(i) * 2});
+    }
+    m_tracker.create_and_complete_batch(batch);
+    EXPECT_EQ(m_tracker.active_upto(), 127);
+    EXPECT_EQ(m_tracker.completed_upto(), 63);
+    EXPECT_EQ(m_tracker.at(63), TestData{126});
+
+    m_tracker.complete(64, 127);
+    EXPECT_EQ(m_tracker.completed_upto(), 127);
+    EXPECT_EQ(m_tracker.truncate(), 127);
+
+    // Entries which are already truncated are skipped, and the batch beyond the allocated slots resizes
+    const auto far_idx = (int64_t)StreamTracker< TestData >::alloc_blk_size * 2;
+    batch.clear();
+    batch.emplace_back(100, TestData{1});
+    batch.emplace_back(far_idx, TestData{2});
+    m_tracker.create_and_complete_batch(batch);
+    EXPECT_TRUE(m_tracker.status(100).is_out_of_range);
+    EXPECT_TRUE(m_tracker.status(far_idx).is_completed);
+    m_tracker.complete(0, far_idx - 1);
+    EXPECT_EQ(m_tracker.completed_upto(), far_idx);
+}
+
+TEST(StreamTrackerBatch, MoveOnlyData) {
+    StreamTracker< std::unique_ptr< int > > tracker{"MoveOnlyTracker"};
+    std::vector< std::pair< int64_t, std::unique_ptr< int > > > batch;
+    for (int64_t i = 0; i < 64; ++i) {
+        batch.emplace_back(i, std::make_unique< int >(static_cast< int >(i)));
+    }
+    tracker.create_and_complete_batch(batch);
+    EXPECT_EQ(tracker.completed_upto(), 63);
+    EXPECT_EQ(*tracker.at(42), 42);
+    EXPECT_EQ(batch[42].second, nullptr);
+}
+
+TEST(StreamTrackerAutoTruncate, BatchCompletions) {
+    StreamTracker< TestData, true > tracker{"BatchAutoTruncateTracker"};
+    std::vector< std::pair< int64_t, TestData > > batch;
+    for (int64_t start = 0; start < 2048; start += 256) {
+        batch.clear();
+        for (int64_t i = start; i < start + 256; ++i) {
+            batch.emplace_back(i, TestData{static_cast< int >(i)});
+        }
+        tracker.create_and_complete_batch(batch);
+    }
+    EXPECT_EQ(tracker.completed_upto(), 2047);
+
+    // Crossing the truncate frequency in the batch would have truncated it
+    EXPECT_TRUE(tracker.status(1023).is_out_of_range);
+}
+
+TEST_F(StreamTrackerTest, CompletionWaiters) {
+    std::vector< int64_t > notified;
+    const auto waiter = [&notified](int64_t upto) { notified.push_back(upto); };
+
+    m_tracker.on_completed_upto(10, waiter);
+    m_tracker.on_completed_upto(5, waiter);
+    for (auto i = 0; i < 5; ++i) {
+        m_tracker.create_and_complete(i, i);
+    }
+    EXPECT_TRUE(notified.empty());
+
+    // Out of order completions notify only when the hole is filled
+    for (auto i = 12; i > 5; --i) {
+        m_tracker.create_and_complete(i, i);
+    }
+    EXPECT_TRUE(notified.empty());
+    m_tracker.create_and_complete(5, 5);
+    ASSERT_EQ(notified.size(), 2u);
+    EXPECT_EQ(notified[0], 12);
+    EXPECT_EQ(notified[1], 12);
+
+    // Already completed is notified right away
+    m_tracker.on_completed_upto(3, waiter);
+    ASSERT_EQ(notified.size(), 3u);
+
+    // Rollback drops the completions beyond the new end
+    m_tracker.rollback(12);
+    m_tracker.create(13, 13);
+    m_tracker.on_completed_upto(14, waiter);
+    m_tracker.rollback(12);
+    m_tracker.create_and_complete(14, 14);
+    EXPECT_EQ(notified.size(), 3u);
+    m_tracker.complete(13, 13);
+    ASSERT_EQ(notified.size(), 4u);
+    EXPECT_EQ(notified[3], 14);
+
+    // Truncating past the incomplete entries satisfies the waiter as well
+    m_tracker.create(15, 15);
+    m_tracker.on_completed_upto(15, waiter);
+    m_tracker.truncate(15);
+    ASSERT_EQ(notified.size(), 5u);
+    EXPECT_EQ(notified[4], 15);
+}
+
+TEST_F(StreamTrackerTest, CompletionFuture) {
+    static constexpr int64_t total_entries{10000};
+    auto fut = m_tracker.completed_upto_future(total_entries - 1);
+
+    std::vector< std::thread > threads;
+    for (int64_t t = 0; t < 4; ++t) {
+        threads.emplace_back([this, t]() {
+            for (int64_t i = t; i < total_entries; i += 4) {
+                m_tracker.create_and_complete(i, static_cast< int >(i));
+            }
+        });
+    }
+    EXPECT_EQ(std::move(fut).get(std::chrono::seconds(30)), total_entries - 1);
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+TEST(StreamTrackerSlabStorage, NonTriviallyCopyable) {
+    struct Entry {
+        Entry(std::shared_ptr< int > p, size_t n) : m_ptr{std::move(p)}, m_payload(n, 'x') {}
+        std::shared_ptr< int > m_ptr;
+        std::vector< char > m_payload;
+    };
+    const auto counter = std::make_shared< int >(0);
+
+    {
+        StreamTracker< Entry > tracker{"SlabStorageTracker"};
+        const auto far_idx = (int64_t)StreamTracker< Entry >::alloc_blk_size * 3;
+        for (int64_t i = 0; i < 100; ++i) {
+            tracker.create_and_complete(i, counter, static_cast< size_t >(i));
+        }
+        const Entry* entry_ptr = &tracker.at(50);
+
+        // Resize does not move the entries, and the ones truncated or rolled back are destroyed
+        tracker.create(far_idx, counter, 10u);
+        EXPECT_EQ(&tracker.at(50), entry_ptr);
+        EXPECT_EQ(tracker.at(50).m_payload.size(), 50u);
+        EXPECT_EQ(counter.use_count(), 102);
+
+        tracker.truncate();
+        EXPECT_EQ(counter.use_count(), 2);
+        for (int64_t i = 100; i < 110; ++i) {
+            tracker.create(i, counter, 1u);
+        }
+        tracker.rollback(104);
+        EXPECT_EQ(counter.use_count(), 6);
+
+        // Replacing an entry destroys the old one
+        tracker.create(104, counter, 2u);
+        EXPECT_EQ(counter.use_count(), 6);
+        EXPECT_EQ(tracker.at(104).m_payload.size(), 2u);
+    }
+    EXPECT_EQ(counter.use_count(), 1);
+}
+
+TEST(StreamTrackerSlabStorage, MoveOnly) {
+    StreamTracker< std::unique_ptr< int > > tracker{"MoveOnlyTracker"};
+    for (int i = 0; i < 5000; ++i) {
+        tracker.create_and_complete(i, std::make_unique< int >(i));
+    }
+    EXPECT_EQ(tracker.completed_upto(), 4999);
+    EXPECT_EQ(*tracker.at(4999), 4999);
+
+    int64_t count{0};
+    tracker.foreach_all_completed(0, [&count](int64_t idx, std::unique_ptr< int >& val) {
+        EXPECT_EQ(*val, idx);
+        ++count;
+        return true;
+    });
+    EXPECT_EQ(count, 5000);
+    EXPECT_EQ(tracker.truncate(), 4999);
+}
+
+TEST_F(StreamTrackerTest, SerializeLoad) {
+    for (auto i = 0; i < 300; ++i) {
+        if ((i % 7) != 3) { m_tracker.create(i, i); }
+    }
+    m_tracker.complete(0, 2);
+    for (auto i = 100; i < 200; ++i) {
+        m_tracker.update(
+            i, []([[maybe_unused]] TestData& data) { return true; }, i);
+    }
+    m_tracker.truncate(1);
+    const auto far_idx = (int64_t)StreamTracker< TestData >::alloc_blk_size + 10;
+    m_tracker.create_and_complete(far_idx, 1000);
+
+    const auto buf = m_tracker.serialize();
+    StreamTracker< TestData > loaded{"LoadedTracker", buf};
+    EXPECT_EQ(loaded.completed_upto(), m_tracker.completed_upto());
+    EXPECT_EQ(loaded.active_upto(), m_tracker.active_upto());
+    for (int64_t i = 0; i <= far_idx; ++i) {
+        const auto expected = m_tracker.status(i);
+        const auto actual = loaded.status(i);
+        ASSERT_EQ(actual.is_out_of_range, expected.is_out_of_range) << "idx=" << i;
+        ASSERT_EQ(actual.is_hole, expected.is_hole) << "idx=" << i;
+        ASSERT_EQ(actual.is_active, expected.is_active) << "idx=" << i;
+        ASSERT_EQ(actual.is_completed, expected.is_completed) << "idx=" << i;
+        if (expected.is_active || expected.is_completed) { ASSERT_EQ(loaded.at(i), m_tracker.at(i)); }
+    }
+
+    // Loaded tracker continues from where it was serialized
+    loaded.create_and_complete(3, 3);
+    EXPECT_EQ(loaded.completed_upto(), 3);
+    EXPECT_EQ(loaded.truncate(), 3);
+    loaded.complete(4, 99);
+    EXPECT_EQ(loaded.completed_upto(), 199);
+
+    // Truncated or wrong type of buffers are rejected
+    auto short_buf = make_byte_array(buf->size - 1);
+    std::memcpy(short_buf->bytes, buf->bytes, short_buf->size);
+    EXPECT_THROW((StreamTracker< TestData >{"ShortTracker", short_buf}), std::out_of_range);
+    EXPECT_THROW((StreamTracker< int64_t >{"WrongTypeTracker", buf}), std::out_of_range);
+
+    // Count of the entries which does not match the active bits is rejected
+    for (const int64_t delta : {-1, 1}) {
+        auto bad_buf = make_byte_array(buf->size);
+        std::memcpy(bad_buf->bytes, buf->bytes, buf->size);
+        stream_tracker_serialized hdr;
+        std::memcpy(static_cast< void* >(&hdr), bad_buf->bytes, sizeof(hdr));
+        hdr.m_nentries += delta;
+        std::memcpy(bad_buf->bytes, static_cast< const void* >(&hdr), sizeof(hdr));
+        EXPECT_THROW((StreamTracker< TestData >{"BadCountTracker", bad_buf}), std::out_of_range);
+    }
+}
+
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
     auto ret = RUN_ALL_TESTS();